@@ -89,7 +89,8 @@ static RMProjection *_latitudeLongitudeProjection = nil;
     if (!(self = [super init]))
         return nil;
 
-    _internalProjection = pj_init_plus([proj4String UTF8String]);
+    // share one PJ per string; like pj_init_plus() it is on the default context
+    _internalProjection = pj_init_plus_cached([proj4String UTF8String]);
 
     if (_internalProjection == NULL)
     {
@@ -190,17 +191,20 @@ static RMProjection *_latitudeLongitudeProjection = nil;
 
 #pragma mark - UTM conversions
 
-// This uses code by Chuck Gantz, found at http://www.gpsy.com/gpsinfo/geotoutm/
-// It is limited to WGS84, have a look at the original source code if you need more.
+// The conversions use the Kruger series UTM of the bundled PROJ.4 (pj_utm_fwd()/pj_utm_inv()),
+// which is good to well under a millimetre across each zone. They are limited to WGS84.
 
-//
-// Source
-// Defense Mapping Agency. 1987b. DMA Technical Report: Supplement to Department of Defense World Geodetic System
-// 1984 Technical Report. Part I and II. Washington, DC: Defense Mapping Agency
-//
+static projPJ RMUTMDatumDefinition(void)
+{
+    static projPJ definition = NULL;
+    static dispatch_once_t onceToken;
 
-#define deg2rad (M_PI / 180.0)
-#define rad2deg (180.0 / M_PI)
+    dispatch_once(&onceToken, ^{
+        definition = pj_init_plus_cached("+proj=latlong +datum=WGS84");
+    });
+
+    return definition;
+}
 
 // This routine determines the correct UTM letter designator for the given latitude.
 // Returns 'Z' if latitude is outside the UTM limits of 84N to 80S
@@ -234,11 +238,10 @@ static RMProjection *_latitudeLongitudeProjection = nil;
     return [NSString stringWithFormat:@"%c", letterDesignator];
 }
 
-// Converts latitude/longitude to UTM coordinates.  Equations from USGS Bulletin 1532.
+// Converts latitude/longitude to UTM coordinates.
 // East longitudes are positive, West longitudes are negative.
 // North latitudes are positive, South latitudes are negative.
 // Latitude and longitude are in decimal degrees.
-// Written by Chuck Gantz - chuck.gantz@globalstar.com
 + (void)convertCoordinate:(CLLocationCoordinate2D)coordinate
           toUTMZoneNumber:(int *)utmZoneNumber
             utmZoneLetter:(NSString **)utmZoneLetter
@@ -246,37 +249,16 @@ static RMProjection *_latitudeLongitudeProjection = nil;
                   easting:(double *)easting
                  northing:(double *)northing
 {
-    double a = 6378137.0;
-    double eccSquared = 0.00669438;
-    double k0 = 0.9996;
-
-    double longitudeOrigin, longitudeOriginRad;
-    double eccPrimeSquared;
-    double N, T, C, A, M;
-
-    // Make sure the longitude is between -180.00 .. 179.9
-    double longitudeTemp = (coordinate.longitude + 180.0) - (floor((coordinate.longitude + 180.0) / 360.0) * 360.0) - 180.0;
-    double latitudeRad = coordinate.latitude * deg2rad;
-    double longitudeRad = longitudeTemp * deg2rad;
+    double x = coordinate.longitude * DEG_TO_RAD;
+    double y = coordinate.latitude * DEG_TO_RAD;
+    int zone = 0; // picked by pj_utm_fwd(), negative in the southern hemisphere
 
-    *utmZoneNumber = floor((longitudeTemp + 180.0) / 6.0) + 1;
+    pj_utm_fwd(RMUTMDatumDefinition(), 1, 1, &x, &y, &zone);
 
-    if (coordinate.latitude >= 56.0 && coordinate.latitude < 64.0 && longitudeTemp >= 3.0 && longitudeTemp < 12.0)
-        *utmZoneNumber = 32;
+    *utmZoneNumber = abs(zone);
+    *easting = x;
+    *northing = y;
 
-    // Special zones for Svalbard
-    if (coordinate.latitude >= 72.0 && coordinate.latitude < 84.0)
-    {
-        if (longitudeTemp >= 0.0 && longitudeTemp < 9.0) *utmZoneNumber = 31;
-        else if (longitudeTemp >= 9.0 && longitudeTemp < 21.0) *utmZoneNumber = 33;
-        else if (longitudeTemp >= 21.0 && longitudeTemp < 33.0) *utmZoneNumber = 35;
-        else if (longitudeTemp >= 33.0 && longitudeTemp < 42.0) *utmZoneNumber = 37;
-    }
-
-    longitudeOrigin = (*utmZoneNumber - 1) * 6 - 180 + 3;  //+3 puts origin in middle of zone
-    longitudeOriginRad = longitudeOrigin * deg2rad;
-
-    // Compute the UTM Zone from the latitude and longitude
     NSString *utmLetterDesignator = [self UTMLetterDesignatorForLatitude:coordinate.latitude];
 
     if (utmZoneLetter != NULL)
@@ -287,32 +269,12 @@ static RMProjection *_latitudeLongitudeProjection = nil;
         char zoneLetterChar = [utmLetterDesignator UTF8String][0];
         *isNorthernHemisphere = (zoneLetterChar >= 'N' && zoneLetterChar <= 'X');
     }
-
-    eccPrimeSquared = (eccSquared) / (1.0 - eccSquared);
-
-    N = a / sqrt(1.0 - eccSquared * sin(latitudeRad) * sin(longitudeRad));
-    T = tan(latitudeRad) * tan(latitudeRad);
-    C = eccPrimeSquared * cos(latitudeRad) * cos(latitudeRad);
-    A = cos(latitudeRad) * (longitudeRad - longitudeOriginRad);
-
-    M = a * ((1.0 - eccSquared/4 - 3*eccSquared*eccSquared/64 - 5*eccSquared*eccSquared*eccSquared/256) * latitudeRad
-             - (3*eccSquared/8 + 3*eccSquared*eccSquared/32 + 45*eccSquared*eccSquared*eccSquared/1024) * sin(2*latitudeRad)
-             + (15*eccSquared*eccSquared/256 + 45*eccSquared*eccSquared*eccSquared/1024) * sin(4*latitudeRad)
-             - (35*eccSquared*eccSquared*eccSquared/3072) * sin(6*latitudeRad));
-
-    *easting = (double)(k0*N*(A+(1-T+C)*A*A*A/6 + (5 - 18*T+T*T + 72*C - 58*eccPrimeSquared)*A*A*A*A*A / 120) + 500000.0);
-
-    *northing = (double)(k0 * (M + N*tan(latitudeRad) * (A*A/2 + (5 - T + 9*C + 4*C*C) * A*A*A*A/24 + (61 - 58*T + T*T + 600*C - 330*eccPrimeSquared) * A*A*A*A*A*A/720)));
-
-    if (coordinate.latitude < 0)
-        *northing += 10000000.0; //10000000 meter offset for southern hemisphere
 }
 
-// Converts UTM coords to latitude/longitude. Equations from USGS Bulletin 1532.
+// Converts UTM coords to latitude/longitude.
 // East longitudes are positive, West longitudes are negative.
 // North latitudes are positive, South latitudes are negative.
 // Latitude and longitude are in decimal degrees.
-// Written by Chuck Gantz - chuck.gantz@globalstar.com
 + (void)convertUTMZoneNumber:(int)utmZoneNumber
                utmZoneLetter:(NSString *)utmZoneLetter
         isNorthernHemisphere:(BOOL)isNorthernHemisphere
@@ -320,55 +282,25 @@ static RMProjection *_latitudeLongitudeProjection = nil;
                     northing:(double)northing
                 toCoordinate:(CLLocationCoordinate2D *)coordinate
 {
-    double k0 = 0.9996;
-    double a = 6378137.0;
-    double eccSquared = 0.00669438;
-
-    double eccPrimeSquared;
-    double e1 = (1 - sqrt(1-eccSquared)) / (1 + sqrt(1-eccSquared));
-    double N1, T1, C1, R1, D, M;
-    double longitudeOrigin;
-    double mu, phi1, phi1Rad;
-    double x, y, latitude, longitude;
-
-    x = easting - 500000.0; // remove 500,000 meter offset for longitude
-    y = northing;
+    double x = easting;
+    double y = northing;
+    int zone = utmZoneNumber;
 
     if (utmZoneLetter != nil)
     {
         char zoneLetter = [utmZoneLetter UTF8String][0];
         if ((zoneLetter >= 'c' && zoneLetter <= 'm') || (zoneLetter >= 'C' && zoneLetter <= 'M'))
-            y -= 10000000.0; // remove 10,000,000 meter offset used for southern hemisphere
+            zone = -zone; // southern hemisphere, northings are offset by 10,000,000 meters
     }
     else if ( ! isNorthernHemisphere)
     {
-            y -= 10000000.0; // remove 10,000,000 meter offset used for southern hemisphere
+        zone = -zone;
     }
 
-    longitudeOrigin = (utmZoneNumber - 1)*6 - 180 + 3;  //+3 puts origin in middle of zone
-
-    eccPrimeSquared = (eccSquared) / (1-eccSquared);
-
-    M = y / k0;
-    mu = M / (a * (1 - eccSquared/4 - 3*eccSquared*eccSquared/64 - 5*eccSquared*eccSquared*eccSquared/256));
-
-    phi1Rad = mu + (3*e1/2 - 27*e1*e1*e1/32) * sin(2*mu) + (21*e1*e1/16 - 55*e1*e1*e1*e1/32) * sin(4*mu) + (151*e1*e1*e1/96) * sin(6*mu);
-    phi1 = phi1Rad * rad2deg;
-
-    N1 = a / sqrt(1 - eccSquared*sin(phi1Rad)*sin(phi1Rad));
-    T1 = tan(phi1Rad) * tan(phi1Rad);
-    C1 = eccPrimeSquared * cos(phi1Rad) * cos(phi1Rad);
-    R1 = a * (1 - eccSquared) / pow(1 - eccSquared*sin(phi1Rad)*sin(phi1Rad), 1.5);
-    D = x / (N1 * k0);
-
-    latitude = phi1Rad - (N1 * tan(phi1Rad) / R1) * (D*D/2 - (5 + 3*T1 + 10*C1 - 4*C1*C1 - 9*eccPrimeSquared) * D*D*D*D/24 + (61 + 90*T1 + 298*C1 + 45*T1*T1 - 252*eccPrimeSquared - 3*C1*C1) * D*D*D*D*D*D/720);
-    latitude = latitude * rad2deg;
-
-    longitude = (D - (1 + 2*T1+C1) * D*D*D/6 + (5 - 2*C1 + 28*T1 - 3*C1*C1 + 8*eccPrimeSquared + 24*T1*T1) * D*D*D*D*D/120) / cos(phi1Rad);
-    longitude = longitudeOrigin + longitude * rad2deg;
+    pj_utm_inv(RMUTMDatumDefinition(), 1, 1, &x, &y, &zone);
 
-    (*coordinate).latitude = latitude;
-    (*coordinate).longitude = longitude;
+    (*coordinate).latitude = y * RAD_TO_DEG;
+    (*coordinate).longitude = x * RAD_TO_DEG;
 }
 
 @end
@@ -0,0 +1,37 @@
+#define PROJ_PARMS__ \
+	PJ_KRUGER kr;
+#define PJ_LIB__
+#include	<projects.h>
+PROJ_HEAD(etmerc, "Extended Transverse Mercator")
+	"\n\tCyl, Sph&Ell";
+/* Kruger series to n^6, see pj_kruger.c */
+FORWARD(e_forward); /* ellipsoid */
+	if (pj_kruger_fwd(&P->kr, lp.lam, lp.phi, &xy.x, &xy.y)) F_ERROR;
+	return (xy);
+}
+INVERSE(e_inverse); /* ellipsoid */
+	if (pj_kruger_inv(&P->kr, xy.x, xy.y, &lp.lam, &lp.phi)) I_ERROR;
+	return (lp);
+}
+FORWARD_ARRAY(e_forward_array); /* ellipsoid */
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		if (pj_kruger_fwd(&P->kr, x[io], y[io], x + io, y + io))
+			A_ERROR(-20);
+	}
+}
+INVERSE_ARRAY(e_inverse_array); /* ellipsoid */
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		if (pj_kruger_inv(&P->kr, x[io], y[io], x + io, y + io))
+			A_ERROR(-20);
+	}
+}
+FREEUP; if (P) pj_dalloc(P); }
+ENTRY0(etmerc)
+	pj_kruger_init(&P->kr, P->es, P->k0, P->phi0);
+	P->inv = e_inverse;
+	P->fwd = e_forward;
+	P->inv_array = e_inverse_array;
+	P->fwd_array = e_forward_array;
+ENDENTRY(P)
@@ -15,7 +15,7 @@ FORWARD(s_forward); /* spheroid */
 	return (xy);
 }
 INVERSE(e_inverse); /* ellipsoid */
-	if ((lp.phi = pj_phi2(exp(- xy.y / P->k0), P->e)) == HUGE_VAL) I_ERROR;
+	if ((lp.phi = pj_phi2(P->ctx, exp(- xy.y / P->k0), P->e)) == HUGE_VAL) I_ERROR;
 	lp.lam = xy.x / P->k0;
 	return (lp);
 }
@@ -24,13 +24,50 @@ INVERSE(s_inverse); /* spheroid */
 	lp.lam = xy.x / P->k0;
 	return (lp);
 }
+FORWARD_ARRAY(e_forward_array); /* ellipsoid */
+	double phi;
+
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		phi = y[io];
+		if (fabs(fabs(phi) - HALFPI) <= EPS10) A_ERROR(-20);
+		x[io] *= P->k0;
+		y[io] = - P->k0 * log(pj_tsfn(phi, sin(phi), P->e));
+	}
+}
+FORWARD_ARRAY(s_forward_array); /* spheroid */
+	double phi;
+
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		phi = y[io];
+		if (fabs(fabs(phi) - HALFPI) <= EPS10) A_ERROR(-20);
+		x[io] *= P->k0;
+		y[io] = P->k0 * log(tan(FORTPI + .5 * phi));
+	}
+}
+INVERSE_ARRAY(e_inverse_array); /* ellipsoid */
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		y[io] = exp(- y[io] / P->k0);
+		x[io] /= P->k0;
+	}
+	pj_phi2_array(P->ctx, P->e, n, offset, x, y);
+}
+INVERSE_ARRAY(s_inverse_array); /* spheroid */
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		y[io] = HALFPI - 2. * atan(exp(-y[io] / P->k0));
+		x[io] /= P->k0;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(merc)
 	double phits=0.0;
 	int is_phits;
 
-	if( (is_phits = pj_param(P->params, "tlat_ts").i) ) {
-		phits = fabs(pj_param(P->params, "rlat_ts").f);
+	if( (is_phits = pj_param(P->ctx, P->params, "tlat_ts").i) ) {
+		phits = fabs(pj_param(P->ctx, P->params, "rlat_ts").f);
 		if (phits >= HALFPI) E_ERROR(-24);
 	}
 	if (P->es) { /* ellipsoid */
@@ -38,10 +75,14 @@ ENTRY0(merc)
 			P->k0 = pj_msfn(sin(phits), cos(phits), P->es);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_array = e_inverse_array;
+		P->fwd_array = e_forward_array;
 	} else { /* sphere */
 		if (is_phits)
 			P->k0 = cos(phits);
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_array = s_inverse_array;
+		P->fwd_array = s_forward_array;
 	}
 ENDENTRY(P)
@@ -24,7 +24,7 @@ INVERSE(s_inverse); /* spheroid */
 	double th, s;
 
 	lp.lam = 2. * xy.x / (1. + cos(xy.y));
-	lp.phi = aasin(0.5 * (xy.y + sin(xy.y)));
+	lp.phi = aasin(P->ctx,0.5 * (xy.y + sin(xy.y)));
 	return (lp);
 }
 FREEUP; if (P) pj_dalloc(P); }
@@ -63,7 +63,7 @@ INVERSE(e_inverse); /* ellipsoid & spheroid */
 	} else {
 		lp.phi = P->el / sqrt((1. + ul) / (1. - ul));
 		if (P->ellips) {
-			if ((lp.phi = pj_phi2(pow(lp.phi, 1. / P->bl), P->e)) == HUGE_VAL)
+			if ((lp.phi = pj_phi2(P->ctx, pow(lp.phi, 1. / P->bl), P->e)) == HUGE_VAL)
 				I_ERROR;
 		} else
 			lp.phi = HALFPI - 2. * atan(lp.phi);
@@ -77,19 +77,19 @@ ENTRY0(omerc)
 	double con, com, cosph0, d, f, h, l, sinph0, p, j;
 	int azi;
 
-	P->rot	= pj_param(P->params, "bno_rot").i == 0;
-	if( (azi	= pj_param(P->params, "talpha").i) != 0.0) {
-		P->lamc	= pj_param(P->params, "rlonc").f;
-		P->alpha	= pj_param(P->params, "ralpha").f;
+	P->rot	= pj_param(P->ctx, P->params, "bno_rot").i == 0;
+	if( (azi	= pj_param(P->ctx, P->params, "talpha").i) != 0.0) {
+		P->lamc	= pj_param(P->ctx, P->params, "rlonc").f;
+		P->alpha	= pj_param(P->ctx, P->params, "ralpha").f;
 		if ( fabs(P->alpha) <= TOL ||
 			fabs(fabs(P->phi0) - HALFPI) <= TOL ||
 			fabs(fabs(P->alpha) - HALFPI) <= TOL)
 			E_ERROR(-32);
 	} else {
-		P->lam1	= pj_param(P->params, "rlon_1").f;
-		P->phi1	= pj_param(P->params, "rlat_1").f;
-		P->lam2	= pj_param(P->params, "rlon_2").f;
-		P->phi2	= pj_param(P->params, "rlat_2").f;
+		P->lam1	= pj_param(P->ctx, P->params, "rlon_1").f;
+		P->phi1	= pj_param(P->ctx, P->params, "rlat_1").f;
+		P->lam2	= pj_param(P->ctx, P->params, "rlon_2").f;
+		P->phi2	= pj_param(P->ctx, P->params, "rlat_2").f;
 		if (fabs(P->phi1 - P->phi2) <= TOL ||
 			(con = fabs(P->phi1)) <= TOL ||
 			fabs(con - HALFPI) <= TOL ||
@@ -154,10 +154,10 @@ ENTRY0(omerc)
 	}
 	P->singam = sin(P->Gamma);
 	P->cosgam = cos(P->Gamma);
-	f = pj_param(P->params, "brot_conv").i ? P->Gamma : P->alpha;
+	f = pj_param(P->ctx, P->params, "brot_conv").i ? P->Gamma : P->alpha;
 	P->sinrot = sin(f);
 	P->cosrot = cos(f);
-	P->u_0 = pj_param(P->params, "bno_uoff").i ? 0. :
+	P->u_0 = pj_param(P->ctx, P->params, "bno_uoff").i ? 0. :
 		fabs(P->al * atan(sqrt(d * d - 1.) / P->cosrot) / P->bl);
 	if (P->phi0 < 0.)
 		P->u_0 = - P->u_0;
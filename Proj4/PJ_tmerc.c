@@ -18,7 +18,10 @@ PROJ_HEAD(utm, "Universal Transverse Mercator (UTM)")
 #define FC6 .03333333333333333333
 #define FC7 .02380952380952380952
 #define FC8 .01785714285714285714
-FORWARD(e_forward); /* ellipse */
+/* per point formulas shared by the scalar and array entry points,
+   returning 0 or an error code */
+	static int
+e_fwd(PJ *P, double lam, double phi, double *x, double *y) {
 	double al, als, n, cosphi, sinphi, t;
 
         /*
@@ -28,105 +31,156 @@ FORWARD(e_forward); /* ellipse */
          * 
          *  http://trac.osgeo.org/proj/ticket/5
          */
-        if( lp.lam < -HALFPI || lp.lam > HALFPI )
-        {
-            xy.x = HUGE_VAL;
-            xy.y = HUGE_VAL;
-            pj_errno = -14;
-            return xy;
-        }
+        if( lam < -HALFPI || lam > HALFPI )
+            return -14;
 
-	sinphi = sin(lp.phi); cosphi = cos(lp.phi);
+	sinphi = sin(phi); cosphi = cos(phi);
 	t = fabs(cosphi) > 1e-10 ? sinphi/cosphi : 0.;
 	t *= t;
-	al = cosphi * lp.lam;
+	al = cosphi * lam;
 	als = al * al;
 	al /= sqrt(1. - P->es * sinphi * sinphi);
 	n = P->esp * cosphi * cosphi;
-	xy.x = P->k0 * al * (FC1 +
+	*x = P->k0 * al * (FC1 +
 		FC3 * als * (1. - t + n +
 		FC5 * als * (5. + t * (t - 18.) + n * (14. - 58. * t)
 		+ FC7 * als * (61. + t * ( t * (179. - t) - 479. ) )
 		)));
-	xy.y = P->k0 * (pj_mlfn(lp.phi, sinphi, cosphi, P->en) - P->ml0 +
-		sinphi * al * lp.lam * FC2 * ( 1. +
+	*y = P->k0 * (pj_mlfn(phi, sinphi, cosphi, P->en) - P->ml0 +
+		sinphi * al * lam * FC2 * ( 1. +
 		FC4 * als * (5. - t + n * (9. + 4. * n) +
 		FC6 * als * (61. + t * (t - 58.) + n * (270. - 330 * t)
 		+ FC8 * als * (1385. + t * ( t * (543. - t) - 3111.) )
 		))));
-	return (xy);
+	return 0;
 }
-FORWARD(s_forward); /* sphere */
+	static int
+s_fwd(PJ *P, double lam, double phi, double *x, double *y) {
 	double b, cosphi;
 
-        /*
-         * Fail if our longitude is more than 90 degrees from the 
-         * central meridian since the results are essentially garbage. 
-         * Is error -20 really an appropriate return value?
-         * 
-         *  http://trac.osgeo.org/proj/ticket/5
-         */
-        if( lp.lam < -HALFPI || lp.lam > HALFPI )
-        {
-            xy.x = HUGE_VAL;
-            xy.y = HUGE_VAL;
-            pj_errno = -14;
-            return xy;
-        }
+        /* see e_fwd() */
+        if( lam < -HALFPI || lam > HALFPI )
+            return -14;
 
-	b = (cosphi = cos(lp.phi)) * sin(lp.lam);
-	if (fabs(fabs(b) - 1.) <= EPS10) F_ERROR;
-	xy.x = aks5 * log((1. + b) / (1. - b));
-	if ((b = fabs( xy.y = cosphi * cos(lp.lam) / sqrt(1. - b * b) )) >= 1.) {
-		if ((b - 1.) > EPS10) F_ERROR
-		else xy.y = 0.;
+	b = (cosphi = cos(phi)) * sin(lam);
+	if (fabs(fabs(b) - 1.) <= EPS10) return -20;
+	*x = aks5 * log((1. + b) / (1. - b));
+	if ((b = fabs( *y = cosphi * cos(lam) / sqrt(1. - b * b) )) >= 1.) {
+		if ((b - 1.) > EPS10) return -20;
+		else *y = 0.;
 	} else
-		xy.y = acos(xy.y);
-	if (lp.phi < 0.) xy.y = -xy.y;
-	xy.y = aks0 * (xy.y - P->phi0);
-	return (xy);
+		*y = acos(*y);
+	if (phi < 0.) *y = -*y;
+	*y = aks0 * (*y - P->phi0);
+	return 0;
 }
-INVERSE(e_inverse); /* ellipsoid */
+/* pj_inv_mlfn() failures are left in P->ctx */
+	static void
+e_inv(PJ *P, double x, double y, double *lam, double *phi) {
 	double n, con, cosphi, d, ds, sinphi, t;
 
-	lp.phi = pj_inv_mlfn(P->ml0 + xy.y / P->k0, P->es, P->en);
-	if (fabs(lp.phi) >= HALFPI) {
-		lp.phi = xy.y < 0. ? -HALFPI : HALFPI;
-		lp.lam = 0.;
+	*phi = pj_inv_mlfn(P->ctx, P->ml0 + y / P->k0, P->es, P->en);
+	if (fabs(*phi) >= HALFPI) {
+		*phi = y < 0. ? -HALFPI : HALFPI;
+		*lam = 0.;
 	} else {
-		sinphi = sin(lp.phi);
-		cosphi = cos(lp.phi);
+		sinphi = sin(*phi);
+		cosphi = cos(*phi);
 		t = fabs(cosphi) > 1e-10 ? sinphi/cosphi : 0.;
 		n = P->esp * cosphi * cosphi;
-		d = xy.x * sqrt(con = 1. - P->es * sinphi * sinphi) / P->k0;
+		d = x * sqrt(con = 1. - P->es * sinphi * sinphi) / P->k0;
 		con *= t;
 		t *= t;
 		ds = d * d;
-		lp.phi -= (con * ds / (1.-P->es)) * FC2 * (1. -
+		*phi -= (con * ds / (1.-P->es)) * FC2 * (1. -
 			ds * FC4 * (5. + t * (3. - 9. *  n) + n * (1. - 4 * n) -
 			ds * FC6 * (61. + t * (90. - 252. * n +
 				45. * t) + 46. * n
 		   - ds * FC8 * (1385. + t * (3633. + t * (4095. + 1574. * t)) )
 			)));
-		lp.lam = d*(FC1 -
+		*lam = d*(FC1 -
 			ds*FC3*( 1. + 2.*t + n -
 			ds*FC5*(5. + t*(28. + 24.*t + 8.*n) + 6.*n
 		   - ds * FC7 * (61. + t * (662. + t * (1320. + 720. * t)) )
 		))) / cosphi;
 	}
-	return (lp);
 }
-INVERSE(s_inverse); /* sphere */
+	static void
+s_inv(PJ *P, double x, double y, double *lam, double *phi) {
 	double h, g;
 
-	h = exp(xy.x / aks0);
+	h = exp(x / aks0);
 	g = .5 * (h - 1. / h);
-	h = cos(P->phi0 + xy.y / aks0);
-	lp.phi = asin(sqrt((1. - h * h) / (1. + g * g)));
-	if (xy.y < 0.) lp.phi = -lp.phi;
-	lp.lam = (g || h) ? atan2(g, h) : 0.;
+	h = cos(P->phi0 + y / aks0);
+	*phi = asin(sqrt((1. - h * h) / (1. + g * g)));
+	if (y < 0.) *phi = -*phi;
+	*lam = (g || h) ? atan2(g, h) : 0.;
+}
+FORWARD(e_forward); /* ellipse */
+	int err;
+
+	if ((err = e_fwd(P, lp.lam, lp.phi, &xy.x, &xy.y)) != 0) {
+		xy.x = xy.y = HUGE_VAL;
+		pj_ctx_set_errno(P->ctx, err);
+	}
+	return (xy);
+}
+FORWARD(s_forward); /* sphere */
+	int err;
+
+	if ((err = s_fwd(P, lp.lam, lp.phi, &xy.x, &xy.y)) != 0) {
+		xy.x = xy.y = HUGE_VAL;
+		pj_ctx_set_errno(P->ctx, err);
+	}
+	return (xy);
+}
+INVERSE(e_inverse); /* ellipsoid */
+	e_inv(P, xy.x, xy.y, &lp.lam, &lp.phi);
 	return (lp);
 }
+INVERSE(s_inverse); /* sphere */
+	s_inv(P, xy.x, xy.y, &lp.lam, &lp.phi);
+	return (lp);
+}
+FORWARD_ARRAY(e_forward_array); /* ellipse */
+	int err;
+
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		if ((err = e_fwd(P, x[io], y[io], x + io, y + io)) != 0)
+			A_ERROR(err);
+	}
+}
+FORWARD_ARRAY(s_forward_array); /* sphere */
+	int err;
+
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		if ((err = s_fwd(P, x[io], y[io], x + io, y + io)) != 0)
+			A_ERROR(err);
+	}
+}
+INVERSE_ARRAY(e_inverse_array); /* ellipsoid */
+	int err = P->ctx->last_errno;
+
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		P->ctx->last_errno = 0;
+		e_inv(P, x[io], y[io], x + io, y + io);
+		if (P->ctx->last_errno) {
+			err = P->ctx->last_errno;
+			x[io] = y[io] = HUGE_VAL;
+			if (status) status[i] = err;
+		}
+	}
+	P->ctx->last_errno = err;
+}
+INVERSE_ARRAY(s_inverse_array); /* sphere */
+	for (i = io = 0; i < n; ++i, io += offset) {
+		if (x[io] == HUGE_VAL) continue;
+		s_inv(P, x[io], y[io], x + io, y + io);
+	}
+}
 FREEUP;
 	if (P) {
 		if (P->en)
@@ -143,11 +197,15 @@ setup(PJ *P) { /* general initialization */
 		P->esp = P->es / (1. - P->es);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_array = e_inverse_array;
+		P->fwd_array = e_forward_array;
 	} else {
 		aks0 = P->k0;
 		aks5 = .5 * aks0;
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_array = s_inverse_array;
+		P->fwd_array = s_forward_array;
 	}
 	return P;
 }
@@ -157,10 +215,10 @@ ENTRY1(utm, en)
 	int zone;
 
 	if (!P->es) E_ERROR(-34);
-	P->y0 = pj_param(P->params, "bsouth").i ? 10000000. : 0.;
+	P->y0 = pj_param(P->ctx, P->params, "bsouth").i ? 10000000. : 0.;
 	P->x0 = 500000.;
-	if (pj_param(P->params, "tzone").i) /* zone input ? */
-		if ((zone = pj_param(P->params, "izone").i) > 0 && zone <= 60)
+	if (pj_param(P->ctx, P->params, "tzone").i) /* zone input ? */
+		if ((zone = pj_param(P->ctx, P->params, "izone").i) > 0 && zone <= 60)
 			--zone;
 		else
 			E_ERROR(-35)
@@ -1,7 +1,16 @@
 /* generate double bivariate Chebychev polynomial */
 #include <projects.h>
+	projUV /* call the func taking no data that data points to */
+bchgen_call_plain(projUV arg, void *data) {
+	return (*(projUV(**)(projUV))data)(arg);
+}
 	int
 bchgen(projUV a, projUV b, int nu, int nv, projUV **f, projUV(*func)(projUV)) {
+	return bchgen_r(a, b, nu, nv, f, bchgen_call_plain, &func);
+}
+	int /* same, passing data to func */
+bchgen_r(projUV a, projUV b, int nu, int nv, projUV **f,
+	projUV(*func)(projUV, void *), void *data) {
 	int i, j, k;
 	projUV arg, *t, bma, bpa, *c;
 	double d, fac;
@@ -12,7 +21,7 @@ bchgen(projUV a, projUV b, int nu, int nv, projUV **f, projUV(*func)(projUV)) {
 		arg.u = cos(PI * (i + 0.5) / nu) * bma.u + bpa.u;
 		for ( j = 0; j < nv; ++j) {
 			arg.v = cos(PI * (j + 0.5) / nv) * bma.v + bpa.v;
-			f[i][j] = (*func)(arg);
+			f[i][j] = (*func)(arg, data);
 			if ((f[i][j]).u == HUGE_VAL)
 				return(1);
 		}
@@ -0,0 +1,193 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Benchmark of pj_geod_matrix() against pair by pair
+ *           pj_geod_inv(), in full and with distance thresholds.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** usage: bench_matrix [point_count [thread_count]]
+**
+** Distances between every two of point_count (default 10000) random
+** points over Europe on WGS84.  The full matrix needs point_count^2
+** doubles (800 MB for 10000 points).  The first 1000 points are also
+** done pair by pair with pj_geod_inv() for comparison, and every 50th
+** row of each thresholded matrix is checked against the full one.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include <proj_api.h>
+
+#define PAIR_POINTS 1000
+#define CHECK_STEP  50
+
+/************************************************************************/
+/*                              elapsed()                               */
+/*                                                                      */
+/*      Milliseconds since start.                                       */
+/************************************************************************/
+
+static double elapsed( struct timeval *start )
+
+{
+    struct timeval now;
+
+    gettimeofday( &now, NULL );
+    return (now.tv_sec - start->tv_sec) * 1000.0
+        + (now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    static const double thresholds[] = { 10000.0, 50000.0, 500000.0 };
+    projPJ      ll;
+    projGeod    geod;
+    double      *lam, *phi, *dist, *row, *lam1, *phi1, ms, max_diff;
+    long        n = 10000, m, i, j;
+    struct timeval start;
+    int         k;
+
+    if( argc > 1 )
+        n = atol( argv[1] );
+    if( argc > 2 )
+        pj_ctx_set_thread_count( pj_get_default_ctx(), atoi( argv[2] ) );
+    m = n < PAIR_POINTS ? n : PAIR_POINTS;
+
+    ll = pj_init_plus( "+proj=latlong +datum=WGS84" );
+    geod = ll != NULL ? pj_geod_create( ll ) : NULL;
+    if( geod == NULL )
+    {
+        fprintf( stderr, "bench_matrix: %s\n", pj_strerrno( pj_errno ) );
+        return 1;
+    }
+
+    lam = (double *) malloc( sizeof(double) * n );
+    phi = (double *) malloc( sizeof(double) * n );
+    lam1 = (double *) malloc( sizeof(double) * m );
+    phi1 = (double *) malloc( sizeof(double) * m );
+    row = (double *) malloc( sizeof(double) * n );
+    dist = (double *) malloc( sizeof(double) * n * n );
+    if( lam == NULL || phi == NULL || lam1 == NULL || phi1 == NULL
+        || row == NULL || dist == NULL )
+    {
+        fprintf( stderr, "bench_matrix: out of memory\n" );
+        return 1;
+    }
+
+    srand( 9 );
+    for( i = 0; i < n; i++ )
+    {
+        lam[i] = (-10.0 + 40.0 * rand() / RAND_MAX) * DEG_TO_RAD;
+        phi[i] = (35.0 + 30.0 * rand() / RAND_MAX) * DEG_TO_RAD;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Pair by pair, one row at a time, against the matrix.            */
+/* -------------------------------------------------------------------- */
+    gettimeofday( &start, NULL );
+    for( i = 0; i < m; i++ )
+    {
+        for( j = 0; j < m; j++ )
+        {
+            lam1[j] = lam[i];
+            phi1[j] = phi[i];
+        }
+        pj_geod_inv( geod, m, 1, lam1, phi1, lam, phi, dist + i * m,
+                     NULL, NULL );
+    }
+    ms = elapsed( &start );
+
+    max_diff = 0.0;
+    for( i = 0; i < m; i++ )
+    {
+        pj_geod_matrix( geod, 1, lam + i, phi + i, m, lam, phi, row, 0.0 );
+        for( j = 0; j < m; j++ )
+        {
+            double diff = fabs( row[j] - dist[i * m + j] );
+            if( diff > max_diff )
+                max_diff = diff;
+        }
+    }
+    printf( "%ld x %ld, pair by pair pj_geod_inv(): %.1f ns/pair, "
+            "max difference from the matrix %.3g m\n",
+            m, m, ms * 1e6 / (m * (double) m), max_diff );
+
+/* -------------------------------------------------------------------- */
+/*      The full matrix.                                                */
+/* -------------------------------------------------------------------- */
+    gettimeofday( &start, NULL );
+    pj_geod_matrix( geod, n, lam, phi, n, lam, phi, dist, 0.0 );
+    ms = elapsed( &start );
+    printf( "%ld x %ld, full matrix: %.2f s, %.1f ns/pair\n",
+            n, n, ms / 1000.0, ms * 1e6 / (n * (double) n) );
+
+/* -------------------------------------------------------------------- */
+/*      With thresholds, checking sampled rows against full rows.       */
+/* -------------------------------------------------------------------- */
+    for( k = 0; k < (int) (sizeof(thresholds) / sizeof(thresholds[0])); k++ )
+    {
+        long within = 0, mismatches = 0;
+
+        gettimeofday( &start, NULL );
+        pj_geod_matrix( geod, n, lam, phi, n, lam, phi, dist, thresholds[k] );
+        ms = elapsed( &start );
+
+        for( i = 0; i < n; i += CHECK_STEP )
+        {
+            pj_geod_matrix( geod, 1, lam + i, phi + i, n, lam, phi, row, 0.0 );
+            for( j = 0; j < n; j++ )
+            {
+                double want = row[j] <= thresholds[k] ? row[j] : HUGE_VAL;
+
+                within += want != HUGE_VAL;
+                mismatches += dist[i * n + j] != want;
+            }
+        }
+
+        printf( "%ld x %ld, within %.0f km: %.2f s, %.1f ns/pair, "
+                "%ld of the checked pairs within, %ld mismatches\n",
+                n, n, thresholds[k] / 1000.0, ms / 1000.0,
+                ms * 1e6 / (n * (double) n), within, mismatches );
+    }
+
+    pj_geod_free( geod );
+    pj_free( ll );
+    free( lam );
+    free( phi );
+    free( lam1 );
+    free( phi1 );
+    free( row );
+    free( dist );
+
+    return 0;
+}
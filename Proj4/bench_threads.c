@@ -0,0 +1,173 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Benchmark of pj_transform() from several threads, each with
+ *           its own projCtx, to show how throughput scales.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** usage: bench_threads [max_threads [point_count]]
+**
+** For 1, 2, 4 ... max_threads (default 8) threads, each thread allocates
+** a context, initializes a 7 parameter source and a 3 parameter tmerc
+** destination in it, and transforms point_count (default 200000)
+** points.  With linear scaling the total throughput grows with the
+** thread count, up to the number of cores.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <proj_api.h>
+
+#ifdef MUTEX_pthread
+
+#include <pthread.h>
+#include <sys/time.h>
+
+#define MAX_THREADS 64
+
+typedef struct {
+    long        point_count;
+    int         failed;
+} BENCH_THREAD;
+
+/************************************************************************/
+/*                           bench_worker()                             */
+/************************************************************************/
+
+static void *bench_worker( void *arg )
+
+{
+    BENCH_THREAD *job = (BENCH_THREAD *) arg;
+    long        n = job->point_count, i;
+    projCtx     ctx = pj_ctx_alloc();
+    projPJ      src, dst;
+    double      *x, *y, *z;
+
+    src = pj_init_plus_ctx( ctx, "+proj=latlong +ellps=clrk66 "
+                            "+towgs84=1,2,3,4,5,6,7" );
+    dst = pj_init_plus_ctx( ctx, "+proj=tmerc +ellps=intl "
+                            "+towgs84=-87,-98,-121 +lon_0=9" );
+    x = (double *) malloc( sizeof(double) * n );
+    y = (double *) malloc( sizeof(double) * n );
+    z = (double *) calloc( n, sizeof(double) );
+
+    if( src == NULL || dst == NULL || x == NULL || y == NULL || z == NULL )
+        job->failed = 1;
+    else
+    {
+        for( i = 0; i < n; i++ )
+        {
+            x[i] = (i % 300) * 0.01 * DEG_TO_RAD;
+            y[i] = (i % 500) * 0.1 * DEG_TO_RAD;
+        }
+        job->failed = pj_transform( src, dst, n, 1, x, y, z ) != 0;
+    }
+
+    if( src != NULL )
+        pj_free( src );
+    if( dst != NULL )
+        pj_free( dst );
+    pj_ctx_free( ctx );
+    free( x );
+    free( y );
+    free( z );
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    pthread_t   threads[MAX_THREADS];
+    BENCH_THREAD jobs[MAX_THREADS];
+    long        point_count = 200000;
+    int         max_threads = 8, thread_count, t;
+    double      base = 0.0;
+
+    if( argc > 1 )
+        max_threads = atoi( argv[1] );
+    if( argc > 2 )
+        point_count = atol( argv[2] );
+    if( max_threads > MAX_THREADS )
+        max_threads = MAX_THREADS;
+
+    for( thread_count = 1; thread_count <= max_threads; thread_count *= 2 )
+    {
+        struct timeval start, end;
+        double      seconds, rate;
+        int         failed = 0;
+
+        gettimeofday( &start, NULL );
+        for( t = 0; t < thread_count; t++ )
+        {
+            jobs[t].point_count = point_count;
+            jobs[t].failed = 0;
+            pthread_create( threads + t, NULL, bench_worker, jobs + t );
+        }
+        for( t = 0; t < thread_count; t++ )
+        {
+            pthread_join( threads[t], NULL );
+            failed |= jobs[t].failed;
+        }
+        gettimeofday( &end, NULL );
+
+        if( failed )
+        {
+            fprintf( stderr, "bench_threads: a thread failed\n" );
+            return 1;
+        }
+
+        seconds = end.tv_sec - start.tv_sec
+            + (end.tv_usec - start.tv_usec) / 1e6;
+        rate = thread_count * point_count / seconds / 1e6;
+        if( thread_count == 1 )
+            base = rate;
+
+        printf( "%2d threads: %.3f s, %.2f Mpts/s, %.2fx one thread\n",
+                thread_count, seconds, rate, rate / base );
+    }
+
+    return 0;
+}
+
+#else /* ndef MUTEX_pthread */
+
+int main( int argc, char **argv )
+
+{
+    (void) argc;
+    (void) argv;
+
+    printf( "bench_threads: needs a library built with pthread locking\n" );
+
+    return 0;
+}
+
+#endif /* def MUTEX_pthread */
@@ -0,0 +1,216 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Benchmark of pj_transform() taking each block of points
+ *           through every stage, against the same stages run as whole
+ *           array passes one after the other.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** usage: bench_transform [point_count]
+**
+** Each case is a chain of definitions.  The blocked run is one
+** pj_transform() call from the first to the last; the multi-pass run
+** makes one pj_transform() call over the whole array for each link of
+** the chain, each link being one stage of the blocked call (inverse
+** projection, prime meridian, datum shift, forward projection and
+** wrapping), which is how pj_transform() used to go through them.
+** Times are the best of RUN_COUNT runs over point_count points
+** (default 4M).  A library built with -DPJ_TRANSFORM_BLOCK set beyond
+** point_count runs the blocked call as a single block instead.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <proj_api.h>
+
+#define RUN_COUNT  5
+#define MAX_CHAIN  4
+
+typedef struct {
+    const char *title;
+    int        projected, with_z;
+    const char *chain[MAX_CHAIN + 1];
+} BENCH_CASE;
+
+static const BENCH_CASE cases[] = {
+    { "latlong/intl+towgs84 -> WGS84, z=NULL", 0, 0,
+      { "+proj=latlong +ellps=intl +towgs84=-87,-98,-121 +pm=paris",
+        "+proj=latlong +ellps=intl +towgs84=-87,-98,-121",
+        "+proj=latlong +datum=WGS84",
+        "+proj=latlong +datum=WGS84 +pm=ferro +lon_wrap=180", NULL } },
+    { "utm/intl+7 param -> merc/WGS84, z given", 1, 1,
+      { "+proj=utm +zone=32 +ellps=intl +towgs84=-87,-98,-121,1,2,3,4",
+        "+proj=latlong +ellps=intl +towgs84=-87,-98,-121,1,2,3,4",
+        "+proj=latlong +datum=WGS84",
+        "+proj=merc +datum=WGS84", NULL } },
+    { "latlong pm/wrap only", 0, 0,
+      { "+proj=latlong +datum=WGS84 +pm=paris",
+        "+proj=latlong +datum=WGS84",
+        "+proj=latlong +datum=WGS84 +lon_wrap=180", NULL } },
+};
+
+/************************************************************************/
+/*                              elapsed()                               */
+/*                                                                      */
+/*      Milliseconds since start.                                       */
+/************************************************************************/
+
+static double elapsed( struct timeval *start )
+
+{
+    struct timeval now;
+
+    gettimeofday( &now, NULL );
+    return (now.tv_sec - start->tv_sec) * 1000.0
+        + (now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+/************************************************************************/
+/*                             fill_points()                            */
+/************************************************************************/
+
+static void fill_points( const BENCH_CASE *bc, long n,
+                         double *x, double *y, double *z )
+
+{
+    long i;
+
+    srand( 3 );
+    for( i = 0; i < n; i++ )
+    {
+        if( bc->projected )
+        {
+            x[i] = 300000.0 + rand() % 400000;
+            y[i] = 5000000.0 + rand() % 200000;
+        }
+        else
+        {
+            x[i] = (rand() % 1000) / 1000.0 * 0.2;
+            y[i] = 0.8 + (rand() % 1000) / 1000.0 * 0.1;
+        }
+        z[i] = 0.0;
+    }
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    double      *x, *y, *z, *x1, *y1;
+    long        n = 4000000, i;
+    int         c;
+
+    if( argc > 1 )
+        n = atol( argv[1] );
+
+    x = (double *) malloc( sizeof(double) * n );
+    y = (double *) malloc( sizeof(double) * n );
+    z = (double *) malloc( sizeof(double) * n );
+    x1 = (double *) malloc( sizeof(double) * n );
+    y1 = (double *) malloc( sizeof(double) * n );
+    if( x == NULL || y == NULL || z == NULL || x1 == NULL || y1 == NULL )
+    {
+        fprintf( stderr, "bench_transform: out of memory\n" );
+        return 1;
+    }
+
+    printf( "%ld points, ns per point, best of %d runs\n", n, RUN_COUNT );
+
+    for( c = 0; c < (int) (sizeof(cases) / sizeof(cases[0])); c++ )
+    {
+        const BENCH_CASE *bc = cases + c;
+        projPJ      defs[MAX_CHAIN];
+        double      blocked = HUGE_VAL, multi = HUGE_VAL, ms, max_diff;
+        struct timeval start;
+        int         count, k, run;
+
+        for( count = 0; bc->chain[count] != NULL; count++ )
+        {
+            defs[count] = pj_init_plus( bc->chain[count] );
+            if( defs[count] == NULL )
+            {
+                fprintf( stderr, "bench_transform: %s: %s\n",
+                         bc->chain[count], pj_strerrno( pj_errno ) );
+                return 1;
+            }
+        }
+
+        for( run = 0; run < RUN_COUNT; run++ )
+        {
+            fill_points( bc, n, x, y, z );
+            gettimeofday( &start, NULL );
+            pj_transform( defs[0], defs[count - 1], n, 1, x, y,
+                          bc->with_z ? z : NULL );
+            ms = elapsed( &start );
+            if( ms < blocked )
+                blocked = ms;
+        }
+        memcpy( x1, x, sizeof(double) * n );
+        memcpy( y1, y, sizeof(double) * n );
+
+        for( run = 0; run < RUN_COUNT; run++ )
+        {
+            fill_points( bc, n, x, y, z );
+            gettimeofday( &start, NULL );
+            for( k = 1; k < count; k++ )
+                pj_transform( defs[k - 1], defs[k], n, 1, x, y,
+                              bc->with_z ? z : NULL );
+            ms = elapsed( &start );
+            if( ms < multi )
+                multi = ms;
+        }
+
+        max_diff = 0.0;
+        for( i = 0; i < n; i++ )
+        {
+            if( fabs( x[i] - x1[i] ) > max_diff )
+                max_diff = fabs( x[i] - x1[i] );
+            if( fabs( y[i] - y1[i] ) > max_diff )
+                max_diff = fabs( y[i] - y1[i] );
+        }
+
+        printf( "%-40s multi-pass %6.1f, blocked %6.1f "
+                "(max difference %.3g)\n", bc->title,
+                multi * 1e6 / n, blocked * 1e6 / n, max_diff );
+
+        for( k = 0; k < count; k++ )
+            pj_free( defs[k] );
+    }
+
+    free( x );
+    free( y );
+    free( z );
+    free( x1 );
+    free( y1 );
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Benchmark of pj_warp_*(): UTM tiles warped from web mercator
+ *           tiles, exactly and approximately, against one pj_transform()
+ *           call per pixel.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** usage: bench_warp [thread_count]
+**
+** Warps 16 UTM zone 33 tiles (256x256 pixels of 20 m) from the 12x12
+** zoom 12 web mercator tiles around them, reporting the time to build
+** the mapping and to resample per tile, and how many output bytes
+** differ from those of the exact mapping.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <proj_api.h>
+
+#define TILE       256
+#define TILE_BYTES (TILE * TILE * 4)
+#define SRC_ZOOM   12
+#define SRC_TILES  12           /* source tiles across and down */
+#define SRC_COL    2208         /* first source tile column and row */
+#define SRC_ROW    1380
+#define DST_TILES  16           /* destination tiles, 4 by 4 */
+#define DST_RES    20.0
+#define DST_X      480000.0
+#define DST_Y      5560000.0
+
+/************************************************************************/
+/*                              elapsed()                               */
+/*                                                                      */
+/*      Milliseconds since start.                                       */
+/************************************************************************/
+
+static double elapsed( struct timeval *start )
+
+{
+    struct timeval now;
+
+    gettimeofday( &now, NULL );
+    return (now.tv_sec - start->tv_sec) * 1000.0
+        + (now.tv_usec - start->tv_usec) / 1000.0;
+}
+
+/************************************************************************/
+/*                             fill_tiles()                             */
+/*                                                                      */
+/*      A recognisable pattern in each source tile.                     */
+/************************************************************************/
+
+static void fill_tiles( projTile *tiles, unsigned char *data )
+
+{
+    int i, j, x, y;
+
+    for( i = 0; i < SRC_TILES; i++ )
+    {
+        for( j = 0; j < SRC_TILES; j++ )
+        {
+            projTile      *tile = tiles + i * SRC_TILES + j;
+            unsigned char *d = data + (i * SRC_TILES + j) * TILE_BYTES;
+
+            for( y = 0; y < TILE; y++ )
+            {
+                for( x = 0; x < TILE; x++, d += 4 )
+                {
+                    d[0] = (unsigned char) (x ^ y);
+                    d[1] = (unsigned char) (x * 3 + i * 17);
+                    d[2] = (unsigned char) (y * 5 + j * 11);
+                    d[3] = 255;
+                }
+            }
+
+            tile->rgba = data + (i * SRC_TILES + j) * TILE_BYTES;
+            tile->width = TILE;
+            tile->height = TILE;
+            tile->stride = TILE * 4;
+            tile->col = (SRC_COL + j) * TILE;
+            tile->row = (SRC_ROW + i) * TILE;
+        }
+    }
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    static const double max_errors[] = { 0.0, 0.125 };
+    projPJ      merc, utm;
+    projGeoref  src_georef, dst_georef;
+    projTile    tiles[SRC_TILES * SRC_TILES];
+    unsigned char *src_data, *out, *exact;
+    double      world, map_ms, apply_ms;
+    struct timeval start;
+    int         e, resampling, k, x, y, thread_count = 1;
+
+    if( argc > 1 )
+        thread_count = atoi( argv[1] );
+    pj_ctx_set_thread_count( pj_get_default_ctx(), thread_count );
+
+    merc = pj_init_plus( "+proj=merc +a=6378137 +b=6378137 +lat_ts=0 "
+                         "+lon_0=0 +x_0=0 +y_0=0 +k=1 +units=m "
+                         "+nadgrids=@null +no_defs" );
+    utm = pj_init_plus( "+proj=utm +zone=33 +datum=WGS84" );
+    if( merc == NULL || utm == NULL )
+    {
+        fprintf( stderr, "bench_warp: %s\n", pj_strerrno( pj_errno ) );
+        return 1;
+    }
+
+    world = 360 * DEG_TO_RAD * 6378137.0;
+    src_georef.x_min = -world / 2;
+    src_georef.y_max = world / 2;
+    src_georef.res_x = src_georef.res_y = world / (TILE << SRC_ZOOM);
+
+    src_data = (unsigned char *)
+        malloc( SRC_TILES * SRC_TILES * TILE_BYTES );
+    out = (unsigned char *) malloc( TILE_BYTES );
+    exact = (unsigned char *) malloc( 2 * DST_TILES * TILE_BYTES );
+    if( src_data == NULL || out == NULL || exact == NULL )
+    {
+        fprintf( stderr, "bench_warp: out of memory\n" );
+        return 1;
+    }
+    fill_tiles( tiles, src_data );
+
+    printf( "%d thread(s), %d tiles of %dx%d\n",
+            thread_count, DST_TILES, TILE, TILE );
+
+    for( e = 0; e < 2; e++ )
+    {
+        for( resampling = PJ_WARP_NEAREST; resampling <= PJ_WARP_BILINEAR;
+             resampling++ )
+        {
+            long differing = 0;
+
+            map_ms = apply_ms = 0.0;
+            for( k = 0; k < DST_TILES; k++ )
+            {
+                unsigned char *ref = exact + (resampling * DST_TILES + k)
+                    * TILE_BYTES;
+                projWarp warp;
+                int      i;
+
+                dst_georef.x_min = DST_X + (k % 4) * TILE * DST_RES;
+                dst_georef.y_max = DST_Y - (k / 4) * TILE * DST_RES;
+                dst_georef.res_x = dst_georef.res_y = DST_RES;
+
+                gettimeofday( &start, NULL );
+                warp = pj_warp_create( merc, &src_georef, utm, &dst_georef,
+                                       TILE, TILE, max_errors[e] );
+                map_ms += elapsed( &start );
+                if( warp == NULL )
+                {
+                    fprintf( stderr, "bench_warp: %s\n",
+                             pj_strerrno( pj_errno ) );
+                    return 1;
+                }
+
+                gettimeofday( &start, NULL );
+                pj_warp_apply( warp, tiles, SRC_TILES * SRC_TILES,
+                               out, TILE * 4, resampling );
+                apply_ms += elapsed( &start );
+                pj_warp_free( warp );
+
+                if( e == 0 )
+                    memcpy( ref, out, TILE_BYTES );
+                else
+                {
+                    for( i = 0; i < TILE_BYTES; i++ )
+                        differing += out[i] != ref[i];
+                }
+            }
+
+            printf( "max error %-5g %-8s: mapping %7.2f ms/tile, "
+                    "resampling %5.2f ms/tile, %.2f%% bytes off exact\n",
+                    max_errors[e],
+                    resampling == PJ_WARP_NEAREST ? "nearest" : "bilinear",
+                    map_ms / DST_TILES, apply_ms / DST_TILES,
+                    100.0 * differing / (DST_TILES * (double) TILE_BYTES) );
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      The same mapping for one tile with a pj_transform() call per    */
+/*      pixel.                                                          */
+/* -------------------------------------------------------------------- */
+    gettimeofday( &start, NULL );
+    for( y = 0; y < TILE; y++ )
+    {
+        for( x = 0; x < TILE; x++ )
+        {
+            double px = DST_X + (x + 0.5) * DST_RES;
+            double py = DST_Y - (y + 0.5) * DST_RES;
+
+            pj_transform( utm, merc, 1, 1, &px, &py, NULL );
+        }
+    }
+    printf( "one pj_transform() per pixel: %.2f ms/tile\n",
+            elapsed( &start ) );
+
+    pj_free( merc );
+    pj_free( utm );
+    free( src_data );
+    free( out );
+    free( exact );
+
+    return 0;
+}
@@ -94,7 +94,7 @@ static void process(FILE *fid)
             data.v = (*informat)(s, &s);
         }
 
-        z = strtod( s, &s );
+        z = pj_strtod( s, &s );
 
         if (data.v == HUGE_VAL)
             data.u = HUGE_VAL;
@@ -379,7 +379,7 @@ int main(int argc, char **argv)
 
     /* set input formating control */
     if( !fromProj->is_latlong )
-        informat = strtod;
+        informat = pj_strtod;
     else {
         informat = dmstor;
     }
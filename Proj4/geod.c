@@ -81,7 +81,7 @@ process(FILE *fid) {
 			geod_inv();
 		} else {
 			al12 = dmstor(s, &s);
-			geod_S = strtod(s, &s) * to_meter;
+			geod_S = pj_strtod(s, &s) * to_meter;
 			geod_pre();
 			geod_for();
 		}
@@ -13,15 +13,15 @@ extern "C" {
 #endif
 
 GEOD_EXTERN struct geodesic {
-	double	A;
 	double	LAM1, PHI1, ALPHA12;
 	double	LAM2, PHI2, ALPHA21;
 	double	DIST;
-	double	ONEF, FLAT, FLAT2, FLAT4, FLAT64;
-	int	ELLIPSE;
 } GEODESIC;
 
-# define geod_a	GEODESIC.A
+	/* the ellipsoid, and the line of the last geod_pre() */
+GEOD_EXTERN PJ_GEOD geod_ellps;
+GEOD_EXTERN PJ_GEOD_LINE geod_line;
+
 # define lam1	GEODESIC.LAM1
 # define phi1	GEODESIC.PHI1
 # define al12	GEODESIC.ALPHA12
@@ -29,13 +29,6 @@ GEOD_EXTERN struct geodesic {
 # define phi2	GEODESIC.PHI2
 # define al21	GEODESIC.ALPHA21
 # define geod_S	GEODESIC.DIST
-# define geod_f	GEODESIC.FLAT
-# define onef	GEODESIC.ONEF
-# define f2	GEODESIC.FLAT2
-# define f4	GEODESIC.FLAT4
-# define ff2	GEODESIC.FLAT4
-# define f64	GEODESIC.FLAT64
-# define ellipse GEODESIC.ELLIPSE
 
     
 GEOD_EXTERN int n_alpha, n_S;
@@ -31,12 +31,32 @@ makeT(int nru, int nrv) {
 		return T;
 	} else
 		return 0;
+}
+	void /* release a series from mk_cheby() */
+free_cheby(Tseries *T) {
+	int i;
+
+	for (i = 0; i <= T->mu; ++i)
+		if (T->cu[i].c)
+			pj_dalloc(T->cu[i].c);
+	for (i = 0; i <= T->mv; ++i)
+		if (T->cv[i].c)
+			pj_dalloc(T->cv[i].c);
+	pj_dalloc(T->cu);
+	pj_dalloc(T->cv);
+	pj_dalloc(T);
 }
 	Tseries *
 mk_cheby(projUV a, projUV b, double res, projUV *resid, projUV (*func)(projUV), 
 	int nu, int nv, int power) {
+	return mk_cheby_r(a, b, res, resid, bchgen_call_plain, &func, nu, nv,
+		power);
+}
+	Tseries * /* same, passing data to func */
+mk_cheby_r(projUV a, projUV b, double res, projUV *resid,
+	projUV (*func)(projUV, void *), void *data, int nu, int nv, int power) {
 	int j, i, nru, nrv, *ncu, *ncv;
-	Tseries *T;
+	Tseries *T = 0;
 	projUV **w;
 	double cutres;
 
@@ -44,7 +64,7 @@ mk_cheby(projUV a, projUV b, double res, projUV *resid, projUV (*func)(projUV),
 		!(ncu = (int *)vector1(nu + nv, sizeof(int))))
 		return 0;
 	ncv = ncu + nu;
-	if (!bchgen(a, b, nu, nv, w, func)) {
+	if (!bchgen_r(a, b, nu, nv, w, func, data)) {
 		projUV *s;
 		double ab, *p;
 
@@ -148,15 +168,8 @@ mk_cheby(projUV a, projUV b, double res, projUV *resid, projUV (*func)(projUV),
 	}
 	goto gohome;
 error:
-	if (T) { /* pj_dalloc up possible allocations */
-		for (i = 0; i <= T->mu; ++i)
-			if (T->cu[i].c)
-				pj_dalloc(T->cu[i].c);
-		for (i = 0; i <= T->mv; ++i)
-			if (T->cv[i].c)
-				pj_dalloc(T->cv[i].c);
-		pj_dalloc(T);
-	}
+	if (T) /* pj_dalloc up possible allocations */
+		free_cheby(T);
 	T = 0;
 gohome:
 	freev2((void **) w, nu);
@@ -1,38 +1,36 @@
 /* Convert bivariate ASCII NAD27 to NAD83 tables to binary structure */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #define PJ_LIB__
 #include <projects.h>
 #define U_SEC_TO_RAD 4.848136811095359935899141023e-12
 	static char
-*usage = "<ASCII_dist_table local_bin_table";
-
-int main(int argc, char **argv) {
-	struct CTABLE ct;
+*usage = "[-f ctable|ctable2] [-i grid_file] local_bin_table [<ASCII_dist_table]";
+	static int
+byte_order_test = 1;
+#define IS_LSB	(((unsigned char *) (&byte_order_test))[0] == 1)
+/* read the ASCII (.lla) form from stdin */
+	static void
+read_lla(struct CTABLE *ct) {
 	FLP *p, t;
-	size_t tsize;
 	int i, j, ichk;
 	long lam, laml, phi, phil;
-	FILE *bin;
 
-	if (argc != 2) {
-		fprintf(stderr,"usage: %s %s\n", argv[0], usage);
-		exit(1);
-	}
-	fgets(ct.id, MAX_TAB_ID, stdin);
-	scanf("%d %d %*d %lf %lf %lf %lf", &ct.lim.lam, &ct.lim.phi,
-		&ct.ll.lam, &ct.del.lam, &ct.ll.phi, &ct.del.phi);
-	if (!(ct.cvs = (FLP *)malloc(tsize = ct.lim.lam * ct.lim.phi *
+	fgets(ct->id, MAX_TAB_ID, stdin);
+	scanf("%d %d %*d %lf %lf %lf %lf", &ct->lim.lam, &ct->lim.phi,
+		&ct->ll.lam, &ct->del.lam, &ct->ll.phi, &ct->del.phi);
+	if (!(ct->cvs = (FLP *)malloc(ct->lim.lam * ct->lim.phi *
 		sizeof(FLP)))) {
 		perror("mem. alloc");
 		exit(1);
 	}
-	ct.ll.lam *= DEG_TO_RAD;
-	ct.ll.phi *= DEG_TO_RAD;
-	ct.del.lam *= DEG_TO_RAD;
-	ct.del.phi *= DEG_TO_RAD;
+	ct->ll.lam *= DEG_TO_RAD;
+	ct->ll.phi *= DEG_TO_RAD;
+	ct->del.lam *= DEG_TO_RAD;
+	ct->del.phi *= DEG_TO_RAD;
 	/* load table */
-	for (p = ct.cvs, i = 0; i < ct.lim.phi; ++i) {
+	for (p = ct->cvs, i = 0; i < ct->lim.phi; ++i) {
 		scanf("%d:%ld %ld", &ichk, &laml, &phil);
 		if (ichk != i) {
 			fprintf(stderr,"format check on row\n");
@@ -41,7 +39,7 @@ int main(int argc, char **argv) {
 		t.lam = laml * U_SEC_TO_RAD;
 		t.phi = phil * U_SEC_TO_RAD;
 		*p++ = t;
-		for (j = 1; j < ct.lim.lam; ++j) {
+		for (j = 1; j < ct->lim.lam; ++j) {
 			scanf("%ld %ld", &lam, &phi);
 			t.lam = (laml += lam) * U_SEC_TO_RAD;
 			t.phi = (phil += phi) * U_SEC_TO_RAD;
@@ -52,12 +50,92 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "premature EOF\n");
 		exit(1);
 	}
-	if (!(bin = freopen(argv[1], "wb", stdout))) {
-		perror(argv[1]);
+}
+/* read any grid file the library can load, without subgrids */
+	static void
+read_grid(struct CTABLE *ct, const char *name) {
+	PJ_GRIDINFO *gi;
+	projCtx ctx = pj_get_default_ctx();
+
+	gi = pj_gridinfo_init(ctx, name);
+	if (gi == NULL || gi->ct == NULL || !pj_gridinfo_load_all(ctx, gi)) {
+		fprintf(stderr, "%s: unable to load grid\n", name);
+		exit(1);
+	}
+	if (gi->child != NULL || gi->next != NULL) {
+		fprintf(stderr, "%s: grids with subgrids can't be converted\n",
+			name);
+		exit(1);
+	}
+	*ct = *gi->ct;
+	if (!(ct->cvs = (FLP *)malloc(ct->lim.lam * ct->lim.phi *
+		sizeof(FLP)))) {
+		perror("mem. alloc");
+		exit(1);
+	}
+	memcpy(ct->cvs, gi->ct->cvs, ct->lim.lam * ct->lim.phi * sizeof(FLP));
+	pj_gridinfo_free(gi);
+}
+/* write "ctable2": fixed LSB layout that pj_gridinfo.c can map directly */
+	static int
+write_ctable2(struct CTABLE *ct, size_t tsize) {
+	char header[CTABLE2_HEADER_SIZE];
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, "CTABLE V2", 9);
+	strncpy(header + 16, ct->id, 80);
+	memcpy(header + 96, &ct->ll.lam, 8);
+	memcpy(header + 104, &ct->ll.phi, 8);
+	memcpy(header + 112, &ct->del.lam, 8);
+	memcpy(header + 120, &ct->del.phi, 8);
+	memcpy(header + 128, &ct->lim.lam, 4);
+	memcpy(header + 132, &ct->lim.phi, 4);
+	if (!IS_LSB) {
+		pj_swap_words(header + 96, 8, 4);
+		pj_swap_words(header + 128, 4, 2);
+		pj_swap_words(ct->cvs, 4, ct->lim.lam * ct->lim.phi * 2);
+	}
+	return fwrite(header, sizeof(header), 1, stdout) == 1 &&
+		fwrite(ct->cvs, tsize, 1, stdout) == 1;
+}
+
+int main(int argc, char **argv) {
+	struct CTABLE ct;
+	size_t tsize;
+	char *format = "ctable", *input = NULL, *output = NULL;
+	int i, ok;
+
+	for (i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-f") && i + 1 < argc)
+			format = argv[++i];
+		else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+			input = argv[++i];
+		else if (argv[i][0] != '-' && output == NULL)
+			output = argv[i];
+		else
+			output = NULL, i = argc;
+	}
+	if (output == NULL || (strcmp(format, "ctable") &&
+		strcmp(format, "ctable2"))) {
+		fprintf(stderr,"usage: %s %s\n", argv[0], usage);
+		exit(1);
+	}
+	memset(&ct, 0, sizeof(ct));
+	if (input)
+		read_grid(&ct, input);
+	else
+		read_lla(&ct);
+	tsize = ct.lim.lam * ct.lim.phi * sizeof(FLP);
+	if (!freopen(output, "wb", stdout)) {
+		perror(output);
 		exit(2);
 	}
-	if (fwrite(&ct, sizeof(ct), 1, stdout) != 1 ||
-		fwrite(ct.cvs, tsize, 1, stdout) != 1) {
+	if (!strcmp(format, "ctable2"))
+		ok = write_ctable2(&ct, tsize);
+	else
+		ok = fwrite(&ct, sizeof(ct), 1, stdout) == 1 &&
+			fwrite(ct.cvs, tsize, 1, stdout) == 1;
+	if (!ok) {
 		fprintf(stderr, "output failure\n");
 		exit(2);
 	}
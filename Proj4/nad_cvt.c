@@ -2,8 +2,12 @@
 #include <projects.h>
 #define MAX_TRY 9
 #define TOL 1e-12
-	LP
-nad_cvt(LP in, int inverse, struct CTABLE *ct) {
+/* interpolate in gi if given (tile-wise loading), else in ct */
+#define INTR(t) (gi != NULL ? nad_intr_grid(ctx, t, gi, pinned) \
+	: nad_intr(t, ct))
+	static LP
+nad_cvt_(projCtx ctx, LP in, int inverse, struct CTABLE *ct,
+	PJ_GRIDINFO *gi, struct PJ_GRIDTILE **pinned) {
 	LP t, tb;
 
 	if (in.lam == HUGE_VAL)
@@ -13,7 +17,7 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
 	tb.lam -= ct->ll.lam;
 	tb.phi -= ct->ll.phi;
 	tb.lam = adjlon(tb.lam - PI) + PI;
-	t = nad_intr(tb, ct);
+	t = INTR(tb);
 	if (inverse) {
 		LP del, dif;
 		int i = MAX_TRY;
@@ -23,7 +27,7 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
 		t.phi = tb.phi - t.phi;
 
 		do {
-			del = nad_intr(t, ct);
+			del = INTR(t);
 
                         /* This case used to return failure, but I have
                            changed it to return the first order approximation
@@ -65,4 +69,103 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
 		}
 	}
 	return in;
+}
+	LP
+nad_cvt(LP in, int inverse, struct CTABLE *ct) {
+	return nad_cvt_(NULL, in, inverse, ct, NULL, NULL);
+}
+	LP
+nad_cvt_grid(projCtx ctx, LP in, int inverse, PJ_GRIDINFO *gi,
+	struct PJ_GRIDTILE **pinned) {
+	return nad_cvt_(ctx, in, inverse, gi->ct, gi, pinned);
+}
+/* nad_cvt() for n points of one in-memory table (ct->cvs loaded), in
+** place; points that cannot be shifted are set to HUGE_VAL.  The inverse
+** iterates all unconverged points together, dropping each as nad_cvt()
+** would stop on it */
+	void
+nad_cvt_array(struct CTABLE *ct, int inverse, int n, double *lam,
+	double *phi) {
+	double tblam[NAD_BATCH], tbphi[NAD_BATCH];
+	double tlam[NAD_BATCH], tphi[NAD_BATCH];
+	double dlam[NAD_BATCH], dphi[NAD_BATCH];
+	double alam[NAD_BATCH], aphi[NAD_BATCH];
+	int active[NAD_BATCH], tries[NAD_BATCH];
+	int i, j, k, nk, na;
+
+	for (k = 0; k < n; k += NAD_BATCH, lam += NAD_BATCH, phi += NAD_BATCH) {
+		nk = n - k < NAD_BATCH ? n - k : NAD_BATCH;
+		/* normalize input to ll origin */
+		for (i = 0; i < nk; ++i) {
+			if (lam[i] == HUGE_VAL)
+				tblam[i] = tbphi[i] = 0.;
+			else {
+				tblam[i] = adjlon(lam[i] - ct->ll.lam - PI) + PI;
+				tbphi[i] = phi[i] - ct->ll.phi;
+			}
+		}
+		nad_intr_array(ct, nk, tblam, tbphi, tlam, tphi);
+		if (!inverse) {
+			for (i = 0; i < nk; ++i) {
+				if (lam[i] == HUGE_VAL || tlam[i] == HUGE_VAL)
+					lam[i] = phi[i] = HUGE_VAL;
+				else {
+					lam[i] -= tlam[i];
+					phi[i] += tphi[i];
+				}
+			}
+			continue;
+		}
+		/* inverse: first approximation, then iterate the active points */
+		for (i = na = 0; i < nk; ++i) {
+			if (lam[i] == HUGE_VAL || tlam[i] == HUGE_VAL) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			tlam[i] = tblam[i] + tlam[i];
+			tphi[i] = tbphi[i] - tphi[i];
+			tries[i] = MAX_TRY;
+			active[na++] = i;
+		}
+		while (na > 0) {
+			for (j = 0; j < na; ++j) {
+				alam[j] = tlam[active[j]];
+				aphi[j] = tphi[active[j]];
+			}
+			nad_intr_array(ct, na, alam, aphi, dlam, dphi);
+			for (j = i = 0; j < na; ++j) {
+				int p = active[j];
+				double dif_lam, dif_phi;
+
+				if (dlam[j] == HUGE_VAL) {
+					if( getenv( "PROJ_DEBUG" ) != NULL )
+						fprintf( stderr, 
+							"Inverse grid shift iteration failed, presumably at grid edge.\n"
+							"Using first approximation.\n" );
+					continue;
+				}
+				tlam[p] -= dif_lam = tlam[p] - dlam[j] - tblam[p];
+				tphi[p] -= dif_phi = tphi[p] + dphi[j] - tbphi[p];
+				if (tries[p]-- && fabs(dif_lam) > TOL && fabs(dif_phi) > TOL)
+					active[i++] = p;
+				else if (tries[p] < 0) {
+					if( getenv( "PROJ_DEBUG" ) != NULL )
+						fprintf( stderr, 
+							"Inverse grid shift iterator failed to converge.\n" );
+					tlam[p] = HUGE_VAL;
+				}
+			}
+			na = i;
+		}
+		for (i = 0; i < nk; ++i) {
+			if (lam[i] == HUGE_VAL)
+				continue;
+			if (tlam[i] == HUGE_VAL)
+				lam[i] = phi[i] = HUGE_VAL;
+			else {
+				lam[i] = adjlon(tlam[i] + ct->ll.lam);
+				phi[i] = tphi[i] + ct->ll.phi;
+			}
+		}
+	}
 }
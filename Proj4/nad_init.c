@@ -50,32 +50,33 @@
 /*      Load the data portion of a ctable formatted grid.               */
 /************************************************************************/
 
-int nad_ctable_load( struct CTABLE *ct, FILE *fid )
+int nad_ctable_load( projCtx ctx, struct CTABLE *ct, FILE *fid )
 
 {
     int  a_size;
+    FLP  *cvs;
 
     fseek( fid, sizeof(struct CTABLE), SEEK_SET );
 
     /* read all the actual shift values */
     a_size = ct->lim.lam * ct->lim.phi;
-    ct->cvs = (FLP *) pj_malloc(sizeof(FLP) * a_size);
-    if( ct->cvs == NULL 
-        || fread(ct->cvs, sizeof(FLP), a_size, fid) != a_size )
+    cvs = (FLP *) pj_malloc(sizeof(FLP) * a_size);
+    if( cvs == NULL 
+        || fread(cvs, sizeof(FLP), a_size, fid) != a_size )
     {
-        pj_dalloc( ct->cvs );
-        ct->cvs = NULL;
+        pj_dalloc( cvs );
 
-        if( getenv("PROJ_DEBUG") != NULL )
-        {
-            fprintf( stderr, 
-            "ctable loading failed on fread() - binary incompatible?\n" );
-        }
+        pj_log( ctx, PJ_LOG_ERROR, 
+                "ctable loading failed on fread() - binary incompatible?\n" );
 
-        pj_errno = -38;
+        pj_ctx_set_errno( ctx, -38 );
         return 0;
     }
 
+    /* only publish the table once it is complete */
+    PJ_PUBLISH_BARRIER();
+    ct->cvs = cvs;
+
     return 1;
 } 
 
@@ -85,7 +86,7 @@ int nad_ctable_load( struct CTABLE *ct, FILE *fid )
 /*      Read the header portion of a "ctable" format grid.              */
 /************************************************************************/
 
-struct CTABLE *nad_ctable_init( FILE * fid )
+struct CTABLE *nad_ctable_init( projCtx ctx, FILE * fid )
 {
     struct CTABLE *ct;
     int		id_end;
@@ -95,7 +96,7 @@ struct CTABLE *nad_ctable_init( FILE * fid )
     if( ct == NULL 
         || fread( ct, sizeof(struct CTABLE), 1, fid ) != 1 )
     {
-        pj_errno = -38;
+        pj_ctx_set_errno( ctx, -38 );
         return NULL;
     }
 
@@ -103,7 +104,119 @@ struct CTABLE *nad_ctable_init( FILE * fid )
     if( ct->lim.lam < 1 || ct->lim.lam > 100000 
         || ct->lim.phi < 1 || ct->lim.phi > 100000 )
     {
-        pj_errno = -38;
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+    
+    /* trim white space and newlines off id */
+    for( id_end = strlen(ct->id)-1; id_end > 0; id_end-- )
+    {
+        if( ct->id[id_end] == '\n' || ct->id[id_end] == ' ' )
+            ct->id[id_end] = '\0';
+        else
+            break;
+    }
+
+    ct->cvs = NULL;
+
+    return ct;
+}
+
+/*
+** ctable2 files are always LSB; swap on big endian hosts.
+*/
+static int  byte_order_test = 1;
+#define IS_LSB	(((unsigned char *) (&byte_order_test))[0] == 1)
+
+/************************************************************************/
+/*                          nad_ctable2_load()                          */
+/*                                                                      */
+/*      Read the data portion of a "ctable2" format grid.  Used where   */
+/*      the grid cannot be mapped directly (see pj_gridinfo.c).         */
+/************************************************************************/
+
+int nad_ctable2_load( projCtx ctx, struct CTABLE *ct, FILE *fid )
+
+{
+    int  a_size;
+    FLP  *cvs;
+
+    fseek( fid, CTABLE2_HEADER_SIZE, SEEK_SET );
+
+    /* read all the actual shift values */
+    a_size = ct->lim.lam * ct->lim.phi;
+    cvs = (FLP *) pj_malloc(sizeof(FLP) * a_size);
+    if( cvs == NULL 
+        || fread(cvs, sizeof(FLP), a_size, fid) != a_size )
+    {
+        pj_dalloc( cvs );
+
+        pj_log( ctx, PJ_LOG_ERROR, 
+                "ctable2 loading failed on fread() - truncated file?" );
+
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+
+    if( !IS_LSB )
+        pj_swap_words( cvs, 4, a_size * 2 );
+
+    /* only publish the table once it is complete */
+    PJ_PUBLISH_BARRIER();
+    ct->cvs = cvs;
+
+    return 1;
+} 
+
+/************************************************************************/
+/*                          nad_ctable2_init()                          */
+/*                                                                      */
+/*      Read the header portion of a "ctable2" format grid.  Unlike     */
+/*      "ctable" the layout does not depend on the host: a 160 byte     */
+/*      LSB header followed by the FLP shift values, also LSB.          */
+/************************************************************************/
+
+struct CTABLE *nad_ctable2_init( projCtx ctx, FILE * fid )
+{
+    struct CTABLE *ct;
+    int		id_end;
+    char	header[CTABLE2_HEADER_SIZE];
+
+    if( fread( header, sizeof(header), 1, fid ) != 1 
+        || strncmp( header, "CTABLE V2", 9 ) != 0 )
+    {
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+
+    if( !IS_LSB )
+    {
+        pj_swap_words( header +  96, 8, 4 );
+        pj_swap_words( header + 128, 4, 2 );
+    }
+
+    ct = (struct CTABLE *) pj_malloc(sizeof(struct CTABLE));
+    if( ct == NULL )
+    {
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+
+    memcpy( ct->id, header + 16, 80 );
+    ct->id[79] = '\0';
+    memcpy( &ct->ll.lam,  header +  96, 8 );
+    memcpy( &ct->ll.phi,  header + 104, 8 );
+    memcpy( &ct->del.lam, header + 112, 8 );
+    memcpy( &ct->del.phi, header + 120, 8 );
+    memcpy( &ct->lim.lam, header + 128, 4 );
+    memcpy( &ct->lim.phi, header + 132, 4 );
+
+    /* do some minimal validation to ensure the structure isn't corrupt */
+    if( ct->lim.lam < 1 || ct->lim.lam > 100000 
+        || ct->lim.phi < 1 || ct->lim.phi > 100000 )
+    {
+        pj_dalloc( ct );
+        pj_ctx_set_errno( ctx, -38 );
         return NULL;
     }
     
@@ -127,28 +240,44 @@ struct CTABLE *nad_ctable_init( FILE * fid )
 /*      Read a datum shift file in any of the supported binary formats. */
 /************************************************************************/
 
-struct CTABLE *nad_init(char *name) 
+struct CTABLE *nad_init(projCtx ctx, char *name) 
 {
     char 	fname[MAX_PATH_FILENAME+1];
     struct CTABLE *ct;
     FILE 	*fid;
     char	header[512];
 
-    errno = pj_errno = 0;
+    ctx->last_errno = 0;
+    errno = 0;
 
 /* -------------------------------------------------------------------- */
 /*      Open the file using the usual search rules.                     */
 /* -------------------------------------------------------------------- */
     strcpy(fname, name);
-    if (!(fid = pj_open_lib(fname, "rb"))) {
-        pj_errno = errno;
+    if (!(fid = pj_open_lib(ctx, fname, "rb"))) {
+        pj_ctx_set_errno( ctx, errno );
         return 0;
     }
     
-    ct = nad_ctable_init( fid );
+    if( fread( header, 9, 1, fid ) == 1 
+        && strncmp( header, "CTABLE V2", 9 ) == 0 )
+    {
+        fseek( fid, 0, SEEK_SET );
+        ct = nad_ctable2_init( ctx, fid );
+        if( ct != NULL && !nad_ctable2_load( ctx, ct, fid ) )
+        {
+            nad_free( ct );
+            ct = NULL;
+        }
+        fclose( fid );
+        return ct;
+    }
+
+    fseek( fid, 0, SEEK_SET );
+    ct = nad_ctable_init( ctx, fid );
     if( ct != NULL )
     {
-        if( !nad_ctable_load( ct, fid ) )
+        if( !nad_ctable_load( ctx, ct, fid ) )
         {
             nad_free( ct );
             ct = NULL;
@@ -1,52 +1,50 @@
 /* Determine nad table correction value */
 #define PJ_LIB__
 #include <projects.h>
-	LP
-nad_intr(LP t, struct CTABLE *ct) {
-	LP val, frct;
-	ILP indx;
-	double m00, m10, m01, m11;
-	FLP *f00, *f10, *f01, *f11;
-	long index;
+/* locate t (relative to the table origin) in the table: lower left
+** node in *indx, position within the cell in *frct; 0 if outside */
+	static int
+nad_cell(LP t, struct CTABLE *ct, ILP *indx, LP *frct) {
 	int in;
 
-	indx.lam = floor(t.lam /= ct->del.lam);
-	indx.phi = floor(t.phi /= ct->del.phi);
-	frct.lam = t.lam - indx.lam;
-	frct.phi = t.phi - indx.phi;
-	val.lam = val.phi = HUGE_VAL;
-	if (indx.lam < 0) {
-		if (indx.lam == -1 && frct.lam > 0.99999999999) {
-			++indx.lam;
-			frct.lam = 0.;
+	indx->lam = floor(t.lam /= ct->del.lam);
+	indx->phi = floor(t.phi /= ct->del.phi);
+	frct->lam = t.lam - indx->lam;
+	frct->phi = t.phi - indx->phi;
+	if (indx->lam < 0) {
+		if (indx->lam == -1 && frct->lam > 0.99999999999) {
+			++indx->lam;
+			frct->lam = 0.;
 		} else
-			return val;
-	} else if ((in = indx.lam + 1) >= ct->lim.lam) {
-		if (in == ct->lim.lam && frct.lam < 1e-11) {
-			--indx.lam;
-			frct.lam = 1.;
+			return 0;
+	} else if ((in = indx->lam + 1) >= ct->lim.lam) {
+		if (in == ct->lim.lam && frct->lam < 1e-11) {
+			--indx->lam;
+			frct->lam = 1.;
 		} else
-			return val;
+			return 0;
 	}
-	if (indx.phi < 0) {
-		if (indx.phi == -1 && frct.phi > 0.99999999999) {
-			++indx.phi;
-			frct.phi = 0.;
+	if (indx->phi < 0) {
+		if (indx->phi == -1 && frct->phi > 0.99999999999) {
+			++indx->phi;
+			frct->phi = 0.;
 		} else
-			return val;
-	} else if ((in = indx.phi + 1) >= ct->lim.phi) {
-		if (in == ct->lim.phi && frct.phi < 1e-11) {
-			--indx.phi;
-			frct.phi = 1.;
+			return 0;
+	} else if ((in = indx->phi + 1) >= ct->lim.phi) {
+		if (in == ct->lim.phi && frct->phi < 1e-11) {
+			--indx->phi;
+			frct->phi = 1.;
 		} else
-			return val;
+			return 0;
 	}
-	index = indx.phi * ct->lim.lam + indx.lam;
-	f00 = ct->cvs + index++;
-	f10 = ct->cvs + index;
-	index += ct->lim.lam;
-	f11 = ct->cvs + index--;
-	f01 = ct->cvs + index;
+	return 1;
+}
+/* bilinear blend of the four nodes of a cell */
+	static LP
+nad_blend(LP frct, FLP *f00, FLP *f10, FLP *f01, FLP *f11) {
+	LP val;
+	double m00, m10, m01, m11;
+
 	m11 = m10 = frct.lam;
 	m00 = m01 = 1. - frct.lam;
 	m11 *= frct.phi;
@@ -59,4 +57,96 @@ nad_intr(LP t, struct CTABLE *ct) {
 	val.phi = m00 * f00->phi + m10 * f10->phi +
 			  m01 * f01->phi + m11 * f11->phi;
 	return val;
+}
+	LP
+nad_intr(LP t, struct CTABLE *ct) {
+	LP val, frct;
+	ILP indx;
+	long index;
+
+	val.lam = val.phi = HUGE_VAL;
+	if (!nad_cell(t, ct, &indx, &frct))
+		return val;
+	index = indx.phi * ct->lim.lam + indx.lam;
+	return nad_blend(frct, ct->cvs + index, ct->cvs + index + 1,
+		ct->cvs + index + ct->lim.lam, ct->cvs + index + ct->lim.lam + 1);
+}
+/* as nad_intr(), for a grid whose values may be loaded tile by tile;
+** *pinned is the tile pinned by the calling pj_apply_gridlist() */
+	LP
+nad_intr_grid(projCtx ctx, LP t, PJ_GRIDINFO *gi,
+	struct PJ_GRIDTILE **pinned) {
+	LP val, frct;
+	ILP indx;
+	FLP f[4];
+
+	if (gi->ct->cvs != NULL)
+		return nad_intr(t, gi->ct);
+	val.lam = val.phi = HUGE_VAL;
+	if (!nad_cell(t, gi->ct, &indx, &frct) ||
+		!pj_gridinfo_cells(ctx, gi, indx.lam, indx.phi, f, pinned))
+		return val;
+	return nad_blend(frct, f, f + 1, f + 2, f + 3);
+}
+/* nad_intr() for n points of one in-memory table: t[] relative to the
+** table origin, v[] set to the corrections or HUGE_VAL.  Same arithmetic
+** as nad_intr(), written without branches so compilers can vectorize */
+	void
+nad_intr_array(struct CTABLE *ct, int n, const double *tlam,
+	const double *tphi, double *vlam, double *vphi) {
+	double flam[NAD_BATCH], fphi[NAD_BATCH];
+	long index[NAD_BATCH];
+	int ok[NAD_BATCH];
+	int i, k, nk;
+
+	for (k = 0; k < n; k += NAD_BATCH) {
+		nk = n - k < NAD_BATCH ? n - k : NAD_BATCH;
+		/* locate the cells */
+		for (i = 0; i < nk; ++i) {
+			double ql = tlam[k + i] / ct->del.lam;
+			double qp = tphi[k + i] / ct->del.phi;
+			double il = floor(ql), ip = floor(qp);
+			double fl = ql - il, fp = qp - ip;
+			int lo, hi, fixlo, fixhi, good;
+
+			lo = il < 0.;
+			fixlo = lo && il == -1. && fl > 0.99999999999;
+			hi = !lo && il + 1. >= ct->lim.lam;
+			fixhi = hi && il + 1. == ct->lim.lam && fl < 1e-11;
+			good = (!lo || fixlo) && (!hi || fixhi);
+			il = fixlo ? 0. : fixhi ? il - 1. : il;
+			fl = fixlo ? 0. : fixhi ? 1. : fl;
+
+			lo = ip < 0.;
+			fixlo = lo && ip == -1. && fp > 0.99999999999;
+			hi = !lo && ip + 1. >= ct->lim.phi;
+			fixhi = hi && ip + 1. == ct->lim.phi && fp < 1e-11;
+			good = good && (!lo || fixlo) && (!hi || fixhi);
+			ip = fixlo ? 0. : fixhi ? ip - 1. : ip;
+			fp = fixlo ? 0. : fixhi ? 1. : fp;
+
+			ok[i] = good;
+			flam[i] = fl;
+			fphi[i] = fp;
+			index[i] = good ? (long)ip * ct->lim.lam + (long)il : 0;
+		}
+		/* gather and blend */
+		for (i = 0; i < nk; ++i) {
+			FLP *f00 = ct->cvs + index[i], *f10 = f00 + 1;
+			FLP *f01 = f00 + ct->lim.lam, *f11 = f01 + 1;
+			double m00, m10, m01, m11, fp;
+
+			m11 = m10 = flam[i];
+			m00 = m01 = 1. - flam[i];
+			m11 *= fphi[i];
+			m01 *= fphi[i];
+			fp = 1. - fphi[i];
+			m00 *= fp;
+			m10 *= fp;
+			vlam[k + i] = ok[i] ? m00 * f00->lam + m10 * f10->lam +
+				m01 * f01->lam + m11 * f11->lam : HUGE_VAL;
+			vphi[k + i] = ok[i] ? m00 * f00->phi + m10 * f10->phi +
+				m01 * f01->phi + m11 * f11->phi : HUGE_VAL;
+		}
+	}
 }
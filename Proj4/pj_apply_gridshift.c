@@ -38,114 +38,323 @@
 
 /************************************************************************/
 /*                         pj_apply_gridshift()                         */
+/*                                                                      */
+/*      This is the externally callable interface - part of the         */
+/*      public API - though it is not used internally any more and I    */
+/*      doubt it is used by any other applications.  But we preserve    */
+/*      it to honour our public api.                                    */
 /************************************************************************/
 
-int pj_apply_gridshift( const char *nadgrids, int inverse, 
+int pj_apply_gridshift( projCtx ctx, const char *nadgrids, int inverse, 
                         long point_count, int point_offset,
                         double *x, double *y, double *z )
 
 {
-    int grid_count = 0;
-    PJ_GRIDINFO   **tables;
-    int  i;
-    int debug_flag = getenv( "PROJ_DEBUG" ) != NULL;
-    static int debug_count = 0;
+    PJ_GRIDLIST *gridlist;
+    int         ret;
+    
+    gridlist = pj_gridlist_lookup( ctx, nadgrids );
+
+    if( gridlist == NULL )
+        return ctx->last_errno;
+
+    ret = pj_apply_gridlist( ctx, gridlist->grids, gridlist->grid_count, 
+                             gridlist->index, inverse, 
+                             point_count, point_offset, x, y, z );
+    pj_gridlist_release( gridlist );
 
-    pj_errno = 0;
+    return ret;
+}
 
-    tables = pj_gridlist_from_nadgrids( nadgrids, &grid_count);
-    if( tables == NULL || grid_count == 0 )
-        return pj_errno;
+/************************************************************************/
+/*                        pj_apply_gridshift_2()                        */
+/*                                                                      */
+/*      This implmentation takes uses the gridlist from a coordinate    */
+/*      system definition.  If the gridlist has not yet been            */
+/*      populated in the coordinate system definition we set it up      */
+/*      now, from the shared grid list cache.                           */
+/************************************************************************/
 
-    for( i = 0; i < point_count; i++ )
+int pj_apply_gridshift_2( PJ *defn, int inverse, 
+                          long point_count, int point_offset,
+                          double *x, double *y, double *z )
+
+{
+    PJ_GRIDLIST *gridlist = defn->gridlist;
+
+    if( gridlist == NULL )
     {
-        long io = i * point_offset;
-        LP   input, output;
-        int  itable;
+        gridlist = pj_gridlist_resolve( defn );
+        if( gridlist == NULL )
+            return defn->ctx->last_errno;
+    }
+     
+    return pj_apply_gridlist( pj_get_ctx( defn ), 
+                              gridlist->grids, gridlist->grid_count, 
+                              gridlist->index, inverse, 
+                              point_count, point_offset, x, y, z );
+}
 
-        input.phi = y[io];
-        input.lam = x[io];
-        output.phi = HUGE_VAL;
-        output.lam = HUGE_VAL;
+/************************************************************************/
+/*                         pj_gridlist_pick()                           */
+/*                                                                      */
+/*      Find the first of tables[candidates[*itable..]] (or             */
+/*      tables[*itable..] without an index) covering the point, and     */
+/*      return it, or its first child covering the point.  *itable is   */
+/*      left on the table found.                                        */
+/************************************************************************/
 
-        /* keep trying till we find a table that works */
-        for( itable = 0; itable < grid_count; itable++ )
-        {
-            PJ_GRIDINFO *gi = tables[itable];
-            struct CTABLE *ct = gi->ct;
+static PJ_GRIDINFO *pj_gridlist_pick( PJ_GRIDINFO **tables, 
+                                      const int *candidates, 
+                                      int candidate_count,
+                                      LP input, int *itable )
 
-            /* skip tables that don't match our point at all.  */
-            if( ct->ll.phi > input.phi || ct->ll.lam > input.lam
-                || ct->ll.phi + (ct->lim.phi-1) * ct->del.phi < input.phi
-                || ct->ll.lam + (ct->lim.lam-1) * ct->del.lam < input.lam )
-                continue;
+{
+    for( ; *itable < candidate_count; (*itable)++ )
+    {
+        PJ_GRIDINFO *gi = candidates != NULL ? 
+            tables[candidates[*itable]] : tables[*itable];
+        struct CTABLE *ct = gi->ct;
 
-            /* If we have child nodes, check to see if any of them apply. */
-            if( gi->child != NULL )
-            {
-                PJ_GRIDINFO *child;
+        /* skip tables that don't match our point at all.  */
+        if( ct->ll.phi > input.phi || ct->ll.lam > input.lam
+            || ct->ll.phi + (ct->lim.phi-1) * ct->del.phi < input.phi
+            || ct->ll.lam + (ct->lim.lam-1) * ct->del.lam < input.lam )
+            continue;
 
-                for( child = gi->child; child != NULL; child = child->next )
-                {
-                    struct CTABLE *ct1 = child->ct;
+        /* If we have child nodes, check to see if any of them apply. */
+        if( gi->child_index != NULL )
+        {
+            PJ_GRIDINDEX *ci = gi->child_index;
+            const int *children;
+            int  ichild, child_count;
 
-                    if( ct1->ll.phi > input.phi || ct1->ll.lam > input.lam
-                      || ct1->ll.phi+(ct1->lim.phi-1)*ct1->del.phi < input.phi
-                      || ct1->ll.lam+(ct1->lim.lam-1)*ct1->del.lam < input.lam)
-                        continue;
+            child_count = pj_gridindex_query( ci, input, &children );
+            for( ichild = 0; ichild < child_count; ichild++ )
+            {
+                struct CTABLE *ct1 = ci->grids[children[ichild]]->ct;
 
-                    break;
-                }
+                if( ct1->ll.phi > input.phi || ct1->ll.lam > input.lam
+                  || ct1->ll.phi+(ct1->lim.phi-1)*ct1->del.phi < input.phi
+                  || ct1->ll.lam+(ct1->lim.lam-1)*ct1->del.lam < input.lam)
+                    continue;
 
                 /* we found a more refined child node to use */
-                if( child != NULL )
-                {
-                    gi = child;
-                    ct = child->ct;
-                }
+                return ci->grids[children[ichild]];
             }
+        }
+        else if( gi->child != NULL )
+        {
+            PJ_GRIDINFO *child;
 
-            /* load the grid shift info if we don't have it. */
-            if( ct->cvs == NULL && !pj_gridinfo_load( gi ) )
+            for( child = gi->child; child != NULL; child = child->next )
             {
-                pj_errno = -38;
-                return pj_errno;
+                struct CTABLE *ct1 = child->ct;
+
+                if( ct1->ll.phi > input.phi || ct1->ll.lam > input.lam
+                  || ct1->ll.phi+(ct1->lim.phi-1)*ct1->del.phi < input.phi
+                  || ct1->ll.lam+(ct1->lim.lam-1)*ct1->del.lam < input.lam)
+                    continue;
+
+                /* we found a more refined child node to use */
+                return child;
             }
-            
-            output = nad_cvt( input, inverse, ct );
-            if( output.lam != HUGE_VAL )
+        }
+
+        return gi;
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                         pj_apply_gridlist()                          */
+/*                                                                      */
+/*      Shift each point with the first table (or its first matching    */
+/*      child) that covers it and has a valid shift there.  If an       */
+/*      index is given, only the tables it returns for the point are    */
+/*      tried, which gives the same result as trying them all.          */
+/*                                                                      */
+/*      Points are taken NAD_BATCH at a time: each is assigned its      */
+/*      first table, runs of points in the same in-memory table are     */
+/*      shifted together with nad_cvt_array(), and only points that     */
+/*      fail there (or are not in such a run) go on to be tried one     */
+/*      by one.                                                         */
+/************************************************************************/
+
+int pj_apply_gridlist( projCtx ctx, PJ_GRIDINFO **tables, int grid_count,
+                       PJ_GRIDINDEX *index, int inverse, 
+                       long point_count, int point_offset,
+                       double *x, double *y, double *z )
+
+{
+    long i;
+    static int debug_count = 0;
+    struct PJ_GRIDTILE *pinned = NULL;  /* tile read without the lock */
+
+    ctx->last_errno = 0;
+
+    for( i = 0; i < point_count; i += NAD_BATCH )
+    {
+        PJ_GRIDINFO *pick[NAD_BATCH];
+        const int *candidates[NAD_BATCH];
+        int     candidate_count[NAD_BATCH], itable[NAD_BATCH];
+        int     batched[NAD_BATCH];
+        double  lam[NAD_BATCH], phi[NAD_BATCH];
+        int     lane, first, end, n = (int) MIN(NAD_BATCH, point_count - i);
+
+/* -------------------------------------------------------------------- */
+/*      Find the first table for each point, loading it if needed.      */
+/* -------------------------------------------------------------------- */
+        for( lane = 0; lane < n; lane++ )
+        {
+            long io = (i + lane) * point_offset;
+            LP   input;
+
+            input.phi = phi[lane] = y[io];
+            input.lam = lam[lane] = x[io];
+
+            candidates[lane] = NULL;
+            candidate_count[lane] = grid_count;
+            if( index != NULL )
+                candidate_count[lane] = 
+                    pj_gridindex_query( index, input, candidates + lane );
+
+            itable[lane] = 0;
+            pick[lane] = pj_gridlist_pick( tables, candidates[lane], 
+                                           candidate_count[lane], input, 
+                                           itable + lane );
+            batched[lane] = 0;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Shift runs of points falling in the same in-memory table        */
+/*      together.  A table that fails to load is left for the point     */
+/*      by point pass to report, once the points before are done.       */
+/* -------------------------------------------------------------------- */
+        for( first = 0; first < n; first = end )
+        {
+            PJ_GRIDINFO *gi = pick[first];
+
+            for( end = first + 1; end < n && pick[end] == gi; end++ ) {}
+
+            /* a few points are done as quickly one by one */
+            if( gi == NULL || end - first < 4 )
+                continue;
+
+            if( gi->ct->cvs == NULL && gi->tiles == NULL 
+                && !pj_gridinfo_load( ctx, gi ) )
+                continue;
+
+            if( gi->ct->cvs == NULL )
+                continue;
+
+            nad_cvt_array( gi->ct, inverse, end - first, 
+                           lam + first, phi + first );
+
+            for( lane = first; lane < end; lane++ )
             {
-                if( debug_flag && debug_count++ < 20 )
-                    fprintf( stderr,
-                             "pj_apply_gridshift(): used %s\n",
-                             ct->id );
-                break;
+                batched[lane] = 1;
+                if( lam[lane] != HUGE_VAL && debug_count++ < 20 )
+                    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                            "pj_apply_gridshift(): used %s", gi->ct->id );
             }
         }
 
-        if( output.lam == HUGE_VAL )
+/* -------------------------------------------------------------------- */
+/*      Store the results in order, trying the following tables one     */
+/*      by one for points that were not shifted.                        */
+/* -------------------------------------------------------------------- */
+        for( lane = 0; lane < n; lane++ )
         {
-            if( debug_flag )
+            long io = (i + lane) * point_offset;
+            LP   input, output;
+
+            input.phi = y[io];
+            input.lam = x[io];
+            output.lam = lam[lane];
+            output.phi = phi[lane];
+
+            if( !batched[lane] || output.lam == HUGE_VAL )
             {
-                fprintf( stderr, 
-                         "pj_apply_gridshift(): failed to find a grid shift table for\n"
-                         "                      location (%.7fdW,%.7fdN)\n",
-                         x[io] * RAD_TO_DEG, 
-                         y[io] * RAD_TO_DEG );
-                fprintf( stderr, 
-                         "   tried: %s\n", nadgrids );
+                PJ_GRIDINFO *gi = pick[lane];
+
+                output.lam = output.phi = HUGE_VAL;
+
+                /* keep trying till we find a table that works */
+                if( batched[lane] && gi != NULL )
+                {
+                    itable[lane]++;
+                    gi = pj_gridlist_pick( tables, candidates[lane],
+                                           candidate_count[lane], input,
+                                           itable + lane );
+                }
+
+                while( gi != NULL )
+                {
+                    /* load the grid shift info if we don't have it. */
+                    if( gi->ct->cvs == NULL && gi->tiles == NULL 
+                        && !pj_gridinfo_load( ctx, gi ) )
+                    {
+                        pj_gridinfo_unpin( &pinned );
+                        pj_ctx_set_errno( ctx, -38 );
+                        return -38;
+                    }
+            
+                    output = nad_cvt_grid( ctx, input, inverse, gi,
+                                           &pinned );
+                    if( output.lam != HUGE_VAL )
+                    {
+                        if( debug_count++ < 20 )
+                            pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                                    "pj_apply_gridshift(): used %s", 
+                                    gi->ct->id );
+                        break;
+                    }
+
+                    itable[lane]++;
+                    gi = pj_gridlist_pick( tables, candidates[lane],
+                                           candidate_count[lane], input,
+                                           itable + lane );
+                }
             }
+
+            if( output.lam == HUGE_VAL )
+            {
+                if( ctx->debug_level >= PJ_LOG_DEBUG_MAJOR )
+                {
+                    int itab;
+
+                    pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                        "pj_apply_gridshift(): failed to find a grid shift table for\n"
+                        "                      location (%.7fdW,%.7fdN)",
+                        x[io] * RAD_TO_DEG, 
+                        y[io] * RAD_TO_DEG );
+                    for( itab = 0; itab < grid_count; itab++ )
+                    {
+                        PJ_GRIDINFO *gi = tables[itab];
+                        if( itab == 0 )
+                            pj_log( ctx, PJ_LOG_DEBUG_MAJOR, 
+                                    "   tried: %s", gi->gridname );
+                        else
+                            pj_log( ctx, PJ_LOG_DEBUG_MAJOR, 
+                                    ",%s", gi->gridname );
+                    }
+                }
         
-            pj_errno = -38;
-            return pj_errno;
-        }
-        else
-        {
-            y[io] = output.phi;
-            x[io] = output.lam;
+                pj_gridinfo_unpin( &pinned );
+                pj_ctx_set_errno( ctx, -38 );
+                return -38;
+            }
+            else
+            {
+                y[io] = output.phi;
+                x[io] = output.lam;
+            }
         }
     }
 
+    pj_gridinfo_unpin( &pinned );
+
     return 0;
 }
-
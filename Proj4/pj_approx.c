@@ -0,0 +1,356 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Fit Chebyshev series to a projection over a given area, and
+ *           project arrays of points through them.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#define PJ_LIB__
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/* series degrees tried in turn, in each direction */
+static const int approx_degrees[] = { 8, 12, 16, 24, 32, 0 };
+
+/* points across the area, in each direction, for its projected extent */
+#define EXTENT_STEPS 32
+
+/************************************************************************/
+/*                       pj_approx_fwd_exact()                          */
+/************************************************************************/
+
+static projUV pj_approx_fwd_exact( projUV in, void *data )
+
+{
+    LP lp;
+    XY xy;
+
+    lp.lam = in.u;
+    lp.phi = in.v;
+    xy = pj_fwd( lp, (PJ *) data );
+    in.u = xy.x;
+    in.v = xy.y;
+
+    return in;
+}
+
+/************************************************************************/
+/*                       pj_approx_inv_exact()                          */
+/************************************************************************/
+
+static projUV pj_approx_inv_exact( projUV in, void *data )
+
+{
+    XY xy;
+    LP lp;
+
+    xy.x = in.u;
+    xy.y = in.v;
+    lp = pj_inv( xy, (PJ *) data );
+    in.u = lp.lam;
+    in.v = lp.phi;
+
+    return in;
+}
+
+/************************************************************************/
+/*                          pj_approx_check()                           */
+/*                                                                      */
+/*      Largest difference between a series and the exact function,     */
+/*      over a grid twice as fine as the one the series was fitted      */
+/*      on and offset from it, edges included.  HUGE_VAL if the         */
+/*      function fails anywhere on the grid.                            */
+/************************************************************************/
+
+static double pj_approx_check( Tseries *T, projUV a, projUV b, int nu, int nv,
+                               projUV (*func)(projUV, void *), void *data )
+
+{
+    double error = 0.0;
+    int    i, j, cu = 2 * nu, cv = 2 * nv;
+
+    for( i = 0; i <= cu; i++ )
+    {
+        projUV in;
+
+        in.u = a.u + (b.u - a.u) * i / cu;
+        for( j = 0; j <= cv; j++ )
+        {
+            projUV exact, approx;
+
+            in.v = a.v + (b.v - a.v) * j / cv;
+            exact = (*func)( in, data );
+            if( exact.u == HUGE_VAL )
+                return HUGE_VAL;
+
+            approx = bcheval( in, T );
+            error = MAX(error, fabs(approx.u - exact.u));
+            error = MAX(error, fabs(approx.v - exact.v));
+        }
+    }
+
+    return error;
+}
+
+/************************************************************************/
+/*                           pj_approx_fit()                            */
+/*                                                                      */
+/*      Fit Chebyshev series of increasing degree until one is within   */
+/*      max_error of func on the check grid.                            */
+/************************************************************************/
+
+static Tseries *pj_approx_fit( projUV a, projUV b, double max_error,
+                               projUV (*func)(projUV, void *), void *data,
+                               double *error_out )
+
+{
+    int i;
+
+    for( i = 0; approx_degrees[i] != 0; i++ )
+    {
+        int     n = approx_degrees[i];
+        projUV  resid;
+        Tseries *T;
+        double  error;
+
+        /* drop coefficients well below the bound */
+        T = mk_cheby_r( a, b, max_error * 0.125, &resid, func, data,
+                        n, n, 0 );
+        if( T == NULL )
+            return NULL;
+
+        error = pj_approx_check( T, a, b, n, n, func, data );
+        if( error <= max_error )
+        {
+            *error_out = error;
+            return T;
+        }
+
+        free_cheby( T );
+        if( error == HUGE_VAL )
+            return NULL;
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                         pj_approx_create()                           */
+/*                                                                      */
+/*      Fit forward and inverse series for a projection over the        */
+/*      lat/long box ll-ur (radians).  max_error is in projected        */
+/*      units; the inverse is held to the same distance on the          */
+/*      ground, as max_error / a radians.  Points outside the areas     */
+/*      fitted are projected exactly by pj_approx_fwd()/_inv().         */
+/*                                                                      */
+/*      The bound is checked against the exact projection on a grid     */
+/*      twice as fine as the fit, so it holds for smooth projections    */
+/*      but is not proven.  Returns NULL, with the error -47, if no     */
+/*      forward series of up to degree 32 meets the bound.  If no       */
+/*      inverse one does (say the projected extent reaches outside      */
+/*      the projection's domain), pj_approx_inv() is exact instead.     */
+/************************************************************************/
+
+PJ_APPROX *pj_approx_create( PJ *P, LP ll, LP ur, double max_error )
+
+{
+    PJ_APPROX *approx;
+    projUV    a, b;
+    int       i, j;
+
+    if( ll.lam >= ur.lam || ll.phi >= ur.phi
+        || !(max_error > 0.0) )
+    {
+        pj_ctx_set_errno( P->ctx, -36 );
+        return NULL;
+    }
+
+    approx = (PJ_APPROX *) pj_malloc(sizeof(PJ_APPROX));
+    if( approx == NULL )
+    {
+        pj_ctx_set_errno( P->ctx, -2 );
+        return NULL;
+    }
+    memset( approx, 0, sizeof(PJ_APPROX) );
+    approx->P = P;
+
+/* -------------------------------------------------------------------- */
+/*      Forward series over the lat/long box.                           */
+/* -------------------------------------------------------------------- */
+    a.u = ll.lam; a.v = ll.phi;
+    b.u = ur.lam; b.v = ur.phi;
+    approx->fwd_a = a;
+    approx->fwd_b = b;
+    approx->fwd = pj_approx_fit( a, b, max_error, pj_approx_fwd_exact, P,
+                                 &(approx->fwd_error) );
+    if( approx->fwd == NULL )
+    {
+        pj_approx_free( approx );
+        pj_ctx_set_errno( P->ctx, -47 );
+        return NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Inverse series over the projected extent of the box.            */
+/* -------------------------------------------------------------------- */
+    a.u = a.v = HUGE_VAL;
+    b.u = b.v = -HUGE_VAL;
+    for( i = 0; i <= EXTENT_STEPS; i++ )
+    {
+        for( j = 0; j <= EXTENT_STEPS; j++ )
+        {
+            projUV in, out;
+
+            in.u = ll.lam + (ur.lam - ll.lam) * i / EXTENT_STEPS;
+            in.v = ll.phi + (ur.phi - ll.phi) * j / EXTENT_STEPS;
+            out = pj_approx_fwd_exact( in, P );
+            if( out.u == HUGE_VAL )
+                continue;
+
+            a.u = MIN(a.u, out.u);
+            a.v = MIN(a.v, out.v);
+            b.u = MAX(b.u, out.u);
+            b.v = MAX(b.v, out.v);
+        }
+    }
+
+    approx->inv_a = a;
+    approx->inv_b = b;
+    if( P->inv != NULL && a.u != HUGE_VAL && b.u != HUGE_VAL )
+        approx->inv = pj_approx_fit( a, b, max_error * P->to_meter / P->a,
+                                     pj_approx_inv_exact, P,
+                                     &(approx->inv_error) );
+
+    P->ctx->last_errno = 0;
+
+    return approx;
+}
+
+/************************************************************************/
+/*                          pj_approx_apply()                           */
+/************************************************************************/
+
+static int pj_approx_apply( PJ_APPROX *approx, int inverse,
+                            long point_count, int point_offset,
+                            double *x, double *y )
+
+{
+    Tseries *T = inverse ? approx->inv : approx->fwd;
+    projUV  a = inverse ? approx->inv_a : approx->fwd_a;
+    projUV  b = inverse ? approx->inv_b : approx->fwd_b;
+    long    i;
+    int     err = 0;
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    for( i = 0; i < point_count; i++ )
+    {
+        projUV in, out;
+
+        in.u = x[i * point_offset];
+        in.v = y[i * point_offset];
+        if( in.u == HUGE_VAL )
+            continue;
+
+        if( T != NULL
+            && in.u >= a.u && in.u <= b.u && in.v >= a.v && in.v <= b.v )
+            out = bcheval( in, T );
+        else
+        {
+            out = inverse ? pj_approx_inv_exact( in, approx->P )
+                : pj_approx_fwd_exact( in, approx->P );
+            if( out.u == HUGE_VAL && err == 0 )
+                err = approx->P->ctx->last_errno;
+        }
+
+        x[i * point_offset] = out.u;
+        y[i * point_offset] = out.v;
+    }
+
+    return err;
+}
+
+/************************************************************************/
+/*                          pj_approx_fwd()                             */
+/*                                                                      */
+/*      Project lat/long points (radians) in place, as pj_fwd() would   */
+/*      within the approximation's error.  Points that fail are set     */
+/*      to HUGE_VAL and the first error code is returned, otherwise 0.  */
+/************************************************************************/
+
+int pj_approx_fwd( PJ_APPROX *approx, long point_count, int point_offset,
+                   double *x, double *y )
+
+{
+    return pj_approx_apply( approx, 0, point_count, point_offset, x, y );
+}
+
+/************************************************************************/
+/*                          pj_approx_inv()                             */
+/************************************************************************/
+
+int pj_approx_inv( PJ_APPROX *approx, long point_count, int point_offset,
+                   double *x, double *y )
+
+{
+    return pj_approx_apply( approx, 1, point_count, point_offset, x, y );
+}
+
+/************************************************************************/
+/*                         pj_approx_error()                            */
+/*                                                                      */
+/*      Largest error found when checking the forward (projected        */
+/*      units) or inverse (radians) series; 0 for a direction that is   */
+/*      computed exactly.                                               */
+/************************************************************************/
+
+double pj_approx_error( PJ_APPROX *approx, int inverse )
+
+{
+    return inverse ? approx->inv_error : approx->fwd_error;
+}
+
+/************************************************************************/
+/*                          pj_approx_free()                            */
+/*                                                                      */
+/*      The approximation does not own its projection, which must       */
+/*      outlive it.                                                     */
+/************************************************************************/
+
+void pj_approx_free( PJ_APPROX *approx )
+
+{
+    if( approx == NULL )
+        return;
+
+    if( approx->fwd != NULL )
+        free_cheby( approx->fwd );
+    if( approx->inv != NULL )
+        free_cheby( approx->inv );
+    pj_dalloc( approx );
+}
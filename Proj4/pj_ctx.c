@@ -0,0 +1,228 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Implementation of the projCtx thread context object.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+static projCtx_t default_context;
+static volatile int       default_context_initialized = 0;
+
+/************************************************************************/
+/*                             pj_get_ctx()                             */
+/************************************************************************/
+
+projCtx pj_get_ctx( projPJ pj )
+
+{
+    return pj->ctx;
+}
+
+/************************************************************************/
+/*                             pj_set_ctx()                             */
+/*                                                                      */
+/*      Note we do not deallocate the old context!                      */
+/************************************************************************/
+
+void pj_set_ctx( projPJ pj, projCtx ctx )
+
+{
+    pj->ctx = ctx;
+}
+
+/************************************************************************/
+/*                         pj_get_default_ctx()                         */
+/************************************************************************/
+
+projCtx pj_get_default_ctx()
+
+{
+/* -------------------------------------------------------------------- */
+/*      Only the first call takes the lock; after that the context is   */
+/*      published and can be returned directly.  The barrier keeps      */
+/*      the caller's reads of it after the test of the flag.            */
+/* -------------------------------------------------------------------- */
+    if( default_context_initialized )
+    {
+        PJ_PUBLISH_BARRIER();
+        return &default_context;
+    }
+
+    pj_acquire_lock();
+
+    if( !default_context_initialized )
+    {
+        default_context.last_errno = 0;
+        default_context.debug_level = PJ_LOG_NONE;
+        default_context.logger = pj_stderr_logger;
+        default_context.app_data = NULL;
+        default_context.thread_count = 0;
+
+        if( getenv("PROJ_DEBUG") != NULL )
+        {
+            if( atoi(getenv("PROJ_DEBUG")) > 0 )
+                default_context.debug_level = atoi(getenv("PROJ_DEBUG"));
+            else
+                default_context.debug_level = PJ_LOG_DEBUG_MINOR;
+        }
+
+        PJ_PUBLISH_BARRIER();
+        default_context_initialized = 1;
+    }
+
+    pj_release_lock();
+
+    return &default_context;
+}
+
+/************************************************************************/
+/*                            pj_ctx_alloc()                            */
+/*                                                                      */
+/*      Each thread wanting to use PROJ.4 concurrently should           */
+/*      allocate its own context, and create its PJs with               */
+/*      pj_init_ctx().  A context must not be used by more than one     */
+/*      thread at a time.                                               */
+/************************************************************************/
+
+projCtx pj_ctx_alloc()
+
+{
+    projCtx ctx = (projCtx_t *) malloc(sizeof(projCtx_t));
+    if( ctx == NULL )
+        return NULL;
+
+    memcpy( ctx, pj_get_default_ctx(), sizeof(projCtx_t) );
+    ctx->last_errno = 0;
+
+    return ctx;
+}
+
+/************************************************************************/
+/*                            pj_ctx_free()                             */
+/************************************************************************/
+
+void pj_ctx_free( projCtx ctx )
+
+{
+    pj_defncache_forget_ctx( ctx );
+    free( ctx );
+}
+
+/************************************************************************/
+/*                          pj_ctx_get_errno()                          */
+/************************************************************************/
+
+int pj_ctx_get_errno( projCtx ctx )
+
+{
+    return ctx->last_errno;
+}
+
+/************************************************************************/
+/*                          pj_ctx_set_errno()                          */
+/*                                                                      */
+/*      Also sets the global errno for applications still relying on    */
+/*      it, but only for non-zero values so that concurrent success     */
+/*      in another thread never clears an error.                        */
+/************************************************************************/
+
+void pj_ctx_set_errno( projCtx ctx, int new_errno )
+
+{
+    ctx->last_errno = new_errno;
+    if( new_errno == 0 )
+        return;
+    pj_errno = new_errno;
+}
+
+/************************************************************************/
+/*                          pj_ctx_set_debug()                          */
+/************************************************************************/
+
+void pj_ctx_set_debug( projCtx ctx, int new_debug )
+
+{
+    ctx->debug_level = new_debug;
+}
+
+/************************************************************************/
+/*                         pj_ctx_set_logger()                          */
+/************************************************************************/
+
+void pj_ctx_set_logger( projCtx ctx, void (*new_logger)(void*,int,const char*) )
+
+{
+    ctx->logger = new_logger;
+}
+
+/************************************************************************/
+/*                        pj_ctx_set_app_data()                         */
+/************************************************************************/
+
+void pj_ctx_set_app_data( projCtx ctx, void *new_app_data )
+
+{
+    ctx->app_data = new_app_data;
+}
+
+/************************************************************************/
+/*                        pj_ctx_get_app_data()                         */
+/************************************************************************/
+
+void *pj_ctx_get_app_data( projCtx ctx )
+
+{
+    return ctx->app_data;
+}
+
+/************************************************************************/
+/*                      pj_ctx_set_thread_count()                       */
+/*                                                                      */
+/*      Allow pj_transform() calls on definitions using this context    */
+/*      to split large requests across up to this many threads.         */
+/*      Zero or one (the default) keeps everything in the calling       */
+/*      thread.                                                         */
+/************************************************************************/
+
+void pj_ctx_set_thread_count( projCtx ctx, int thread_count )
+
+{
+    ctx->thread_count = thread_count;
+}
+
+/************************************************************************/
+/*                      pj_ctx_get_thread_count()                       */
+/************************************************************************/
+
+int pj_ctx_get_thread_count( projCtx ctx )
+
+{
+    return ctx->thread_count;
+}
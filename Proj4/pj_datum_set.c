@@ -37,7 +37,7 @@
 /*                            pj_datum_set()                            */
 /************************************************************************/
 
-int pj_datum_set(paralist *pl, PJ *projdef)
+int pj_datum_set(projCtx ctx, paralist *pl, PJ *projdef)
 
 {
     const char *name, *towgs84, *nadgrids;
@@ -54,37 +54,35 @@ int pj_datum_set(paralist *pl, PJ *projdef)
 /*      definition will last into the pj_ell_set() function called      */
 /*      after this one.                                                 */
 /* -------------------------------------------------------------------- */
-    if( (name = pj_param(pl,"sdatum").s) != NULL )
+    if( (name = pj_param(ctx, pl,"sdatum").s) != NULL )
     {
         paralist *curr;
-        const char *s;
-        int i;
+        struct PJ_DATUMS *datum;
 
-        /* find the end of the list, so we can add to it */
-        for (curr = pl; curr && curr->next ; curr = curr->next) {}
+        /* find the end of our part of the list, so we can add to it */
+        curr = pj_param_tail(pl);
         
         /* find the datum definition */
-        for (i = 0; (s = pj_datums[i].id) && strcmp(name, s) ; ++i) {}
-
-        if (!s) { pj_errno = -9; return 1; }
+        if (!(datum = pj_find_datum(name))) 
+            { pj_ctx_set_errno( ctx, -9 ); return 1; }
 
-        if( pj_datums[i].ellipse_id && strlen(pj_datums[i].ellipse_id) > 0 )
+        if( datum->ellipse_id && strlen(datum->ellipse_id) > 0 )
         {
             char	entry[100];
             
             strcpy( entry, "ellps=" );
-            strncat( entry, pj_datums[i].ellipse_id, 80 );
-            curr = curr->next = pj_mkparam(entry);
+            strncat( entry, datum->ellipse_id, 80 );
+            curr = pj_param_add(curr, entry, PJ_PARAM_APPENDED);
         }
         
-        if( pj_datums[i].defn && strlen(pj_datums[i].defn) > 0 )
-            curr = curr->next = pj_mkparam(pj_datums[i].defn);
+        if( datum->defn && strlen(datum->defn) > 0 )
+            curr = pj_param_add(curr, datum->defn, PJ_PARAM_APPENDED);
     }
 
 /* -------------------------------------------------------------------- */
 /*      Check for nadgrids parameter.                                   */
 /* -------------------------------------------------------------------- */
-    if( (nadgrids = pj_param(pl,"snadgrids").s) != NULL )
+    if( (nadgrids = pj_param(ctx, pl,"snadgrids").s) != NULL )
     {
         /* We don't actually save the value separately.  It will continue
            to exist int he param list for use in pj_apply_gridshift.c */
@@ -95,7 +93,7 @@ int pj_datum_set(paralist *pl, PJ *projdef)
 /* -------------------------------------------------------------------- */
 /*      Check for towgs84 parameter.                                    */
 /* -------------------------------------------------------------------- */
-    else if( (towgs84 = pj_param(pl,"stowgs84").s) != NULL )
+    else if( (towgs84 = pj_param(ctx, pl,"stowgs84").s) != NULL )
     {
         int    parm_count = 0;
         const char *s;
@@ -106,7 +104,7 @@ int pj_datum_set(paralist *pl, PJ *projdef)
         s = towgs84;
         for( s = towgs84; *s != '\0' && parm_count < 7; ) 
         {
-            projdef->datum_params[parm_count++] = atof(s);
+            projdef->datum_params[parm_count++] = pj_atof(s);
             while( *s != '\0' && *s != ',' )
                 s++;
             if( *s == ',' )
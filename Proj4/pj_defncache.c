@@ -0,0 +1,352 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Opt-in cache of whole definitions for pj_init_plus_cached(),
+ *           handing out reference counted PJs shared per context.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Open addressing hash table keyed on the context and the normalized
+** definition, all under the lock.  The cache holds one reference on
+** each PJ, and each pj_init_plus_ctx_cached() caller another, which
+** pj_free() gives back.
+*/
+#define DEFNCACHE_SLOTS (2 * PJ_DEFNCACHE_MAX)
+
+typedef struct {
+    char     *key;
+    unsigned hash;
+    projCtx  ctx;
+    PJ       *defn;
+} PJ_DEFNENTRY;
+
+static PJ_DEFNENTRY defncache[DEFNCACHE_SLOTS];
+static int defncache_count = 0;
+
+/************************************************************************/
+/*                          pj_defncache_key()                          */
+/*                                                                      */
+/*      Normalized form of a definition: its arguments, as              */
+/*      pj_init_plus() would pass them to pj_init(), separated by       */
+/*      single spaces.                                                  */
+/************************************************************************/
+
+static char *pj_defncache_key( int argc, char **argv )
+
+{
+    char   *key;
+    size_t key_len = 1;
+    int    i;
+
+    for( i = 0; i < argc; i++ )
+        key_len += strlen(argv[i]) + 1;
+
+    key = (char *) pj_malloc(key_len);
+    if( key == NULL )
+        return NULL;
+
+    *key = '\0';
+    for( i = 0; i < argc; i++ )
+    {
+        if( i > 0 )
+            strcat( key, " " );
+        strcat( key, argv[i] );
+    }
+
+    return key;
+}
+
+/************************************************************************/
+/*                          pj_defncache_find()                         */
+/*                                                                      */
+/*      Slot holding key for ctx, or the empty slot ending its probe    */
+/*      sequence.                                                       */
+/************************************************************************/
+
+static PJ_DEFNENTRY *pj_defncache_find( projCtx ctx, const char *key, 
+                                        unsigned hash )
+
+{
+    int i = hash & (DEFNCACHE_SLOTS - 1);
+
+    while( defncache[i].key != NULL
+           && (defncache[i].hash != hash || defncache[i].ctx != ctx
+               || strcmp( defncache[i].key, key )) )
+        i = (i + 1) & (DEFNCACHE_SLOTS - 1);
+
+    return defncache + i;
+}
+
+/************************************************************************/
+/*                         pj_defncache_remove()                        */
+/*                                                                      */
+/*      Empty slot i, moving later members of its probe run back so     */
+/*      that they stay reachable.  Must be called with the lock held.   */
+/************************************************************************/
+
+static void pj_defncache_remove( int i )
+
+{
+    int j = i;
+
+    for( ;; )
+    {
+        int k;
+
+        j = (j + 1) & (DEFNCACHE_SLOTS - 1);
+        if( defncache[j].key == NULL )
+            break;
+
+        /* leave j alone if its home slot lies cyclically in (i, j] */
+        k = defncache[j].hash & (DEFNCACHE_SLOTS - 1);
+        if( i <= j ? (i < k && k <= j) : (i < k || k <= j) )
+            continue;
+
+        defncache[i] = defncache[j];
+        i = j;
+    }
+
+    memset( defncache + i, 0, sizeof(PJ_DEFNENTRY) );
+    defncache_count--;
+}
+
+/************************************************************************/
+/*                        pj_init_plus_cached()                         */
+/*                                                                      */
+/*      pj_init_plus_ctx_cached() on the default context.               */
+/************************************************************************/
+
+projPJ pj_init_plus_cached( const char *definition )
+
+{
+    return pj_init_plus_ctx_cached( pj_get_default_ctx(), definition );
+}
+
+/************************************************************************/
+/*                      pj_init_plus_ctx_cached()                       */
+/*                                                                      */
+/*      Same as pj_init_plus_ctx(), but the same definition (up to      */
+/*      white space) on the same context gives back the same PJ,        */
+/*      shared with the other callers using that context.  Calls on     */
+/*      it report errors through the context, so like any PJ it may     */
+/*      only be used by the thread owning the context at the time;      */
+/*      threads wanting their own should each pass their own context.   */
+/*      It must be treated as read only, and is released with           */
+/*      pj_free() as usual.  Once PJ_DEFNCACHE_MAX definitions are      */
+/*      cached, new ones are initialized as by pj_init_plus_ctx().      */
+/************************************************************************/
+
+projPJ pj_init_plus_ctx_cached( projCtx ctx, const char *definition )
+
+{
+    char         *argv[PJ_MAX_ARG];
+    char         *defn_copy, *key;
+    const char   *c;
+    unsigned     hash = 2166136261U;
+    int          argc;
+    PJ           *defn;
+    PJ_DEFNENTRY *entry;
+
+    defn_copy = (char *) pj_malloc( strlen(definition)+1 );
+    if( defn_copy == NULL )
+    {
+        pj_ctx_set_errno( ctx, -2 );
+        return NULL;
+    }
+    strcpy( defn_copy, definition );
+
+    argc = pj_split_definition( ctx, defn_copy, argv );
+    key = argc < 0 ? NULL : pj_defncache_key( argc, argv );
+    if( key == NULL )
+    {
+        pj_dalloc( defn_copy );
+        return NULL;
+    }
+
+    for( c = key; *c != '\0'; c++ )
+        hash = (hash ^ (unsigned char) *c) * 16777619U;
+    hash = (hash ^ (unsigned) ((size_t) ctx >> 4)) * 16777619U;
+
+/* -------------------------------------------------------------------- */
+/*      Hand out another reference if we have it already.               */
+/* -------------------------------------------------------------------- */
+    pj_acquire_lock();
+    entry = pj_defncache_find( ctx, key, hash );
+    if( entry->key != NULL )
+    {
+        defn = entry->defn;
+        defn->refcount++;
+        pj_release_lock();
+
+        pj_dalloc( key );
+        pj_dalloc( defn_copy );
+        return defn;
+    }
+    pj_release_lock();
+
+/* -------------------------------------------------------------------- */
+/*      Otherwise initialize it, and cache it unless another thread     */
+/*      got there first or the cache is full.  Grid lists are           */
+/*      resolved here, so nothing in a cached PJ is filled in later;    */
+/*      if that fails the PJ is handed out uncached, and tries again    */
+/*      on use as usual.                                                */
+/* -------------------------------------------------------------------- */
+    defn = pj_init_ctx( ctx, argc, argv );
+    pj_dalloc( defn_copy );
+    if( defn == NULL )
+    {
+        pj_dalloc( key );
+        return NULL;
+    }
+
+    if( defn->datum_type == PJD_GRIDSHIFT 
+        && pj_gridlist_resolve( defn ) == NULL )
+    {
+        pj_ctx_set_errno( ctx, 0 );
+        pj_dalloc( key );
+        return defn;
+    }
+
+    pj_acquire_lock();
+    entry = pj_defncache_find( ctx, key, hash );
+    if( entry->key != NULL )
+    {
+        PJ *cached = entry->defn;
+
+        cached->refcount++;
+        pj_release_lock();
+
+        pj_dalloc( key );
+        pj_free( defn );
+        return cached;
+    }
+
+    if( defncache_count < PJ_DEFNCACHE_MAX )
+    {
+        entry->key = key;
+        entry->hash = hash;
+        entry->ctx = ctx;
+        entry->defn = defn;
+        defn->refcount = 2;
+        defncache_count++;
+        key = NULL;
+    }
+    pj_release_lock();
+
+    pj_dalloc( key );
+    return defn;
+}
+
+/************************************************************************/
+/*                        pj_defncache_release()                        */
+/*                                                                      */
+/*      Drop a reference to a cached definition, returning the number   */
+/*      left.  pj_free() really frees it only when none are.            */
+/************************************************************************/
+
+int pj_defncache_release( PJ *defn )
+
+{
+    int refcount;
+
+    pj_acquire_lock();
+    refcount = --defn->refcount;
+    pj_release_lock();
+
+    return refcount;
+}
+
+/************************************************************************/
+/*                        pj_clear_defn_cache()                         */
+/*                                                                      */
+/*      Empty the pj_init_plus_cached() cache.  Definitions still       */
+/*      held by callers stay valid until they pj_free() them.           */
+/************************************************************************/
+
+void pj_clear_defn_cache()
+
+{
+    int i;
+
+    for( i = 0; i < DEFNCACHE_SLOTS; i++ )
+    {
+        PJ *defn;
+
+        pj_acquire_lock();
+        defn = defncache[i].defn;
+        pj_dalloc( defncache[i].key );
+        memset( defncache + i, 0, sizeof(PJ_DEFNENTRY) );
+        if( defn != NULL )
+            defncache_count--;
+        pj_release_lock();
+
+        /* the cache's reference */
+        if( defn != NULL )
+            pj_free( defn );
+    }
+}
+
+/************************************************************************/
+/*                      pj_defncache_forget_ctx()                       */
+/*                                                                      */
+/*      Drop the cache's definitions on a context about to be freed.    */
+/*      Callers still holding one keep it valid until pj_free(), but    */
+/*      should not use it once the context is gone.                     */
+/************************************************************************/
+
+void pj_defncache_forget_ctx( projCtx ctx )
+
+{
+    int i = 0;
+
+    pj_acquire_lock();
+    while( defncache_count > 0 && i < DEFNCACHE_SLOTS )
+    {
+        PJ *defn;
+
+        if( defncache[i].key == NULL || defncache[i].ctx != ctx )
+        {
+            i++;
+            continue;
+        }
+
+        /* slot i may be refilled from further on, so look at it again */
+        defn = defncache[i].defn;
+        pj_dalloc( defncache[i].key );
+        pj_defncache_remove( i );
+        pj_release_lock();
+
+        /* the cache's reference */
+        pj_free( defn );
+
+        pj_acquire_lock();
+    }
+    pj_release_lock();
+}
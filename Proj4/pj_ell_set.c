@@ -7,7 +7,7 @@
 #define RV4 .06944444444444444444 /* 5/72 */
 #define RV6 .04243827160493827160 /* 55/1296 */
 	int /* initialize geographic shape parameters */
-pj_ell_set(paralist *pl, double *a, double *es) {
+pj_ell_set(projCtx ctx, paralist *pl, double *a, double *es) {
 	int i;
 	double b=0.0, e;
 	char *name;
@@ -16,67 +16,66 @@ pj_ell_set(paralist *pl, double *a, double *es) {
 		/* check for varying forms of ellipsoid input */
 	*a = *es = 0.;
 	/* R takes precedence */
-	if (pj_param(pl, "tR").i)
-		*a = pj_param(pl, "dR").f;
+	if (pj_param(ctx, pl, "tR").i)
+		*a = pj_param(ctx, pl, "dR").f;
 	else { /* probable elliptical figure */
 
 		/* check if ellps present and temporarily append its values to pl */
-		if ((name = pj_param(pl, "sellps").s)) {
-			char *s;
+		if ((name = pj_param(ctx, pl, "sellps").s)) {
+			struct PJ_ELLPS *ellps;
 
-			for (start = pl; start && start->next ; start = start->next) ;
-			curr = start;
-			for (i = 0; (s = pj_ellps[i].id) && strcmp(name, s) ; ++i) ;
-			if (!s) { pj_errno = -9; return 1; }
-			curr = curr->next = pj_mkparam(pj_ellps[i].major);
-			curr = curr->next = pj_mkparam(pj_ellps[i].ell);
+			start = pj_param_tail(pl);
+			if (!(ellps = pj_find_ellps(name)))
+				{ pj_ctx_set_errno( ctx, -9 ); return 1; }
+			curr = pj_param_add(start, ellps->major, PJ_PARAM_APPENDED);
+			pj_param_add(curr, ellps->ell, PJ_PARAM_APPENDED);
 		}
-		*a = pj_param(pl, "da").f;
-		if (pj_param(pl, "tes").i) /* eccentricity squared */
-			*es = pj_param(pl, "des").f;
-		else if (pj_param(pl, "te").i) { /* eccentricity */
-			e = pj_param(pl, "de").f;
+		*a = pj_param(ctx, pl, "da").f;
+		if (pj_param(ctx, pl, "tes").i) /* eccentricity squared */
+			*es = pj_param(ctx, pl, "des").f;
+		else if (pj_param(ctx, pl, "te").i) { /* eccentricity */
+			e = pj_param(ctx, pl, "de").f;
 			*es = e * e;
-		} else if (pj_param(pl, "trf").i) { /* recip flattening */
-			*es = pj_param(pl, "drf").f;
+		} else if (pj_param(ctx, pl, "trf").i) { /* recip flattening */
+			*es = pj_param(ctx, pl, "drf").f;
 			if (!*es) {
-				pj_errno = -10;
+				pj_ctx_set_errno( ctx, -10 );
 				goto bomb;
 			}
 			*es = 1./ *es;
 			*es = *es * (2. - *es);
-		} else if (pj_param(pl, "tf").i) { /* flattening */
-			*es = pj_param(pl, "df").f;
+		} else if (pj_param(ctx, pl, "tf").i) { /* flattening */
+			*es = pj_param(ctx, pl, "df").f;
 			*es = *es * (2. - *es);
-		} else if (pj_param(pl, "tb").i) { /* minor axis */
-			b = pj_param(pl, "db").f;
+		} else if (pj_param(ctx, pl, "tb").i) { /* minor axis */
+			b = pj_param(ctx, pl, "db").f;
 			*es = 1. - (b * b) / (*a * *a);
 		}     /* else *es == 0. and sphere of radius *a */
 		if (!b)
 			b = *a * sqrt(1. - *es);
 		/* following options turn ellipsoid into equivalent sphere */
-		if (pj_param(pl, "bR_A").i) { /* sphere--area of ellipsoid */
+		if (pj_param(ctx, pl, "bR_A").i) { /* sphere--area of ellipsoid */
 			*a *= 1. - *es * (SIXTH + *es * (RA4 + *es * RA6));
 			*es = 0.;
-		} else if (pj_param(pl, "bR_V").i) { /* sphere--vol. of ellipsoid */
+		} else if (pj_param(ctx, pl, "bR_V").i) { /* sphere--vol. of ellipsoid */
 			*a *= 1. - *es * (SIXTH + *es * (RV4 + *es * RV6));
 			*es = 0.;
-		} else if (pj_param(pl, "bR_a").i) { /* sphere--arithmetic mean */
+		} else if (pj_param(ctx, pl, "bR_a").i) { /* sphere--arithmetic mean */
 			*a = .5 * (*a + b);
 			*es = 0.;
-		} else if (pj_param(pl, "bR_g").i) { /* sphere--geometric mean */
+		} else if (pj_param(ctx, pl, "bR_g").i) { /* sphere--geometric mean */
 			*a = sqrt(*a * b);
 			*es = 0.;
-		} else if (pj_param(pl, "bR_h").i) { /* sphere--harmonic mean */
+		} else if (pj_param(ctx, pl, "bR_h").i) { /* sphere--harmonic mean */
 			*a = 2. * *a * b / (*a + b);
 			*es = 0.;
-		} else if ((i = pj_param(pl, "tR_lat_a").i) || /* sphere--arith. */
-			pj_param(pl, "tR_lat_g").i) { /* or geom. mean at latitude */
+		} else if ((i = pj_param(ctx, pl, "tR_lat_a").i) || /* sphere--arith. */
+			pj_param(ctx, pl, "tR_lat_g").i) { /* or geom. mean at latitude */
 			double tmp;
 
-			tmp = sin(pj_param(pl, i ? "rR_lat_a" : "rR_lat_g").f);
+			tmp = sin(pj_param(ctx, pl, i ? "rR_lat_a" : "rR_lat_g").f);
 			if (fabs(tmp) > HALFPI) {
-				pj_errno = -11;
+				pj_ctx_set_errno( ctx, -11 );
 				goto bomb;
 			}
 			tmp = 1. - *es * tmp * tmp;
@@ -86,17 +85,18 @@ pj_ell_set(paralist *pl, double *a, double *es) {
 		}
 bomb:
 		if (start) { /* clean up temporary extension of list */
-			pj_dalloc(start->next->next);
-			pj_dalloc(start->next);
-			start->next = 0;
+			curr = start->next;
+			start->next = curr->next->next;
+			pj_dalloc(curr->next);
+			pj_dalloc(curr);
 		}
-		if (pj_errno)
+		if (ctx->last_errno)
 			return 1;
 	}
 	/* some remaining checks */
 	if (*es < 0.)
-		{ pj_errno = -12; return 1; }
+		{ pj_ctx_set_errno( ctx, -12 ); return 1; }
 	if (*a <= 0.)
-		{ pj_errno = -13; return 1; }
+		{ pj_ctx_set_errno( ctx, -13 ); return 1; }
 	return 0;
 }
@@ -0,0 +1,545 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Reentrant geodesic (great ellipse) computations on an explicit
+ *           ellipsoid, for single lines and arrays of points.  The method
+ *           is the one the geod program has always used.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+#define MERI_TOL 1e-9
+#define DTOL     1e-12
+
+/* one range of an array request, run by pj_geod_run() */
+typedef struct {
+    const PJ_GEOD *G;
+    int         inverse;
+    long        point_count;
+    int         point_offset;
+    double      *lam, *phi;     /* start points, ends for direct */
+    const double *lam2, *phi2;  /* inverse only */
+    const double *az12, *dist;  /* direct only */
+    double      *dist_out, *az12_out, *az21_out;
+    int         err;
+} PJ_GEOD_JOB;
+
+/************************************************************************/
+/*                           pj_geod_init()                             */
+/*                                                                      */
+/*      Set up G for an ellipsoid of semi-major axis a and squared      */
+/*      eccentricity es (0 for a sphere).                               */
+/************************************************************************/
+
+void pj_geod_init( PJ_GEOD *G, double a, double es )
+
+{
+    memset( G, 0, sizeof(PJ_GEOD) );
+    G->a = a;
+    if( (G->ellipse = es != 0.0) )
+    {
+        G->onef = sqrt(1.0 - es);
+        G->f = 1.0 - G->onef;
+        G->f2 = G->f / 2.0;
+        G->f4 = G->f / 4.0;
+        G->f64 = G->f * G->f / 64.0;
+    }
+    else
+        G->onef = 1.0;
+}
+
+/************************************************************************/
+/*                        pj_geod_line_init()                           */
+/*                                                                      */
+/*      Everything about the geodesic leaving lam1, phi1 at azimuth     */
+/*      al12 that does not depend on the distance along it.             */
+/************************************************************************/
+
+void pj_geod_line_init( PJ_GEOD_LINE *L, const PJ_GEOD *G,
+                        double lam1, double phi1, double al12 )
+
+{
+    L->G = G;
+    L->lam1 = lam1;
+    L->al12 = al12 = adjlon(al12); /* reduce to  +- 0-PI */
+    L->signS = fabs(al12) > HALFPI ? 1 : 0;
+    L->th1 = G->ellipse ? atan(G->onef * tan(phi1)) : phi1;
+    L->costh1 = cos(L->th1);
+    L->sinth1 = sin(L->th1);
+    if( (L->merid = fabs(L->sina12 = sin(al12)) < MERI_TOL) )
+    {
+        L->sina12 = 0.0;
+        L->cosa12 = fabs(al12) < HALFPI ? 1.0 : -1.0;
+        L->M = 0.0;
+    }
+    else
+    {
+        L->cosa12 = cos(al12);
+        L->M = L->costh1 * L->sina12;
+    }
+    L->N = L->costh1 * L->cosa12;
+    if( G->ellipse )
+    {
+        if( L->merid )
+        {
+            L->c1 = 0.0;
+            L->c2 = G->f4;
+            L->D = 1.0 - L->c2;
+            L->D *= L->D;
+            L->P = L->c2 / L->D;
+        }
+        else
+        {
+            L->c1 = G->f * L->M;
+            L->c2 = G->f4 * (1.0 - L->M * L->M);
+            L->D = (1.0 - L->c2) * (1.0 - L->c2 - L->c1 * L->M);
+            L->P = (1.0 + 0.5 * L->c1 * L->M) * L->c2 / L->D;
+        }
+    }
+    if( L->merid )
+        L->s1 = HALFPI - L->th1;
+    else
+    {
+        L->s1 = (fabs(L->M) >= 1.0) ? 0.0 : acos(L->M);
+        L->s1 = L->sinth1 / sin(L->s1);
+        L->s1 = (fabs(L->s1) >= 1.0) ? 0.0 : acos(L->s1);
+    }
+}
+
+/************************************************************************/
+/*                         pj_geod_line_pos()                           */
+/*                                                                      */
+/*      The point S metres along a line, and the azimuth back from      */
+/*      it to the start.                                                */
+/************************************************************************/
+
+void pj_geod_line_pos( const PJ_GEOD_LINE *L, double S,
+                       double *lam2, double *phi2, double *al21 )
+
+{
+    const PJ_GEOD *G = L->G;
+    double d, sind, u, V, X, ds, cosds, sinds, ss = 0.0, de, az, phi;
+
+    if( G->ellipse )
+    {
+        d = S / (L->D * G->a);
+        if( L->signS ) d = -d;
+        u = 2.0 * (L->s1 - d);
+        V = cos(u + d);
+        X = L->c2 * L->c2 * (sind = sin(d)) * cos(d) * (2.0 * V * V - 1.0);
+        ds = d + X - 2.0 * L->P * V * (1.0 - 2.0 * L->P * cos(u)) * sind;
+        ss = L->s1 + L->s1 - ds;
+    }
+    else
+    {
+        ds = S / G->a;
+        if( L->signS ) ds = -ds;
+    }
+    cosds = cos(ds);
+    sinds = sin(ds);
+    if( L->signS ) sinds = -sinds;
+    az = L->N * cosds - L->sinth1 * sinds;
+    if( L->merid )
+    {
+        phi = atan( tan(HALFPI + L->s1 - ds) / G->onef );
+        if( az > 0.0 )
+        {
+            az = PI;
+            if( L->signS )
+                de = PI;
+            else
+            {
+                phi = -phi;
+                de = 0.0;
+            }
+        }
+        else
+        {
+            az = 0.0;
+            if( L->signS )
+            {
+                phi = -phi;
+                de = 0.0;
+            }
+            else
+                de = PI;
+        }
+    }
+    else
+    {
+        az = atan(L->M / az);
+        if( az > 0 )
+            az += PI;
+        if( L->al12 < 0.0 )
+            az -= PI;
+        az = adjlon(az);
+        phi = atan( -(L->sinth1 * cosds + L->N * sinds) * sin(az) /
+                    (G->ellipse ? G->onef * L->M : L->M) );
+        de = atan2( sinds * L->sina12,
+                    (L->costh1 * cosds - L->sinth1 * sinds * L->cosa12) );
+        if( G->ellipse )
+        {
+            if( L->signS )
+                de += L->c1 * ((1.0 - L->c2) * ds +
+                               L->c2 * sinds * cos(ss));
+            else
+                de -= L->c1 * ((1.0 - L->c2) * ds -
+                               L->c2 * sinds * cos(ss));
+        }
+    }
+    *lam2 = adjlon( L->lam1 + de );
+    *phi2 = phi;
+    if( al21 != NULL )
+        *al21 = az;
+}
+
+/************************************************************************/
+/*                         pj_geod_inverse()                            */
+/*                                                                      */
+/*      Distance and azimuths between two points.  Any of the outputs   */
+/*      may be NULL.                                                    */
+/************************************************************************/
+
+void pj_geod_inverse( const PJ_GEOD *G, double lam1, double phi1,
+                      double lam2, double phi2,
+                      double *S, double *al12, double *al21 )
+
+{
+    double th1, th2, thm, dthm, dlamm, dlam, sindlamm, costhm, sinthm,
+        cosdthm, sindthm, L, E, cosd, d, X, Y, T, sind, tandlammp,
+        u, v, D, A, B, dist;
+
+    if( G->ellipse )
+    {
+        th1 = atan(G->onef * tan(phi1));
+        th2 = atan(G->onef * tan(phi2));
+    }
+    else
+    {
+        th1 = phi1;
+        th2 = phi2;
+    }
+    thm = 0.5 * (th1 + th2);
+    dthm = 0.5 * (th2 - th1);
+    dlamm = 0.5 * ( dlam = adjlon(lam2 - lam1) );
+    if( fabs(dlam) < DTOL && fabs(dthm) < DTOL )
+    {
+        if( S != NULL ) *S = 0.0;
+        if( al12 != NULL ) *al12 = 0.0;
+        if( al21 != NULL ) *al21 = 0.0;
+        return;
+    }
+    sindlamm = sin(dlamm);
+    costhm = cos(thm);	sinthm = sin(thm);
+    cosdthm = cos(dthm);	sindthm = sin(dthm);
+    L = sindthm * sindthm + (cosdthm * cosdthm - sinthm * sinthm)
+        * sindlamm * sindlamm;
+    d = acos(cosd = 1 - L - L);
+    if( G->ellipse )
+    {
+        E = cosd + cosd;
+        sind = sin( d );
+        Y = sinthm * cosdthm;
+        Y *= (Y + Y) / (1.0 - L);
+        T = sindthm * costhm;
+        T *= (T + T) / L;
+        X = Y + T;
+        Y -= T;
+        T = d / sind;
+        D = 4.0 * T * T;
+        A = D * E;
+        B = D + D;
+        dist = G->a * sind * (T - G->f4 * (T * X - Y) +
+            G->f64 * (X * (A + (T - 0.5 * (A - E)) * X) -
+            Y * (B + E * Y) + D * X * Y));
+        tandlammp = tan(0.5 * (dlam - 0.25 * (Y + Y - E * (4.0 - X)) *
+            (G->f2 * T + G->f64 * (32.0 * T - (20.0 * T - A)
+            * X - (B + 4.0) * Y)) * tan(dlam)));
+    }
+    else
+    {
+        dist = G->a * d;
+        tandlammp = tan(dlamm);
+    }
+    if( S != NULL )
+        *S = dist;
+    if( al12 == NULL && al21 == NULL )
+        return;
+    u = atan2(sindthm, (tandlammp * costhm));
+    v = atan2(cosdthm, (tandlammp * sinthm));
+    if( al12 != NULL )
+        *al12 = adjlon(TWOPI + v - u);
+    if( al21 != NULL )
+        *al21 = adjlon(TWOPI - v - u);
+}
+
+/************************************************************************/
+/*                           pj_geod_run()                              */
+/*                                                                      */
+/*      Do one range of an array request.                               */
+/************************************************************************/
+
+static void pj_geod_run( PJ_GEOD_JOB *job )
+
+{
+    PJ_GEOD_LINE line;
+    long         i, io;
+
+    for( i = io = 0; i < job->point_count; i++, io += job->point_offset )
+    {
+        double lam1 = job->lam[io], phi1 = job->phi[io];
+
+        if( lam1 == HUGE_VAL )
+            continue;
+
+        if( job->inverse )
+        {
+            double lam2 = job->lam2[io], phi2 = job->phi2[io];
+
+            if( lam2 == HUGE_VAL )
+                continue;
+            if( fabs(phi1) > HALFPI || fabs(phi2) > HALFPI )
+            {
+                if( job->dist_out != NULL ) job->dist_out[io] = HUGE_VAL;
+                if( job->az12_out != NULL ) job->az12_out[io] = HUGE_VAL;
+                if( job->az21_out != NULL ) job->az21_out[io] = HUGE_VAL;
+                if( job->err == 0 )
+                    job->err = -14;
+                continue;
+            }
+
+            pj_geod_inverse( job->G, lam1, phi1, lam2, phi2,
+                             job->dist_out != NULL ? job->dist_out + io : NULL,
+                             job->az12_out != NULL ? job->az12_out + io : NULL,
+                             job->az21_out != NULL ? job->az21_out + io : NULL );
+        }
+        else
+        {
+            if( fabs(phi1) > HALFPI )
+            {
+                job->lam[io] = job->phi[io] = HUGE_VAL;
+                if( job->az21_out != NULL ) job->az21_out[io] = HUGE_VAL;
+                if( job->err == 0 )
+                    job->err = -14;
+                continue;
+            }
+
+            pj_geod_line_init( &line, job->G, lam1, phi1, job->az12[io] );
+            pj_geod_line_pos( &line, job->dist[io], job->lam + io,
+                              job->phi + io,
+                              job->az21_out != NULL ? job->az21_out + io : NULL );
+        }
+    }
+}
+
+/************************************************************************/
+/*                       pj_geod_worker_main()                          */
+/************************************************************************/
+
+static void pj_geod_worker_main( void *arg )
+
+{
+    pj_geod_run( (PJ_GEOD_JOB *) arg );
+}
+
+/************************************************************************/
+/*                          pj_geod_split()                             */
+/*                                                                      */
+/*      Run a request, split into one contiguous range per thread       */
+/*      where the context asks for threads and the request is big       */
+/*      enough.  The calling thread takes the first range, and any      */
+/*      range whose thread cannot be started.  Returns the first        */
+/*      error in point order, also set on the context.                  */
+/************************************************************************/
+
+static int pj_geod_split( PJ_GEOD_JOB *job )
+
+{
+    PJ_GEOD_JOB *jobs = NULL;
+    int         thread_count;
+    int         i, err = 0;
+    long        start = 0, chunk;
+
+    thread_count = pj_job_count( job->G->ctx, (double) job->point_count,
+                                 PJ_PARALLEL_MIN_POINTS );
+    if( thread_count >= 2 )
+        jobs = (PJ_GEOD_JOB *) pj_malloc(sizeof(PJ_GEOD_JOB) * thread_count);
+
+    if( jobs == NULL )
+    {
+        pj_geod_run( job );
+        err = job->err;
+    }
+    else
+    {
+        chunk = (job->point_count + thread_count - 1) / thread_count;
+        for( i = 0; i < thread_count; i++ )
+        {
+            PJ_GEOD_JOB *w = jobs + i;
+            long        skip = start * job->point_offset;
+
+            *w = *job;
+            w->point_count = MIN(chunk, job->point_count - start);
+            w->lam = job->lam + skip;
+            w->phi = job->phi + skip;
+            if( job->inverse )
+            {
+                w->lam2 = job->lam2 + skip;
+                w->phi2 = job->phi2 + skip;
+            }
+            else
+            {
+                w->az12 = job->az12 + skip;
+                w->dist = job->dist + skip;
+            }
+            if( job->dist_out != NULL ) w->dist_out = job->dist_out + skip;
+            if( job->az12_out != NULL ) w->az12_out = job->az12_out + skip;
+            if( job->az21_out != NULL ) w->az21_out = job->az21_out + skip;
+            start += w->point_count;
+        }
+
+        pj_run_jobs( job->G->ctx, thread_count, pj_geod_worker_main,
+                     jobs, sizeof(PJ_GEOD_JOB) );
+
+        for( i = 0; i < thread_count; i++ )
+        {
+            if( err == 0 )
+                err = jobs[i].err;
+        }
+        pj_dalloc( jobs );
+    }
+
+    if( err != 0 )
+        pj_ctx_set_errno( job->G->ctx, err );
+
+    return err;
+}
+
+/************************************************************************/
+/*                          pj_geod_create()                            */
+/*                                                                      */
+/*      Geodesics on the ellipsoid of defn, which may be any            */
+/*      definition.  The definition is not needed afterwards; errors    */
+/*      and the thread count come from its context.                     */
+/************************************************************************/
+
+PJ_GEOD *pj_geod_create( PJ *defn )
+
+{
+    PJ_GEOD *G;
+
+    if( defn == NULL )
+        return NULL;
+
+    G = (PJ_GEOD *) pj_malloc(sizeof(PJ_GEOD));
+    if( G == NULL )
+    {
+        pj_ctx_set_errno( defn->ctx, -2 );
+        return NULL;
+    }
+
+    pj_geod_init( G, defn->a_orig, defn->es_orig );
+    G->ctx = defn->ctx;
+
+    return G;
+}
+
+/************************************************************************/
+/*                            pj_geod_fwd()                             */
+/*                                                                      */
+/*      The direct problem for arrays of points: each lam, phi          */
+/*      (radians) is replaced by the point dist metres away from it     */
+/*      at azimuth az12 (radians, clockwise from north).  The azimuth   */
+/*      back to the start is stored in az21 unless it is NULL.  Points  */
+/*      already HUGE_VAL are skipped; those that fail are set to        */
+/*      HUGE_VAL and the first error is returned, otherwise 0.          */
+/************************************************************************/
+
+int pj_geod_fwd( PJ_GEOD *G, long point_count, int point_offset,
+                 double *lam, double *phi,
+                 const double *az12, const double *dist, double *az21 )
+
+{
+    PJ_GEOD_JOB job;
+
+    memset( &job, 0, sizeof(job) );
+    job.G = G;
+    job.point_count = point_count;
+    job.point_offset = point_offset == 0 ? 1 : point_offset;
+    job.lam = lam;
+    job.phi = phi;
+    job.az12 = az12;
+    job.dist = dist;
+    job.az21_out = az21;
+
+    return pj_geod_split( &job );
+}
+
+/************************************************************************/
+/*                            pj_geod_inv()                             */
+/*                                                                      */
+/*      The inverse problem for arrays of point pairs: the distance     */
+/*      in metres from lam1, phi1 to lam2, phi2 and the azimuths at     */
+/*      each end.  Any of dist, az12 and az21 may be NULL, and those    */
+/*      that are not get the same point_offset as the inputs.           */
+/************************************************************************/
+
+int pj_geod_inv( PJ_GEOD *G, long point_count, int point_offset,
+                 const double *lam1, const double *phi1,
+                 const double *lam2, const double *phi2,
+                 double *dist, double *az12, double *az21 )
+
+{
+    PJ_GEOD_JOB job;
+
+    memset( &job, 0, sizeof(job) );
+    job.G = G;
+    job.inverse = 1;
+    job.point_count = point_count;
+    job.point_offset = point_offset == 0 ? 1 : point_offset;
+    job.lam = (double *) lam1;
+    job.phi = (double *) phi1;
+    job.lam2 = lam2;
+    job.phi2 = phi2;
+    job.dist_out = dist;
+    job.az12_out = az12;
+    job.az21_out = az21;
+
+    return pj_geod_split( &job );
+}
+
+/************************************************************************/
+/*                           pj_geod_free()                             */
+/************************************************************************/
+
+void pj_geod_free( PJ_GEOD *G )
+
+{
+    if( G != NULL )
+        pj_dalloc( G );
+}
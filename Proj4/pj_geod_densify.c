@@ -0,0 +1,338 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Points at even spacing along geodesics, for densifying lines
+ *           before they are reprojected.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/* most segments a line may be split into */
+#define MAX_SEGMENTS 1e9
+
+typedef struct {
+    long        first_line, line_count;
+    PJ_GEOD_DENSIFY *lines;     /* set up, count 0 for a failed line */
+    const long  *first;
+    double      *lam, *phi;
+} PJ_GEOD_DENSIFY_JOB;
+
+/************************************************************************/
+/*                          densify_setup()                             */
+/*                                                                      */
+/*      Set up D for the geodesic from lam1, phi1 to lam2, phi2 split   */
+/*      into segments no longer than max_segment metres nor max_angle   */
+/*      radians of arc; a limit that is not positive is not used.       */
+/*      Returns 0, or -14 for a latitude out of range or -20 for more   */
+/*      than MAX_SEGMENTS segments.                                     */
+/************************************************************************/
+
+static int densify_setup( PJ_GEOD_DENSIFY *D, const PJ_GEOD *G,
+                          double lam1, double phi1, double lam2, double phi2,
+                          double max_segment, double max_angle )
+
+{
+    double S, az12, step = HUGE_VAL, segments;
+
+    memset( D, 0, sizeof(PJ_GEOD_DENSIFY) );
+    if( lam1 == HUGE_VAL || lam2 == HUGE_VAL
+        || fabs(phi1) > HALFPI || fabs(phi2) > HALFPI )
+        return -14;
+
+    pj_geod_inverse( G, lam1, phi1, lam2, phi2, &S, &az12, NULL );
+    pj_geod_line_init( &(D->line), G, lam1, phi1, az12 );
+
+    if( max_segment > 0.0 )
+        step = max_segment;
+    if( max_angle > 0.0 && G->a * max_angle < step )
+        step = G->a * max_angle;
+
+    segments = step == HUGE_VAL ? 1.0 : ceil(S / step);
+    if( segments > MAX_SEGMENTS )
+        return -20;
+    if( !(segments >= 1.0) )
+        segments = 1.0;
+
+    D->lam1 = lam1;
+    D->phi1 = phi1;
+    D->lam2 = lam2;
+    D->phi2 = phi2;
+    D->count = (long) segments + 1;
+    D->step = S / segments;
+    return 0;
+}
+
+/************************************************************************/
+/*                      pj_geod_densify_create()                        */
+/*                                                                      */
+/*      Start streaming the points along the geodesic from lam1, phi1   */
+/*      to lam2, phi2 (radians), evenly spaced so that no segment is    */
+/*      longer than max_segment metres nor max_angle radians of arc     */
+/*      (either may be 0 for no limit).  The ends are included.         */
+/************************************************************************/
+
+PJ_GEOD_DENSIFY *pj_geod_densify_create( PJ_GEOD *G,
+                                         double lam1, double phi1,
+                                         double lam2, double phi2,
+                                         double max_segment,
+                                         double max_angle )
+
+{
+    PJ_GEOD_DENSIFY *D;
+    int             err;
+
+    D = (PJ_GEOD_DENSIFY *) pj_malloc(sizeof(PJ_GEOD_DENSIFY));
+    if( D == NULL )
+    {
+        pj_ctx_set_errno( G->ctx, -2 );
+        return NULL;
+    }
+
+    err = densify_setup( D, G, lam1, phi1, lam2, phi2,
+                         max_segment, max_angle );
+    if( err != 0 )
+    {
+        pj_dalloc( D );
+        pj_ctx_set_errno( G->ctx, err );
+        return NULL;
+    }
+
+    return D;
+}
+
+/************************************************************************/
+/*                       pj_geod_densify_count()                        */
+/*                                                                      */
+/*      Points in the whole line, ends included.                        */
+/************************************************************************/
+
+long pj_geod_densify_count( PJ_GEOD_DENSIFY *D )
+
+{
+    return D->count;
+}
+
+/************************************************************************/
+/*                       pj_geod_densify_read()                         */
+/*                                                                      */
+/*      Write the next points of the line, up to max_points of them,    */
+/*      into lam and phi.  Returns how many were written, 0 once the    */
+/*      line is done.  The ends are written as given rather than as     */
+/*      computed.                                                       */
+/************************************************************************/
+
+long pj_geod_densify_read( PJ_GEOD_DENSIFY *D, long max_points,
+                           double *lam, double *phi )
+
+{
+    long i, n = MIN(max_points, D->count - D->next);
+
+    for( i = 0; i < n; i++, D->next++ )
+    {
+        if( D->next == 0 )
+        {
+            lam[i] = D->lam1;
+            phi[i] = D->phi1;
+        }
+        else if( D->next == D->count - 1 )
+        {
+            lam[i] = D->lam2;
+            phi[i] = D->phi2;
+        }
+        else
+            pj_geod_line_pos( &(D->line), D->next * D->step,
+                              lam + i, phi + i, NULL );
+    }
+
+    return n;
+}
+
+/************************************************************************/
+/*                       pj_geod_densify_free()                         */
+/************************************************************************/
+
+void pj_geod_densify_free( PJ_GEOD_DENSIFY *D )
+
+{
+    if( D != NULL )
+        pj_dalloc( D );
+}
+
+/************************************************************************/
+/*                           densify_run()                              */
+/************************************************************************/
+
+static void densify_run( PJ_GEOD_DENSIFY_JOB *job )
+
+{
+    long            i;
+
+    for( i = job->first_line; i < job->first_line + job->line_count; i++ )
+    {
+        long first = job->first[i], count = job->first[i + 1] - first;
+
+        if( job->lines[i].count == 0 )
+        {
+            long k;
+
+            for( k = 0; k < count; k++ )
+                job->lam[first + k] = job->phi[first + k] = HUGE_VAL;
+            continue;
+        }
+
+        pj_geod_densify_read( job->lines + i, count,
+                              job->lam + first, job->phi + first );
+    }
+}
+
+/************************************************************************/
+/*                       densify_worker_main()                          */
+/************************************************************************/
+
+static void densify_worker_main( void *arg )
+
+{
+    densify_run( (PJ_GEOD_DENSIFY_JOB *) arg );
+}
+
+/************************************************************************/
+/*                          pj_geod_densify()                           */
+/*                                                                      */
+/*      Densify line_count geodesics at once, each as                   */
+/*      pj_geod_densify_create() would.  first must have room for       */
+/*      line_count + 1 values: first[i] is set to where the points      */
+/*      of line i start in lam and phi, and first[line_count] to the    */
+/*      number of points in all.  With lam or phi NULL only first is    */
+/*      filled in, so the caller can size the buffers.  Otherwise       */
+/*      each line is kept as set up for counting, to write its          */
+/*      points from.                                                    */
+/*                                                                      */
+/*      A line with an end out of range gets two HUGE_VAL points, and   */
+/*      the first such error is returned, otherwise 0.  Big requests    */
+/*      are split over the context's thread count by lines, with        */
+/*      about the same number of points for each thread.                */
+/************************************************************************/
+
+int pj_geod_densify( PJ_GEOD *G, long line_count,
+                     const double *lam1, const double *phi1,
+                     const double *lam2, const double *phi2,
+                     double max_segment, double max_angle,
+                     long *first, double *lam, double *phi )
+
+{
+    PJ_GEOD_DENSIFY     one, *D = &one, *lines = NULL;
+    PJ_GEOD_DENSIFY_JOB job, *jobs = NULL;
+    int                 thread_count;
+    int                 i, err = 0;
+    long                line, total = 0;
+
+    if( lam != NULL && phi != NULL && line_count > 0 )
+    {
+        lines = (PJ_GEOD_DENSIFY *)
+            pj_malloc(sizeof(PJ_GEOD_DENSIFY) * line_count);
+        if( lines == NULL )
+        {
+            pj_ctx_set_errno( G->ctx, -2 );
+            return -2;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Set up each line and count its points.                          */
+/* -------------------------------------------------------------------- */
+    for( line = 0; line < line_count; line++ )
+    {
+        int line_err;
+
+        if( lines != NULL )
+            D = lines + line;
+        line_err = densify_setup( D, G, lam1[line], phi1[line],
+                                  lam2[line], phi2[line],
+                                  max_segment, max_angle );
+        if( line_err != 0 && err == 0 )
+            err = line_err;
+        first[line] = total;
+        total += line_err != 0 ? 2 : D->count;
+    }
+    first[line_count] = total;
+
+    if( lines == NULL )
+    {
+        if( err != 0 )
+            pj_ctx_set_errno( G->ctx, err );
+        return err;
+    }
+
+    memset( &job, 0, sizeof(job) );
+    job.line_count = line_count;
+    job.lines = lines;
+    job.first = first;
+    job.lam = lam;
+    job.phi = phi;
+
+/* -------------------------------------------------------------------- */
+/*      Then write them, split by points over the threads.              */
+/* -------------------------------------------------------------------- */
+    thread_count = pj_job_count( G->ctx, (double) total,
+                                 PJ_PARALLEL_MIN_POINTS );
+    if( thread_count > line_count )
+        thread_count = (int) line_count;
+    if( thread_count >= 2 )
+        jobs = (PJ_GEOD_DENSIFY_JOB *)
+            pj_malloc(sizeof(PJ_GEOD_DENSIFY_JOB) * thread_count);
+
+    if( jobs == NULL )
+        densify_run( &job );
+    else
+    {
+        line = 0;
+        for( i = 0; i < thread_count; i++ )
+        {
+            long start = line;
+            double share = (double) total * (i + 1) / thread_count;
+
+            while( line < line_count
+                   && (i == thread_count - 1 || first[line] < share) )
+                line++;
+
+            jobs[i] = job;
+            jobs[i].first_line = start;
+            jobs[i].line_count = line - start;
+        }
+
+        pj_run_jobs( G->ctx, thread_count, densify_worker_main,
+                     jobs, sizeof(PJ_GEOD_DENSIFY_JOB) );
+        pj_dalloc( jobs );
+    }
+    pj_dalloc( lines );
+
+    if( err != 0 )
+        pj_ctx_set_errno( G->ctx, err );
+
+    return err;
+}
@@ -0,0 +1,346 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Geodesic distances between every point of one set and every
+ *           point of another, optionally only those under a threshold.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/* columns done against each row at a time, small enough to stay in cache */
+#define MATRIX_TILE 256
+
+#define DTOL 1e-12
+
+/*
+** What the inverse needs of each point, computed once rather than once
+** per pair: its reduced latitude and longitude, and the sine and cosine
+** of half of each.  The half-sum and half-difference terms of
+** pj_geod_inverse() follow from these by the angle sum formulas.
+*/
+typedef struct {
+    long        count;
+    double      *th, *sh, *ch;  /* reduced latitude, sin, cos of half */
+    double      *lam, *sl, *cl; /* longitude, sin, cos of half */
+} PJ_GEOD_TERMS;
+
+typedef struct {
+    const PJ_GEOD       *G;
+    const PJ_GEOD_TERMS *rows, *cols;
+    long        first_row, row_count;
+    double      *dist;          /* row first_row of the matrix */
+    double      max_dist, max_L;
+} PJ_GEOD_MATRIX_JOB;
+
+/************************************************************************/
+/*                          matrix_terms()                              */
+/*                                                                      */
+/*      Fill in T for count points.  Points that are HUGE_VAL or off    */
+/*      the ellipsoid get HUGE_VAL latitude terms, and the latter       */
+/*      count as an error.  Returns 0, -14, or -2 if out of memory.     */
+/************************************************************************/
+
+static int matrix_terms( const PJ_GEOD *G, PJ_GEOD_TERMS *T, long count,
+                         const double *lam, const double *phi )
+
+{
+    long i;
+    int  err = 0;
+
+    T->count = count;
+    T->th = (double *) pj_malloc(sizeof(double) * 6 * (count > 0 ? count : 1));
+    if( T->th == NULL )
+        return -2;
+    T->sh = T->th + count;
+    T->ch = T->sh + count;
+    T->lam = T->ch + count;
+    T->sl = T->lam + count;
+    T->cl = T->sl + count;
+
+    for( i = 0; i < count; i++ )
+    {
+        double th;
+
+        if( lam[i] == HUGE_VAL || fabs(phi[i]) > HALFPI )
+        {
+            if( lam[i] != HUGE_VAL && err == 0 )
+                err = -14;
+            T->th[i] = HUGE_VAL;
+            continue;
+        }
+
+        th = G->ellipse ? atan(G->onef * tan(phi[i])) : phi[i];
+        T->th[i] = th;
+        T->sh[i] = sin(0.5 * th);
+        T->ch[i] = cos(0.5 * th);
+        T->lam[i] = lam[i];
+        T->sl[i] = sin(0.5 * lam[i]);
+        T->cl[i] = cos(0.5 * lam[i]);
+    }
+
+    return err;
+}
+
+/************************************************************************/
+/*                           matrix_row()                               */
+/*                                                                      */
+/*      Distances from row point i to columns first to last-1, as       */
+/*      pj_geod_inverse() would give them.                              */
+/************************************************************************/
+
+static void matrix_row( const PJ_GEOD_MATRIX_JOB *job, long i,
+                        long first, long last, double *out )
+
+{
+    const PJ_GEOD       *G = job->G;
+    const PJ_GEOD_TERMS *C = job->cols;
+    double th1, sh1, ch1, lam1, sl1, cl1;
+    long   j;
+
+    th1 = job->rows->th[i];
+    if( th1 == HUGE_VAL )
+    {
+        for( j = first; j < last; j++ )
+            out[j] = HUGE_VAL;
+        return;
+    }
+    sh1 = job->rows->sh[i];
+    ch1 = job->rows->ch[i];
+    lam1 = job->rows->lam[i];
+    sl1 = job->rows->sl[i];
+    cl1 = job->rows->cl[i];
+
+    for( j = first; j < last; j++ )
+    {
+        double sinthm, costhm, sindthm, cosdthm, sindlamm, L, d, sind, S;
+        double E, X, Y, T, D, A, B;
+
+        if( C->th[j] == HUGE_VAL )
+        {
+            out[j] = HUGE_VAL;
+            continue;
+        }
+
+        sinthm = sh1 * C->ch[j] + ch1 * C->sh[j];
+        costhm = ch1 * C->ch[j] - sh1 * C->sh[j];
+        sindthm = C->sh[j] * ch1 - C->ch[j] * sh1;
+        cosdthm = C->ch[j] * ch1 + C->sh[j] * sh1;
+        /* sin^2 of half the longitude difference, whichever way round */
+        sindlamm = C->sl[j] * cl1 - C->cl[j] * sl1;
+        sindlamm *= sindlamm;
+
+        L = sindthm * sindthm
+            + (cosdthm * cosdthm - sinthm * sinthm) * sindlamm;
+
+/* -------------------------------------------------------------------- */
+/*      Too far for the threshold even on the smallest sphere that      */
+/*      could hold the geodesic?                                        */
+/* -------------------------------------------------------------------- */
+        if( L > job->max_L )
+        {
+            out[j] = HUGE_VAL;
+            continue;
+        }
+
+        /* the same points as far as pj_geod_inverse() is concerned */
+        if( L < 2.0 * DTOL * DTOL
+            && fabs(adjlon(C->lam[j] - lam1)) < DTOL
+            && fabs(0.5 * (C->th[j] - th1)) < DTOL )
+        {
+            out[j] = 0.0;
+            continue;
+        }
+
+        d = acos(1 - L - L);
+        if( G->ellipse )
+        {
+            E = 2.0 * (1 - L - L);
+            sind = 2.0 * sqrt(L * (1.0 - L)); /* sin(d) */
+            Y = sinthm * cosdthm;
+            Y *= (Y + Y) / (1.0 - L);
+            T = sindthm * costhm;
+            T *= (T + T) / L;
+            X = Y + T;
+            Y -= T;
+            T = d / sind;
+            D = 4.0 * T * T;
+            A = D * E;
+            B = D + D;
+            S = G->a * sind * (T - G->f4 * (T * X - Y) +
+                G->f64 * (X * (A + (T - 0.5 * (A - E)) * X) -
+                Y * (B + E * Y) + D * X * Y));
+        }
+        else
+            S = G->a * d;
+
+        out[j] = S > job->max_dist ? HUGE_VAL : S;
+    }
+}
+
+/************************************************************************/
+/*                           matrix_run()                               */
+/*                                                                      */
+/*      One worker's rows, a tile of columns at a time so the column    */
+/*      terms are reused from cache across the rows.                    */
+/************************************************************************/
+
+static void matrix_run( PJ_GEOD_MATRIX_JOB *job )
+
+{
+    long col_count = job->cols->count, first, last, i;
+
+    for( first = 0; first < col_count; first = last )
+    {
+        last = MIN(first + MATRIX_TILE, col_count);
+        for( i = 0; i < job->row_count; i++ )
+            matrix_row( job, job->first_row + i, first, last,
+                        job->dist + i * col_count );
+    }
+}
+
+/************************************************************************/
+/*                       matrix_worker_main()                           */
+/************************************************************************/
+
+static void matrix_worker_main( void *arg )
+
+{
+    matrix_run( (PJ_GEOD_MATRIX_JOB *) arg );
+}
+
+/************************************************************************/
+/*                          pj_geod_matrix()                            */
+/*                                                                      */
+/*      The distance in metres from each of row_count points lam1,      */
+/*      phi1 to each of col_count points lam2, phi2 (radians), into     */
+/*      dist[row * col_count + col].  The values are the ones           */
+/*      pj_geod_inv() gives.                                            */
+/*                                                                      */
+/*      If max_dist is positive only distances up to it are wanted,     */
+/*      and the others are set to HUGE_VAL.  Most far pairs are then    */
+/*      rejected on a spherical lower bound before the ellipsoidal      */
+/*      distance is worked out, which makes threshold queries much      */
+/*      cheaper.  Points that are HUGE_VAL give HUGE_VAL distances;     */
+/*      ones with latitudes out of range do too, and the return is      */
+/*      then -14, otherwise 0.                                          */
+/*                                                                      */
+/*      Rows are split across the context's thread count for large      */
+/*      matrices.                                                       */
+/************************************************************************/
+
+int pj_geod_matrix( PJ_GEOD *G, long row_count,
+                    const double *lam1, const double *phi1,
+                    long col_count, const double *lam2, const double *phi2,
+                    double *dist, double max_dist )
+
+{
+    PJ_GEOD_TERMS      rows, cols;
+    PJ_GEOD_MATRIX_JOB job, *jobs = NULL;
+    int                thread_count;
+    int                i, err, col_err;
+    long               first = 0, chunk;
+
+    if( row_count <= 0 || col_count <= 0 )
+        return 0;
+
+    memset( &rows, 0, sizeof(rows) );
+    memset( &cols, 0, sizeof(cols) );
+    err = matrix_terms( G, &rows, row_count, lam1, phi1 );
+    col_err = rows.th == NULL ? 0 : matrix_terms( G, &cols, col_count, lam2, phi2 );
+    if( rows.th == NULL || cols.th == NULL )
+    {
+        pj_dalloc( rows.th );
+        pj_dalloc( cols.th );
+        pj_ctx_set_errno( G->ctx, -2 );
+        return -2;
+    }
+    if( err == 0 )
+        err = col_err;
+
+    memset( &job, 0, sizeof(job) );
+    job.G = G;
+    job.rows = &rows;
+    job.cols = &cols;
+    job.row_count = row_count;
+    job.dist = dist;
+
+/* -------------------------------------------------------------------- */
+/*      The geodesic is no shorter than b times the angle between the   */
+/*      points on the sphere of reduced latitudes, less f for the       */
+/*      difference in longitude there; allow 2f.  L is the squared      */
+/*      sine of half that angle.                                        */
+/* -------------------------------------------------------------------- */
+    job.max_dist = HUGE_VAL;
+    job.max_L = HUGE_VAL;
+    if( max_dist > 0.0 )
+    {
+        double sigma = max_dist / (G->a * G->onef * (1.0 - 2.0 * G->f));
+
+        job.max_dist = max_dist;
+        if( sigma < PI )
+            job.max_L = sin(0.5 * sigma) * sin(0.5 * sigma);
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Split the rows over the threads.                                */
+/* -------------------------------------------------------------------- */
+    thread_count = pj_job_count( G->ctx, (double) row_count * col_count,
+                                 PJ_PARALLEL_MIN_POINTS );
+    if( thread_count > row_count )
+        thread_count = (int) row_count;
+    if( thread_count >= 2 )
+        jobs = (PJ_GEOD_MATRIX_JOB *)
+            pj_malloc(sizeof(PJ_GEOD_MATRIX_JOB) * thread_count);
+
+    if( jobs == NULL )
+        matrix_run( &job );
+    else
+    {
+        chunk = (row_count + thread_count - 1) / thread_count;
+        for( i = 0; i < thread_count; i++ )
+        {
+            jobs[i] = job;
+            jobs[i].first_row = first;
+            jobs[i].row_count = MIN(chunk, row_count - first);
+            jobs[i].dist = dist + first * col_count;
+            first += jobs[i].row_count;
+        }
+
+        pj_run_jobs( G->ctx, thread_count, matrix_worker_main,
+                     jobs, sizeof(PJ_GEOD_MATRIX_JOB) );
+        pj_dalloc( jobs );
+    }
+
+    pj_dalloc( rows.th );
+    pj_dalloc( cols.th );
+
+    if( err != 0 )
+        pj_ctx_set_errno( G->ctx, err );
+
+    return err;
+}
@@ -0,0 +1,238 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Bucket index over the extents of a list of grid shift files,
+ *           so that pj_apply_gridlist() does not have to test every grid
+ *           (or NTv2 subgrid) for every point.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#define PJ_LIB__
+
+#include <projects.h>
+#include <string.h>
+#include <math.h>
+
+PJ_CVSID("$Id$");
+
+/* upper bound on buckets in each direction */
+#define MAX_BUCKETS 256
+
+/************************************************************************/
+/*                         pj_gridindex_bucket()                        */
+/*                                                                      */
+/*      Bucket row or column holding value v, clamped to the index.     */
+/*      This is monotonic in v, so a grid registered in the buckets     */
+/*      of its two corners is found for every point it covers.          */
+/************************************************************************/
+
+static int pj_gridindex_bucket( double v, double ll, double del, int lim )
+
+{
+    double b = floor( (v - ll) / del );
+
+    if( !(b >= 0.0) )
+        return 0;
+    if( b >= lim )
+        return lim - 1;
+    return (int) b;
+}
+
+/************************************************************************/
+/*                         pj_gridindex_range()                         */
+/*                                                                      */
+/*      Bucket rectangle covered by a grid's extent.                    */
+/************************************************************************/
+
+static void pj_gridindex_range( PJ_GRIDINDEX *index, struct CTABLE *ct,
+                                int *lam_min, int *lam_max,
+                                int *phi_min, int *phi_max )
+
+{
+    *lam_min = pj_gridindex_bucket( ct->ll.lam, index->ll.lam,
+                                    index->del.lam, index->lim.lam );
+    *lam_max = pj_gridindex_bucket( ct->ll.lam + (ct->lim.lam-1)*ct->del.lam,
+                                    index->ll.lam, index->del.lam,
+                                    index->lim.lam );
+    *phi_min = pj_gridindex_bucket( ct->ll.phi, index->ll.phi,
+                                    index->del.phi, index->lim.phi );
+    *phi_max = pj_gridindex_bucket( ct->ll.phi + (ct->lim.phi-1)*ct->del.phi,
+                                    index->ll.phi, index->del.phi,
+                                    index->lim.phi );
+}
+
+/************************************************************************/
+/*                        pj_gridindex_create()                         */
+/*                                                                      */
+/*      Build an index over grids[0..grid_count-1], which must all      */
+/*      have a CTABLE.  The area covered by the grids is cut into       */
+/*      about four buckets per grid, and each bucket lists, in their    */
+/*      original order, the grids overlapping it.  Returns NULL for     */
+/*      short lists, where a linear scan is as good, or on failure.     */
+/************************************************************************/
+
+PJ_GRIDINDEX *pj_gridindex_create( PJ_GRIDINFO **grids, int grid_count )
+
+{
+    PJ_GRIDINDEX *index;
+    LP    ur;
+    int   i, side, bucket_count, entry_count;
+    int   *fill;
+
+    if( grid_count < PJ_GRIDINDEX_MIN )
+        return NULL;
+
+    index = (PJ_GRIDINDEX *) pj_malloc(sizeof(PJ_GRIDINDEX));
+    if( index == NULL )
+        return NULL;
+    memset( index, 0, sizeof(PJ_GRIDINDEX) );
+
+/* -------------------------------------------------------------------- */
+/*      Work out the bounds and bucket size.                            */
+/* -------------------------------------------------------------------- */
+    index->ll.lam = index->ll.phi = HUGE_VAL;
+    ur.lam = ur.phi = -HUGE_VAL;
+    for( i = 0; i < grid_count; i++ )
+    {
+        struct CTABLE *ct = grids[i]->ct;
+
+        index->ll.lam = MIN(index->ll.lam, ct->ll.lam);
+        index->ll.phi = MIN(index->ll.phi, ct->ll.phi);
+        ur.lam = MAX(ur.lam, ct->ll.lam + (ct->lim.lam-1) * ct->del.lam);
+        ur.phi = MAX(ur.phi, ct->ll.phi + (ct->lim.phi-1) * ct->del.phi);
+    }
+
+    for( side = 1; side * side < 4 * grid_count && side < MAX_BUCKETS; )
+        side++;
+
+    index->lim.lam = index->lim.phi = side;
+    index->del.lam = (ur.lam - index->ll.lam) / side;
+    index->del.phi = (ur.phi - index->ll.phi) / side;
+    if( index->del.lam <= 0.0 )
+        index->del.lam = 1.0;
+    if( index->del.phi <= 0.0 )
+        index->del.phi = 1.0;
+
+    bucket_count = side * side;
+    index->grid_count = grid_count;
+    index->grids = (PJ_GRIDINFO **) pj_malloc(sizeof(void*) * grid_count);
+    index->start = (int *) pj_malloc(sizeof(int) * (bucket_count + 1));
+    fill = (int *) pj_malloc(sizeof(int) * bucket_count);
+    if( index->grids == NULL || index->start == NULL || fill == NULL )
+    {
+        pj_dalloc( fill );
+        pj_gridindex_free( index );
+        return NULL;
+    }
+    memcpy( index->grids, grids, sizeof(void*) * grid_count );
+
+/* -------------------------------------------------------------------- */
+/*      Count the grids per bucket, then fill the buckets in grid       */
+/*      order so that the first match in a bucket is the first match   */
+/*      in the list.                                                    */
+/* -------------------------------------------------------------------- */
+    memset( fill, 0, sizeof(int) * bucket_count );
+    for( i = 0; i < grid_count; i++ )
+    {
+        int lam_min, lam_max, phi_min, phi_max, r, c;
+
+        pj_gridindex_range( index, grids[i]->ct,
+                            &lam_min, &lam_max, &phi_min, &phi_max );
+        for( r = phi_min; r <= phi_max; r++ )
+            for( c = lam_min; c <= lam_max; c++ )
+                fill[r * side + c]++;
+    }
+
+    entry_count = 0;
+    for( i = 0; i < bucket_count; i++ )
+    {
+        index->start[i] = entry_count;
+        entry_count += fill[i];
+        fill[i] = index->start[i];
+    }
+    index->start[bucket_count] = entry_count;
+
+    index->entry = (int *) pj_malloc(sizeof(int) * MAX(entry_count,1));
+    if( index->entry == NULL )
+    {
+        pj_dalloc( fill );
+        pj_gridindex_free( index );
+        return NULL;
+    }
+
+    for( i = 0; i < grid_count; i++ )
+    {
+        int lam_min, lam_max, phi_min, phi_max, r, c;
+
+        pj_gridindex_range( index, grids[i]->ct,
+                            &lam_min, &lam_max, &phi_min, &phi_max );
+        for( r = phi_min; r <= phi_max; r++ )
+            for( c = lam_min; c <= lam_max; c++ )
+                index->entry[fill[r * side + c]++] = i;
+    }
+
+    pj_dalloc( fill );
+
+    return index;
+}
+
+/************************************************************************/
+/*                         pj_gridindex_query()                         */
+/*                                                                      */
+/*      Return the number of grids that may contain the point, and      */
+/*      set *entries to their numbers (in list order).  The caller      */
+/*      still has to check the point against each grid's extent.       */
+/************************************************************************/
+
+int pj_gridindex_query( PJ_GRIDINDEX *index, LP input, const int **entries )
+
+{
+    int bucket;
+
+    /* points outside the index land in an edge bucket, and fail there */
+    bucket = pj_gridindex_bucket( input.phi, index->ll.phi,
+                                  index->del.phi, index->lim.phi )
+        * index->lim.lam
+        + pj_gridindex_bucket( input.lam, index->ll.lam,
+                               index->del.lam, index->lim.lam );
+
+    *entries = index->entry + index->start[bucket];
+    return index->start[bucket+1] - index->start[bucket];
+}
+
+/************************************************************************/
+/*                         pj_gridindex_free()                          */
+/************************************************************************/
+
+void pj_gridindex_free( PJ_GRIDINDEX *index )
+
+{
+    if( index == NULL )
+        return;
+
+    pj_dalloc( index->grids );
+    pj_dalloc( index->start );
+    pj_dalloc( index->entry );
+    pj_dalloc( index );
+}
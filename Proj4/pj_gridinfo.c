@@ -45,18 +45,31 @@
 # include <assert.h>
 #endif /* _WIN32_WCE */
 
+/*
+** "ctable2" grids are stored in the in-memory layout on little endian
+** hosts, so they are mapped rather than read where mmap() is available.
+** Define PJ_NO_MMAP to always read them.
+*/
+#if !defined(_WIN32) && !defined(PJ_NO_MMAP)
+#  define PJ_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
+
+static int  byte_order_test = 1;
+#define IS_LSB	(((unsigned char *) (&byte_order_test))[0] == 1)
+
 /************************************************************************/
-/*                             swap_words()                             */
+/*                            pj_swap_words()                           */
 /*                                                                      */
 /*      Convert the byte order of the given word(s) in place.           */
 /************************************************************************/
 
-static int  byte_order_test = 1;
-#define IS_LSB	(((unsigned char *) (&byte_order_test))[0] == 1)
-
-static void swap_words( unsigned char *data, int word_size, int word_count )
+void pj_swap_words( void *data_in, int word_size, int word_count )
 
 {
+    unsigned char *data = (unsigned char *) data_in;
     int	word;
 
     for( word = 0; word < word_count; word++ )
@@ -76,6 +89,377 @@ static void swap_words( unsigned char *data, int word_size, int word_count )
     }
 }
 
+/*
+** Tiles of grids loaded tile by tile, most recently used first.  The
+** list, the counters, pins and PJ_GRIDINFO.tiles are protected by the
+** lock.  A tile pinned by a pj_apply_gridlist() call is never dropped,
+** so that call may read it without the lock.
+*/
+typedef struct PJ_GRIDTILE {
+    PJ_GRIDINFO *gi;
+    int         slot;           /* index in gi->tiles */
+    int         pins;
+    struct PJ_GRIDTILE *prev, *next;
+    FLP         cvs[PJ_GRID_TILE * PJ_GRID_TILE];
+} PJ_GRIDTILE;
+
+static PJ_GRIDTILE *tile_head = NULL, *tile_tail = NULL;
+static int tile_count = 0;
+static int tile_limit = PJ_GRID_TILE_LIMIT;
+
+/************************************************************************/
+/*                          pj_gridtile_unlink()                        */
+/************************************************************************/
+
+static void pj_gridtile_unlink( PJ_GRIDTILE *tile )
+
+{
+    if( tile->prev != NULL )
+        tile->prev->next = tile->next;
+    else
+        tile_head = tile->next;
+
+    if( tile->next != NULL )
+        tile->next->prev = tile->prev;
+    else
+        tile_tail = tile->prev;
+
+    tile->prev = tile->next = NULL;
+}
+
+/************************************************************************/
+/*                          pj_gridtile_push()                          */
+/*                                                                      */
+/*      Put a tile at the head (most recently used end) of the list.    */
+/************************************************************************/
+
+static void pj_gridtile_push( PJ_GRIDTILE *tile )
+
+{
+    tile->prev = NULL;
+    tile->next = tile_head;
+    if( tile_head != NULL )
+        tile_head->prev = tile;
+    else
+        tile_tail = tile;
+    tile_head = tile;
+}
+
+/************************************************************************/
+/*                          pj_gridtile_drop()                          */
+/************************************************************************/
+
+static void pj_gridtile_drop( PJ_GRIDTILE *tile )
+
+{
+    tile->gi->tiles[tile->slot] = NULL;
+    pj_gridtile_unlink( tile );
+    pj_dalloc( tile );
+    tile_count--;
+}
+
+/************************************************************************/
+/*                          pj_gridtile_trim()                          */
+/*                                                                      */
+/*      Drop least recently used tiles, except pinned ones, until we    */
+/*      are within the limit.                                           */
+/************************************************************************/
+
+static void pj_gridtile_trim()
+
+{
+    PJ_GRIDTILE *tile = tile_tail;
+
+    while( tile_count > tile_limit && tile != NULL )
+    {
+        PJ_GRIDTILE *prev = tile->prev;
+
+        if( tile->pins == 0 )
+            pj_gridtile_drop( tile );
+        tile = prev;
+    }
+}
+
+/************************************************************************/
+/*                       pj_set_grid_tile_limit()                       */
+/*                                                                      */
+/*      Set the number of grid tiles (of PJ_GRID_TILE squared cells)    */
+/*      kept in memory, for all grids together.  Least recently used   */
+/*      tiles are dropped beyond that.                                  */
+/************************************************************************/
+
+void pj_set_grid_tile_limit( int max_tiles )
+
+{
+    pj_acquire_lock();
+
+    tile_limit = MAX(max_tiles,1);
+    pj_gridtile_trim();
+
+    pj_release_lock();
+}
+
+/************************************************************************/
+/*                       pj_get_grid_tile_count()                       */
+/*                                                                      */
+/*      Number of grid tiles currently in memory.                       */
+/************************************************************************/
+
+int pj_get_grid_tile_count()
+
+{
+    int count;
+
+    pj_acquire_lock();
+    count = tile_count;
+    pj_release_lock();
+
+    return count;
+}
+
+/************************************************************************/
+/*                         pj_gridtile_read()                           */
+/*                                                                      */
+/*      Read one tile of a ntv1 or ntv2 grid.  Both store 16 bytes per  */
+/*      node, rows south to north and each row east to west, so a       */
+/*      tile row is one contiguous run of the file.                     */
+/************************************************************************/
+
+static int pj_gridtile_read( projCtx ctx, PJ_GRIDINFO *gi, int slot,
+                             FLP *cvs )
+
+{
+    struct CTABLE *ct = gi->ct;
+    double      row_buf[PJ_GRID_TILE * 2];
+    int         c0, c1, r0, r1, row, ntv1;
+    FILE        *fid;
+
+    c0 = (slot % gi->tiles_lam) * PJ_GRID_TILE;
+    r0 = (slot / gi->tiles_lam) * PJ_GRID_TILE;
+    c1 = MIN(c0 + PJ_GRID_TILE, ct->lim.lam) - 1;
+    r1 = MIN(r0 + PJ_GRID_TILE, ct->lim.phi) - 1;
+    ntv1 = strcmp(gi->format,"ntv1") == 0;
+
+    fid = pj_open_lib( ctx, gi->filename, "rb" );
+    if( fid == NULL )
+    {
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+
+    for( row = r0; row <= r1; row++ )
+    {
+        int     i, n = c1 - c0 + 1;
+        FLP     *out = cvs + (row - r0) * PJ_GRID_TILE + (c1 - c0);
+
+        if( fseek( fid, gi->grid_offset + 16 * 
+                   ((long) row * ct->lim.lam + (ct->lim.lam - 1 - c1)),
+                   SEEK_SET ) != 0
+            || fread( row_buf, 16, n, fid ) != n )
+        {
+            fclose( fid );
+            pj_ctx_set_errno( ctx, -38 );
+            return 0;
+        }
+
+        /* convert seconds to radians, reversing the row */
+        if( ntv1 )
+        {
+            double *diff_seconds = row_buf;
+
+            if( IS_LSB )
+                pj_swap_words( row_buf, 8, n * 2 );
+
+            for( i = 0; i < n; i++, out-- )
+            {
+                out->phi = *(diff_seconds++) * ((PI/180.0) / 3600.0);
+                out->lam = *(diff_seconds++) * ((PI/180.0) / 3600.0);
+            }
+        }
+        else
+        {
+            float *diff_seconds = (float *) row_buf;
+
+            if( !IS_LSB )
+                pj_swap_words( row_buf, 4, n * 4 );
+
+            for( i = 0; i < n; i++, out-- )
+            {
+                out->phi = *(diff_seconds++) * ((PI/180.0) / 3600.0);
+                out->lam = *(diff_seconds++) * ((PI/180.0) / 3600.0);
+                diff_seconds += 2; /* skip accuracy values */
+            }
+        }
+    }
+
+    fclose( fid );
+
+    return 1;
+}
+
+/************************************************************************/
+/*                           pj_gridtile_get()                          */
+/*                                                                      */
+/*      Return a tile, reading it if needed.  Must be called with the   */
+/*      lock held; the tile may be dropped once it is released.  The    */
+/*      lock is released while a missing tile is read from the file,    */
+/*      so other threads are not held up by the disk.                   */
+/************************************************************************/
+
+static PJ_GRIDTILE *pj_gridtile_get( projCtx ctx, PJ_GRIDINFO *gi, int slot )
+
+{
+    PJ_GRIDTILE *tile = gi->tiles[slot];
+    int         ok;
+
+    if( tile != NULL )
+    {
+        if( tile != tile_head )
+        {
+            pj_gridtile_unlink( tile );
+            pj_gridtile_push( tile );
+        }
+        return tile;
+    }
+
+    pj_release_lock();
+
+    tile = (PJ_GRIDTILE *) pj_malloc(sizeof(PJ_GRIDTILE));
+    if( tile == NULL )
+        pj_ctx_set_errno( ctx, -38 );
+    ok = tile != NULL && pj_gridtile_read( ctx, gi, slot, tile->cvs );
+
+    pj_acquire_lock();
+
+    if( !ok )
+    {
+        pj_dalloc( tile );
+        return NULL;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Another thread may have read the same tile meanwhile; use       */
+/*      the one already published.                                      */
+/* -------------------------------------------------------------------- */
+    if( gi->tiles[slot] != NULL )
+    {
+        pj_dalloc( tile );
+        tile = gi->tiles[slot];
+        if( tile != tile_head )
+        {
+            pj_gridtile_unlink( tile );
+            pj_gridtile_push( tile );
+        }
+        return tile;
+    }
+
+    tile->gi = gi;
+    tile->slot = slot;
+    tile->pins = 1;     /* not to be dropped by the trim below */
+    gi->tiles[slot] = tile;
+    pj_gridtile_push( tile );
+    tile_count++;
+
+    pj_gridtile_trim();
+    tile->pins = 0;
+
+    return tile;
+}
+
+/************************************************************************/
+/*                         pj_gridinfo_cells()                          */
+/*                                                                      */
+/*      Fetch the four nodes (col,row), (col+1,row), (col,row+1) and    */
+/*      (col+1,row+1) of a grid, in that order, for nad_intr_grid().    */
+/*      The values are copied under the lock, as the tiles holding      */
+/*      them may be dropped by another thread afterwards.               */
+/*                                                                      */
+/*      The tile last used whole is also pinned in *pinned, which       */
+/*      belongs to one pj_apply_gridlist() call, and read without the   */
+/*      lock while points stay in it.  The pin is released by           */
+/*      pj_gridinfo_unpin() at the end of that call.                    */
+/************************************************************************/
+
+int pj_gridinfo_cells( projCtx ctx, PJ_GRIDINFO *gi, int col, int row,
+                       FLP *cells, struct PJ_GRIDTILE **pinned )
+
+{
+    PJ_GRIDTILE *tile = *pinned;
+    int         i, slot = -1, single;
+
+    single = col / PJ_GRID_TILE == (col + 1) / PJ_GRID_TILE
+        && row / PJ_GRID_TILE == (row + 1) / PJ_GRID_TILE;
+
+    if( single && tile != NULL && tile->gi == gi
+        && tile->slot == (row / PJ_GRID_TILE) * gi->tiles_lam 
+                         + col / PJ_GRID_TILE )
+    {
+        FLP *cvs = tile->cvs + (row % PJ_GRID_TILE) * PJ_GRID_TILE 
+            + col % PJ_GRID_TILE;
+
+        cells[0] = cvs[0];
+        cells[1] = cvs[1];
+        cells[2] = cvs[PJ_GRID_TILE];
+        cells[3] = cvs[PJ_GRID_TILE + 1];
+        return 1;
+    }
+
+    pj_acquire_lock();
+
+    for( i = 0; i < 4; i++ )
+    {
+        int c = col + (i & 1), r = row + (i >> 1);
+        int s = (r / PJ_GRID_TILE) * gi->tiles_lam + c / PJ_GRID_TILE;
+
+        if( s != slot )
+        {
+            slot = s;
+            tile = pj_gridtile_get( ctx, gi, slot );
+            if( tile == NULL )
+            {
+                pj_release_lock();
+                return 0;
+            }
+        }
+
+        cells[i] = tile->cvs[(r % PJ_GRID_TILE) * PJ_GRID_TILE 
+                             + c % PJ_GRID_TILE];
+    }
+
+    if( single )
+    {
+        if( *pinned != NULL )
+            (*pinned)->pins--;
+        tile->pins++;
+        *pinned = tile;
+    }
+
+    pj_release_lock();
+
+    return 1;
+}
+
+/************************************************************************/
+/*                         pj_gridinfo_unpin()                          */
+/*                                                                      */
+/*      Release the tile pinned by pj_gridinfo_cells(), if any.         */
+/************************************************************************/
+
+void pj_gridinfo_unpin( struct PJ_GRIDTILE **pinned )
+
+{
+    if( *pinned == NULL )
+        return;
+
+    pj_acquire_lock();
+
+    (*pinned)->pins--;
+    *pinned = NULL;
+    pj_gridtile_trim();
+
+    pj_release_lock();
+}
+
 /************************************************************************/
 /*                          pj_gridinfo_free()                          */
 /************************************************************************/
@@ -86,6 +470,23 @@ void pj_gridinfo_free( PJ_GRIDINFO *gi )
     if( gi == NULL )
         return;
 
+    pj_gridindex_free( gi->child_index );
+
+    if( gi->tiles != NULL )
+    {
+        int i;
+
+        pj_acquire_lock();
+        for( i = 0; i < gi->tiles_lam * gi->tiles_phi; i++ )
+        {
+            if( gi->tiles[i] != NULL )
+                pj_gridtile_drop( gi->tiles[i] );
+        }
+        pj_release_lock();
+
+        pj_dalloc( gi->tiles );
+    }
+
     if( gi->child != NULL )
     {
         PJ_GRIDINFO *child, *next;
@@ -97,6 +498,14 @@ void pj_gridinfo_free( PJ_GRIDINFO *gi )
         }
     }
 
+#ifdef PJ_MMAP
+    if( gi->map != NULL )
+    {
+        munmap( gi->map, gi->map_size );
+        gi->ct->cvs = NULL;
+    }
+#endif
+
     if( gi->ct != NULL )
         nad_free( gi->ct );
     
@@ -108,19 +517,16 @@ void pj_gridinfo_free( PJ_GRIDINFO *gi )
 }
 
 /************************************************************************/
-/*                          pj_gridinfo_load()                          */
+/*                        pj_gridinfo_load_cvs()                        */
 /*                                                                      */
-/*      This function is intended to implement delayed loading of       */
-/*      the data contents of a grid file.  The header and related       */
-/*      stuff are loaded by pj_gridinfo_init().                         */
+/*      Read the shift values of a grid.  The cvs array is only         */
+/*      attached to the CTABLE once fully populated, so that other      */
+/*      threads testing ct->cvs never see a partially loaded grid.      */
 /************************************************************************/
 
-int pj_gridinfo_load( PJ_GRIDINFO *gi )
+static int pj_gridinfo_load_cvs( projCtx ctx, PJ_GRIDINFO *gi )
 
 {
-    if( gi == NULL || gi->ct == NULL )
-        return 0;
-
 /* -------------------------------------------------------------------- */
 /*      ctable is currently loaded on initialization though there is    */
 /*      no real reason not to support delayed loading for it as well.   */
@@ -130,15 +536,68 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
         FILE *fid;
         int result;
 
-        fid = pj_open_lib( gi->filename, "rb" );
+        fid = pj_open_lib( ctx, gi->filename, "rb" );
         
         if( fid == NULL )
         {
-            pj_errno = -38;
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
 
-        result = nad_ctable_load( gi->ct, fid );
+        result = nad_ctable_load( ctx, gi->ct, fid );
+
+        fclose( fid );
+
+        return result;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      ctable2 format.  Map the file and point cvs straight at the     */
+/*      shift values, falling back to reading them if that fails.       */
+/* -------------------------------------------------------------------- */
+    else if( strcmp(gi->format,"ctable2") == 0 )
+    {
+        FILE *fid;
+        int result;
+
+        fid = pj_open_lib( ctx, gi->filename, "rb" );
+        
+        if( fid == NULL )
+        {
+            pj_ctx_set_errno( ctx, -38 );
+            return 0;
+        }
+
+#ifdef PJ_MMAP
+        if( IS_LSB )
+        {
+            struct stat st;
+            size_t      needed = CTABLE2_HEADER_SIZE 
+                + sizeof(FLP) * gi->ct->lim.lam * gi->ct->lim.phi;
+            void        *map;
+
+            if( fstat( fileno(fid), &st ) == 0 
+                && (size_t) st.st_size >= needed )
+            {
+                map = mmap( NULL, needed, PROT_READ, MAP_SHARED, 
+                            fileno(fid), 0 );
+                if( map != MAP_FAILED )
+                {
+                    fclose( fid );
+
+                    gi->map = map;
+                    gi->map_size = needed;
+                    PJ_PUBLISH_BARRIER();
+                    gi->ct->cvs = (FLP *) 
+                        ((char *) map + CTABLE2_HEADER_SIZE);
+
+                    return 1;
+                }
+            }
+        }
+#endif
+
+        result = nad_ctable2_load( ctx, gi->ct, fid );
 
         fclose( fid );
 
@@ -154,25 +613,29 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
 /* -------------------------------------------------------------------- */
     else if( strcmp(gi->format,"ntv1") == 0 )
     {
+        FLP     *ct_cvs;
         double	*row_buf;
         int	row;
         FILE *fid;
 
-        fid = pj_open_lib( gi->filename, "rb" );
+        fid = pj_open_lib( ctx, gi->filename, "rb" );
         
         if( fid == NULL )
         {
-            pj_errno = -38;
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
 
         fseek( fid, gi->grid_offset, SEEK_SET );
 
         row_buf = (double *) pj_malloc(gi->ct->lim.lam * sizeof(double) * 2);
-        gi->ct->cvs = (FLP *) pj_malloc(gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP));
-        if( row_buf == NULL || gi->ct->cvs == NULL )
+        ct_cvs = (FLP *) pj_malloc(gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP));
+        if( row_buf == NULL || ct_cvs == NULL )
         {
-            pj_errno = -38;
+            pj_dalloc( row_buf );
+            pj_dalloc( ct_cvs );
+            fclose( fid );
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
         
@@ -186,20 +649,21 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
                 != 2 * gi->ct->lim.lam )
             {
                 pj_dalloc( row_buf );
-                pj_dalloc( gi->ct->cvs );
-                pj_errno = -38;
+                pj_dalloc( ct_cvs );
+                fclose( fid );
+                pj_ctx_set_errno( ctx, -38 );
                 return 0;
             }
 
             if( IS_LSB )
-                swap_words( (unsigned char *) row_buf, 8, gi->ct->lim.lam*2 );
+                pj_swap_words( row_buf, 8, gi->ct->lim.lam*2 );
 
             /* convert seconds to radians */
             diff_seconds = row_buf;
 
             for( i = 0; i < gi->ct->lim.lam; i++ )
             {
-                cvs = gi->ct->cvs + (row) * gi->ct->lim.lam
+                cvs = ct_cvs + (row) * gi->ct->lim.lam
                     + (gi->ct->lim.lam - i - 1);
 
                 cvs->phi = *(diff_seconds++) * ((PI/180.0) / 3600.0);
@@ -211,6 +675,9 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
 
         fclose( fid );
 
+        PJ_PUBLISH_BARRIER();
+        gi->ct->cvs = ct_cvs;
+
         return 1;
     }
 
@@ -223,30 +690,32 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
 /* -------------------------------------------------------------------- */
     else if( strcmp(gi->format,"ntv2") == 0 )
     {
+        FLP     *ct_cvs;
         float	*row_buf;
         int	row;
         FILE *fid;
 
-        if( getenv("PROJ_DEBUG") != NULL )
-        {
-            fprintf( stderr, "NTv2 - loading grid %s\n", gi->ct->id );
-        }
+        pj_log( ctx, PJ_LOG_DEBUG_MINOR, 
+                "NTv2 - loading grid %s", gi->ct->id );
 
-        fid = pj_open_lib( gi->filename, "rb" );
+        fid = pj_open_lib( ctx, gi->filename, "rb" );
         
         if( fid == NULL )
         {
-            pj_errno = -38;
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
 
         fseek( fid, gi->grid_offset, SEEK_SET );
 
         row_buf = (float *) pj_malloc(gi->ct->lim.lam * sizeof(float) * 4);
-        gi->ct->cvs = (FLP *) pj_malloc(gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP));
-        if( row_buf == NULL || gi->ct->cvs == NULL )
+        ct_cvs = (FLP *) pj_malloc(gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP));
+        if( row_buf == NULL || ct_cvs == NULL )
         {
-            pj_errno = -38;
+            pj_dalloc( row_buf );
+            pj_dalloc( ct_cvs );
+            fclose( fid );
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
         
@@ -260,22 +729,21 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
                 != 4 * gi->ct->lim.lam )
             {
                 pj_dalloc( row_buf );
-                pj_dalloc( gi->ct->cvs );
-                gi->ct->cvs = NULL;
-                pj_errno = -38;
+                pj_dalloc( ct_cvs );
+                fclose( fid );
+                pj_ctx_set_errno( ctx, -38 );
                 return 0;
             }
 
             if( !IS_LSB )
-                swap_words( (unsigned char *) row_buf, 4, 
-                            gi->ct->lim.lam*4 );
+                pj_swap_words( row_buf, 4, gi->ct->lim.lam*4 );
 
             /* convert seconds to radians */
             diff_seconds = row_buf;
 
             for( i = 0; i < gi->ct->lim.lam; i++ )
             {
-                cvs = gi->ct->cvs + (row) * gi->ct->lim.lam
+                cvs = ct_cvs + (row) * gi->ct->lim.lam
                     + (gi->ct->lim.lam - i - 1);
 
                 cvs->phi = *(diff_seconds++) * ((PI/180.0) / 3600.0);
@@ -288,6 +756,9 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
 
         fclose( fid );
 
+        PJ_PUBLISH_BARRIER();
+        gi->ct->cvs = ct_cvs;
+
         return 1;
     }
 
@@ -297,13 +768,91 @@ int pj_gridinfo_load( PJ_GRIDINFO *gi )
     }
 }
 
+/************************************************************************/
+/*                          pj_gridinfo_load()                          */
+/*                                                                      */
+/*      This function is intended to implement delayed loading of       */
+/*      the data contents of a grid file.  The header and related       */
+/*      stuff are loaded by pj_gridinfo_init().  Loading is done        */
+/*      under the PROJ.4 lock so that concurrent first use of a grid    */
+/*      from several threads only reads it once.                        */
+/*                                                                      */
+/*      ntv1 and ntv2 grids larger than a few tiles are not read        */
+/*      here: only their table of tiles is set up, and the tiles are    */
+/*      read as points fall in them (see pj_gridinfo_cells()).  Such    */
+/*      grids must be used through nad_cvt_grid(), as ct->cvs stays     */
+/*      NULL.  ctable2 grids are mapped, so pages are also only read    */
+/*      as they are used.                                               */
+/************************************************************************/
+
+int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    int result;
+
+    if( gi == NULL || gi->ct == NULL )
+        return 0;
+
+    pj_acquire_lock();
+
+    if( gi->ct->cvs != NULL || gi->tiles != NULL )
+        result = 1;
+    else if( (strcmp(gi->format,"ntv1") == 0 
+              || strcmp(gi->format,"ntv2") == 0)
+             && (double) gi->ct->lim.lam * gi->ct->lim.phi 
+                > 4.0 * PJ_GRID_TILE * PJ_GRID_TILE )
+    {
+        gi->tiles_lam = (gi->ct->lim.lam + PJ_GRID_TILE - 1) / PJ_GRID_TILE;
+        gi->tiles_phi = (gi->ct->lim.phi + PJ_GRID_TILE - 1) / PJ_GRID_TILE;
+        gi->tiles = (struct PJ_GRIDTILE **) 
+            pj_malloc(sizeof(void*) * gi->tiles_lam * gi->tiles_phi);
+        if( gi->tiles != NULL )
+            memset( gi->tiles, 0, 
+                    sizeof(void*) * gi->tiles_lam * gi->tiles_phi );
+        result = gi->tiles != NULL;
+    }
+    else
+        result = pj_gridinfo_load_cvs( ctx, gi );
+
+    pj_release_lock();
+
+    return result;
+}
+
+/************************************************************************/
+/*                        pj_gridinfo_load_all()                        */
+/*                                                                      */
+/*      As pj_gridinfo_load(), but always read the whole grid into      */
+/*      ct->cvs, for callers that need the full array.                  */
+/************************************************************************/
+
+int pj_gridinfo_load_all( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    int result;
+
+    if( gi == NULL || gi->ct == NULL )
+        return 0;
+
+    pj_acquire_lock();
+
+    if( gi->ct->cvs != NULL )
+        result = 1;
+    else
+        result = pj_gridinfo_load_cvs( ctx, gi );
+
+    pj_release_lock();
+
+    return result;
+}
+
 /************************************************************************/
 /*                       pj_gridinfo_init_ntv2()                        */
 /*                                                                      */
 /*      Load a ntv2 (.gsb) file.                                        */
 /************************************************************************/
 
-static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
+static int pj_gridinfo_init_ntv2( projCtx ctx, FILE *fid, PJ_GRIDINFO *gilist )
 
 {
     unsigned char header[11*16];
@@ -313,9 +862,9 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
     assert( sizeof(double) == 8 );
     if( sizeof(int) != 4 || sizeof(double) != 8 )
     {
-        fprintf( stderr, 
-                 "basic types of inappropraiate size in pj_gridinfo_init_ntv2()\n" );
-        pj_errno = -38;
+        pj_log( ctx, PJ_LOG_ERROR,
+                "basic types of inappropraiate size in pj_gridinfo_init_ntv2()" );
+        pj_ctx_set_errno( ctx, -38 );
         return 0;
     }
 
@@ -324,7 +873,7 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
 /* -------------------------------------------------------------------- */
     if( fread( header, sizeof(header), 1, fid ) != 1 )
     {
-        pj_errno = -38;
+        pj_ctx_set_errno( ctx, -38 );
         return 0;
     }
 
@@ -333,13 +882,13 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
 /* -------------------------------------------------------------------- */
     if( !IS_LSB )
     {
-        swap_words( header+8, 4, 1 );
-        swap_words( header+8+16, 4, 1 );
-        swap_words( header+8+32, 4, 1 );
-        swap_words( header+8+7*16, 8, 1 );
-        swap_words( header+8+8*16, 8, 1 );
-        swap_words( header+8+9*16, 8, 1 );
-        swap_words( header+8+10*16, 8, 1 );
+        pj_swap_words( header+8, 4, 1 );
+        pj_swap_words( header+8+16, 4, 1 );
+        pj_swap_words( header+8+32, 4, 1 );
+        pj_swap_words( header+8+7*16, 8, 1 );
+        pj_swap_words( header+8+8*16, 8, 1 );
+        pj_swap_words( header+8+9*16, 8, 1 );
+        pj_swap_words( header+8+10*16, 8, 1 );
     }
 
 /* -------------------------------------------------------------------- */
@@ -362,13 +911,13 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
 /* -------------------------------------------------------------------- */
         if( fread( header, sizeof(header), 1, fid ) != 1 )
         {
-            pj_errno = -38;
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
 
         if( strncmp((const char *) header,"SUB_NAME",8) != 0 )
         {
-            pj_errno = -38;
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
         
@@ -377,13 +926,13 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
 /* -------------------------------------------------------------------- */
         if( !IS_LSB )
         {
-            swap_words( header+8+16*4, 8, 1 );
-            swap_words( header+8+16*5, 8, 1 );
-            swap_words( header+8+16*6, 8, 1 );
-            swap_words( header+8+16*7, 8, 1 );
-            swap_words( header+8+16*8, 8, 1 );
-            swap_words( header+8+16*9, 8, 1 );
-            swap_words( header+8+16*10, 4, 1 );
+            pj_swap_words( header+8+16*4, 8, 1 );
+            pj_swap_words( header+8+16*5, 8, 1 );
+            pj_swap_words( header+8+16*6, 8, 1 );
+            pj_swap_words( header+8+16*7, 8, 1 );
+            pj_swap_words( header+8+16*8, 8, 1 );
+            pj_swap_words( header+8+16*9, 8, 1 );
+            pj_swap_words( header+8+16*10, 4, 1 );
         }
         
 /* -------------------------------------------------------------------- */
@@ -405,13 +954,12 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
         ct->lim.lam = (int) (fabs(ur.lam-ct->ll.lam)/ct->del.lam + 0.5) + 1;
         ct->lim.phi = (int) (fabs(ur.phi-ct->ll.phi)/ct->del.phi + 0.5) + 1;
 
-        if( getenv("PROJ_DEBUG") != NULL )
-            fprintf( stderr, 
-                     "NTv2 %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
-                     ct->id, 
-                     ct->lim.lam, ct->lim.phi,
-                     ct->ll.lam/3600.0, ct->ll.phi/3600.0,
-                     ur.lam/3600.0, ur.phi/3600.0 );
+        pj_log( ctx, PJ_LOG_DEBUG_MINOR, 
+                "NTv2 %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)",
+                ct->id, 
+                ct->lim.lam, ct->lim.phi,
+                ct->ll.lam/3600.0, ct->ll.phi/3600.0,
+                ur.lam/3600.0, ur.phi/3600.0 );
 
         ct->ll.lam *= DEG_TO_RAD/3600.0;
         ct->ll.phi *= DEG_TO_RAD/3600.0;
@@ -421,11 +969,11 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
         memcpy( &gs_count, header + 8 + 16*10, 4 );
         if( gs_count != ct->lim.lam * ct->lim.phi )
         {
-            fprintf( stderr, 
-                     "GS_COUNT(%d) does not match expected cells (%dx%d=%d)\n",
-                     gs_count, ct->lim.lam, ct->lim.phi, 
-                     ct->lim.lam * ct->lim.phi );
-            pj_errno = -38;
+            pj_log( ctx, PJ_LOG_ERROR,
+                    "GS_COUNT(%d) does not match expected cells (%dx%d=%d)",
+                    gs_count, ct->lim.lam, ct->lim.phi, 
+                    ct->lim.lam * ct->lim.phi );
+            pj_ctx_set_errno( ctx, -38 );
             return 0;
         }
 
@@ -476,10 +1024,10 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
 
             if( gp == NULL )
             {
-                if( getenv("PROJ_DEBUG") != NULL )
-                    fprintf( stderr, "pj_gridinfo_init_ntv2(): "
-                             "failed to find parent %8.8s for %s.\n", 
-                             (const char *) header+24, gi->ct->id );
+                pj_log( ctx, PJ_LOG_ERROR, 
+                        "pj_gridinfo_init_ntv2(): "
+                        "failed to find parent %8.8s for %s.", 
+                        (const char *) header+24, gi->ct->id );
 
                 for( lnk = gp; lnk->next != NULL; lnk = lnk->next ) {}
                 lnk->next = gi;
@@ -510,7 +1058,7 @@ static int pj_gridinfo_init_ntv2( FILE *fid, PJ_GRIDINFO *gilist )
 /*      Load an NTv1 style Canadian grid shift file.                    */
 /************************************************************************/
 
-static int pj_gridinfo_init_ntv1( FILE * fid, PJ_GRIDINFO *gi )
+static int pj_gridinfo_init_ntv1( projCtx ctx, FILE * fid, PJ_GRIDINFO *gi )
 
 {
     unsigned char header[176];
@@ -521,9 +1069,9 @@ static int pj_gridinfo_init_ntv1( FILE * fid, PJ_GRIDINFO *gi )
     assert( sizeof(double) == 8 );
     if( sizeof(int) != 4 || sizeof(double) != 8 )
     {
-        fprintf( stderr, 
-                 "basic types of inappropraiate size in nad_load_ntv1()\n" );
-        pj_errno = -38;
+        pj_log( ctx, PJ_LOG_ERROR,
+                "basic types of inappropraiate size in nad_load_ntv1()" );
+        pj_ctx_set_errno( ctx, -38 );
         return 0;
     }
 
@@ -532,7 +1080,7 @@ static int pj_gridinfo_init_ntv1( FILE * fid, PJ_GRIDINFO *gi )
 /* -------------------------------------------------------------------- */
     if( fread( header, sizeof(header), 1, fid ) != 1 )
     {
-        pj_errno = -38;
+        pj_ctx_set_errno( ctx, -38 );
         return 0;
     }
 
@@ -541,19 +1089,20 @@ static int pj_gridinfo_init_ntv1( FILE * fid, PJ_GRIDINFO *gi )
 /* -------------------------------------------------------------------- */
     if( IS_LSB )
     {
-        swap_words( header+8, 4, 1 );
-        swap_words( header+24, 8, 1 );
-        swap_words( header+40, 8, 1 );
-        swap_words( header+56, 8, 1 );
-        swap_words( header+72, 8, 1 );
-        swap_words( header+88, 8, 1 );
-        swap_words( header+104, 8, 1 );
+        pj_swap_words( header+8, 4, 1 );
+        pj_swap_words( header+24, 8, 1 );
+        pj_swap_words( header+40, 8, 1 );
+        pj_swap_words( header+56, 8, 1 );
+        pj_swap_words( header+72, 8, 1 );
+        pj_swap_words( header+88, 8, 1 );
+        pj_swap_words( header+104, 8, 1 );
     }
 
     if( *((int *) (header+8)) != 12 )
     {
-        pj_errno = -38;
-        printf("NTv1 grid shift file has wrong record count, corrupt?\n");
+        pj_ctx_set_errno( ctx, -38 );
+        pj_log( ctx, PJ_LOG_ERROR, 
+                "NTv1 grid shift file has wrong record count, corrupt?" );
         return 0;
     }
 
@@ -572,11 +1121,10 @@ static int pj_gridinfo_init_ntv1( FILE * fid, PJ_GRIDINFO *gi )
     ct->lim.lam = (int) (fabs(ur.lam-ct->ll.lam)/ct->del.lam + 0.5) + 1;
     ct->lim.phi = (int) (fabs(ur.phi-ct->ll.phi)/ct->del.phi + 0.5) + 1;
 
-    if( getenv("PROJ_DEBUG") != NULL )
-        fprintf( stderr, 
-                 "NTv1 %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
-                 ct->lim.lam, ct->lim.phi,
-                 ct->ll.lam, ct->ll.phi, ur.lam, ur.phi );
+    pj_log( ctx, PJ_LOG_DEBUG_MINOR, 
+            "NTv1 %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)",
+            ct->lim.lam, ct->lim.phi,
+            ct->ll.lam, ct->ll.phi, ur.lam, ur.phi );
 
     ct->ll.lam *= DEG_TO_RAD;
     ct->ll.phi *= DEG_TO_RAD;
@@ -600,7 +1148,7 @@ static int pj_gridinfo_init_ntv1( FILE * fid, PJ_GRIDINFO *gi )
 /*      applications.                                                   */
 /************************************************************************/
 
-PJ_GRIDINFO *pj_gridinfo_init( const char *gridname )
+PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
 
 {
     char 	fname[MAX_PATH_FILENAME+1];
@@ -608,7 +1156,8 @@ PJ_GRIDINFO *pj_gridinfo_init( const char *gridname )
     FILE 	*fp;
     char	header[160];
 
-    errno = pj_errno = 0;
+    errno = 0;
+    ctx->last_errno = 0;
 
 /* -------------------------------------------------------------------- */
 /*      Initialize a GRIDINFO with stub info we would use if it         */
@@ -628,8 +1177,8 @@ PJ_GRIDINFO *pj_gridinfo_init( const char *gridname )
 /*      Open the file using the usual search rules.                     */
 /* -------------------------------------------------------------------- */
     strcpy(fname, gridname);
-    if (!(fp = pj_open_lib(fname, "rb"))) {
-        pj_errno = errno;
+    if (!(fp = pj_open_lib(ctx, fname, "rb"))) {
+        pj_ctx_set_errno( ctx, errno );
         return gilist;
     }
 
@@ -641,7 +1190,7 @@ PJ_GRIDINFO *pj_gridinfo_init( const char *gridname )
     if( fread( header, sizeof(header), 1, fp ) != 1 )
     {
         fclose( fp );
-        pj_errno = -38;
+        pj_ctx_set_errno( ctx, -38 );
         return gilist;
     }
 
@@ -654,30 +1203,47 @@ PJ_GRIDINFO *pj_gridinfo_init( const char *gridname )
         && strncmp(header + 96, "W GRID", 6) == 0 
         && strncmp(header + 144, "TO      NAD83   ", 16) == 0 )
     {
-        pj_gridinfo_init_ntv1( fp, gilist );
+        pj_gridinfo_init_ntv1( ctx, fp, gilist );
     }
     
     else if( strncmp(header + 0, "NUM_OREC", 8) == 0 
              && strncmp(header + 48, "GS_TYPE", 7) == 0 )
     {
-        pj_gridinfo_init_ntv2( fp, gilist );
+        pj_gridinfo_init_ntv2( ctx, fp, gilist );
     }
     
+    else if( strncmp(header + 0, "CTABLE V2", 9) == 0 )
+    {
+        struct CTABLE *ct = nad_ctable2_init( ctx, fp );
+
+        gilist->format = "ctable2";
+        gilist->ct = ct;
+
+        if( ct != NULL )
+            pj_log( ctx, PJ_LOG_DEBUG_MINOR, 
+                    "Ctable2 %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)",
+                    ct->id, 
+                    ct->lim.lam, ct->lim.phi,
+                    ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
+                    (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG, 
+                    (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
+    }
+
     else
     {
-        struct CTABLE *ct = nad_ctable_init( fp );
+        struct CTABLE *ct = nad_ctable_init( ctx, fp );
 
         gilist->format = "ctable";
         gilist->ct = ct;
 
-        if( getenv("PROJ_DEBUG") != NULL )
-            fprintf( stderr, 
-                     "Ctable %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
-                     ct->id, 
-                     ct->lim.lam, ct->lim.phi,
-                     ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
-                     (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG, 
-                     (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
+        if( ct != NULL )
+            pj_log( ctx, PJ_LOG_DEBUG_MINOR, 
+                    "Ctable %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)",
+                    ct->id, 
+                    ct->lim.lam, ct->lim.phi,
+                    ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
+                    (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG, 
+                    (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
     }
 
     fclose(fp);
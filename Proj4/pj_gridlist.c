@@ -46,22 +46,66 @@
 
 static PJ_GRIDINFO *grid_list = NULL;
 
-/* used only by pj_load_nadgrids() and pj_deallocate_grids() */
+/*
+** Cache of resolved nadgrids strings, all under the lock.  The cache
+** holds one reference on each entry, and each pj_gridlist_lookup()
+** caller another, so a displaced entry is freed once the last PJ
+** using it lets go.
+*/
+#define GRIDLIST_CACHE_SIZE 16
 
-static int           last_nadgrids_max = 0;
-static int           last_nadgrids_count = 0;
-static PJ_GRIDINFO **last_nadgrids_list = NULL;
-static char         *last_nadgrids = NULL;
+static PJ_GRIDLIST *gridlist_cache[GRIDLIST_CACHE_SIZE];
+static int gridlist_cache_next = 0;
+
+/************************************************************************/
+/*                        pj_gridlist_free()                            */
+/************************************************************************/
+
+static void pj_gridlist_free( PJ_GRIDLIST *entry )
+
+{
+    pj_gridindex_free( entry->index );
+    pj_dalloc( entry->grids );
+    free( entry->nadgrids );
+    pj_dalloc( entry );
+}
+
+/************************************************************************/
+/*                        pj_gridlist_unref()                           */
+/*                                                                      */
+/*      Drop a reference, freeing the entry with the last one.  Must    */
+/*      be called with the lock held.                                   */
+/************************************************************************/
+
+static void pj_gridlist_unref( PJ_GRIDLIST *entry )
+
+{
+    if( --entry->refcount == 0 )
+        pj_gridlist_free( entry );
+}
 
 /************************************************************************/
 /*                        pj_deallocate_grids()                         */
 /*                                                                      */
-/*      Deallocate all loaded grids.                                    */
+/*      Deallocate all loaded grids, and the cached grid lists.  No     */
+/*      PJ using grids may be in use.                                   */
 /************************************************************************/
 
 void pj_deallocate_grids()
 
 {
+    int i;
+
+    pj_acquire_lock();
+    for( i = 0; i < GRIDLIST_CACHE_SIZE; i++ )
+    {
+        if( gridlist_cache[i] != NULL )
+            pj_gridlist_unref( gridlist_cache[i] );
+        gridlist_cache[i] = NULL;
+    }
+    gridlist_cache_next = 0;
+    pj_release_lock();
+
     while( grid_list != NULL )
     {
         PJ_GRIDINFO *item = grid_list;
@@ -70,31 +114,54 @@ void pj_deallocate_grids()
 
         pj_gridinfo_free( item );
     }
+}
 
-    if( last_nadgrids != NULL )
-    {
-        pj_dalloc( last_nadgrids );
-        last_nadgrids = NULL;
+/************************************************************************/
+/*                     pj_gridlist_index_children()                     */
+/*                                                                      */
+/*      Build the child_index of a grid with many subgrids.  Must be    */
+/*      called with the lock held.                                      */
+/************************************************************************/
 
-        pj_dalloc( last_nadgrids_list );
-        last_nadgrids_list = NULL;
+static void pj_gridlist_index_children( PJ_GRIDINFO *grid )
 
-        last_nadgrids_count = 0;
-        last_nadgrids_max = 0;
-    }
+{
+    PJ_GRIDINFO *child, **children;
+    int         child_count = 0;
+
+    for( child = grid->child; child != NULL; child = child->next )
+        child_count++;
+
+    if( child_count < PJ_GRIDINDEX_MIN )
+        return;
+
+    children = (PJ_GRIDINFO **) pj_malloc(sizeof(void*) * child_count);
+    if( children == NULL )
+        return;
+
+    child_count = 0;
+    for( child = grid->child; child != NULL; child = child->next )
+        children[child_count++] = child;
+
+    grid->child_index = pj_gridindex_create( children, child_count );
+    pj_dalloc( children );
 }
 
 /************************************************************************/
 /*                       pj_gridlist_merge_grid()                       */
 /*                                                                      */
 /*      Find/load the named gridfile and merge it into the              */
-/*      last_nadgrids_list.                                             */
+/*      passed in grid list.  Must be called with the lock held.        */
 /************************************************************************/
 
-static int pj_gridlist_merge_gridfile( const char *gridname )
+static int pj_gridlist_merge_gridfile( projCtx ctx, 
+                                       const char *gridname,
+                                       PJ_GRIDINFO ***p_gridlist,
+                                       int *p_gridcount, 
+                                       int *p_gridmax )
 
 {
-    int i, got_match=0;
+    int got_match=0;
     PJ_GRIDINFO *this_grid, *tail = NULL;
 
 /* -------------------------------------------------------------------- */
@@ -112,27 +179,31 @@ static int pj_gridlist_merge_gridfile( const char *gridname )
             if( this_grid->ct == NULL )
                 return 0;
 
+            /* index the NTv2 subgrids the first time the grid is used */
+            if( this_grid->child != NULL && this_grid->child_index == NULL )
+                pj_gridlist_index_children( this_grid );
+
             /* do we need to grow the list? */
-            if( last_nadgrids_count >= last_nadgrids_max - 2 )
+            if( *p_gridcount >= *p_gridmax - 2 )
             {
                 PJ_GRIDINFO **new_list;
-                int new_max = last_nadgrids_max + 20;
+                int new_max = *p_gridmax + 20;
 
                 new_list = (PJ_GRIDINFO **) pj_malloc(sizeof(void*) * new_max);
-                if( last_nadgrids_list != NULL )
+                if( *p_gridlist != NULL )
                 {
-                    memcpy( new_list, last_nadgrids_list, 
-                            sizeof(void*) * last_nadgrids_max );
-                    pj_dalloc( last_nadgrids_list );
+                    memcpy( new_list, *p_gridlist, 
+                            sizeof(void*) * (*p_gridmax) );
+                    pj_dalloc( *p_gridlist );
                 }
 
-                last_nadgrids_list = new_list;
-                last_nadgrids_max = new_max;
+                *p_gridlist = new_list;
+                *p_gridmax = new_max;
             }
 
             /* add to the list */
-            last_nadgrids_list[last_nadgrids_count++] = this_grid;
-            last_nadgrids_list[last_nadgrids_count] = NULL;
+            (*p_gridlist)[(*p_gridcount)++] = this_grid;
+            (*p_gridlist)[*p_gridcount] = NULL;
         }
 
         tail = this_grid;
@@ -144,7 +215,7 @@ static int pj_gridlist_merge_gridfile( const char *gridname )
 /* -------------------------------------------------------------------- */
 /*      Try to load the named grid.                                     */
 /* -------------------------------------------------------------------- */
-    this_grid = pj_gridinfo_init( gridname );
+    this_grid = pj_gridinfo_init( ctx, gridname );
 
     if( this_grid == NULL )
     {
@@ -161,53 +232,27 @@ static int pj_gridlist_merge_gridfile( const char *gridname )
 /* -------------------------------------------------------------------- */
 /*      Recurse to add the grid now that it is loaded.                  */
 /* -------------------------------------------------------------------- */
-    return pj_gridlist_merge_gridfile( gridname );
+    return pj_gridlist_merge_gridfile( ctx, gridname, p_gridlist, 
+                                       p_gridcount, p_gridmax );
 }
 
 /************************************************************************/
-/*                     pj_gridlist_from_nadgrids()                      */
+/*                        pj_gridlist_build()                           */
 /*                                                                      */
-/*      This functions loads the list of grids corresponding to a       */
-/*      particular nadgrids string into a list, and returns it.  The    */
-/*      list is kept around till a request is made with a different     */
-/*      string in order to cut down on the string parsing cost, and     */
-/*      the cost of building the list of tables each time.              */
+/*      Resolve a nadgrids string into a new list of grids, loading     */
+/*      grid headers as needed.  Must be called with the lock held.     */
 /************************************************************************/
 
-PJ_GRIDINFO **pj_gridlist_from_nadgrids( const char *nadgrids, int *grid_count)
+static PJ_GRIDINFO **pj_gridlist_build( projCtx ctx, const char *nadgrids, 
+                                        int *grid_count )
 
 {
     const char *s;
+    PJ_GRIDINFO **gridlist = NULL;
+    int grid_max = 0;
 
-    pj_errno = 0;
     *grid_count = 0;
 
-    pj_acquire_lock();
-    if( last_nadgrids != NULL 
-        && strcmp(nadgrids,last_nadgrids) == 0 )
-    {
-        PJ_GRIDINFO **ret = last_nadgrids_list;
-        *grid_count = last_nadgrids_count;
-        if( *grid_count == 0 )
-            pj_errno = -38;
-
-        pj_release_lock();
-        return ret;
-    }
-
-/* -------------------------------------------------------------------- */
-/*      Free old one, if any, and make space for new list.              */
-/* -------------------------------------------------------------------- */
-    if( last_nadgrids != NULL )
-    {
-        pj_dalloc(last_nadgrids);
-    }
-    
-    last_nadgrids = (char *) pj_malloc(strlen(nadgrids)+1);
-    strcpy( last_nadgrids, nadgrids );
-
-    last_nadgrids_count = 0;
-
 /* -------------------------------------------------------------------- */
 /*      Loop processing names out of nadgrids one at a time.            */
 /* -------------------------------------------------------------------- */
@@ -229,8 +274,8 @@ PJ_GRIDINFO **pj_gridlist_from_nadgrids( const char *nadgrids, int *grid_count)
 
         if( end_char > sizeof(name) )
         {
-            pj_errno = -38;
-            pj_release_lock();
+            pj_dalloc( gridlist );
+            pj_ctx_set_errno( ctx, -38 );
             return NULL;
         }
         
@@ -241,26 +286,202 @@ PJ_GRIDINFO **pj_gridlist_from_nadgrids( const char *nadgrids, int *grid_count)
         if( *s == ',' )
             s++;
 
-        if( !pj_gridlist_merge_gridfile( name ) && required )
+        if( !pj_gridlist_merge_gridfile( ctx, name, &gridlist, grid_count, 
+                                         &grid_max) 
+            && required )
         {
-            pj_errno = -38;
-            pj_release_lock();
+            pj_dalloc( gridlist );
+            pj_ctx_set_errno( ctx, -38 );
             return NULL;
         }
         else
-            pj_errno = 0;
+            ctx->last_errno = 0;
+    }
+
+    if( *grid_count == 0 )
+    {
+        pj_dalloc( gridlist );
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
     }
 
-    if( last_nadgrids_count > 0 )
+    return gridlist;
+}
+
+/************************************************************************/
+/*                         pj_gridlist_find()                           */
+/*                                                                      */
+/*      Look nadgrids up in the cache.  Must be called with the lock    */
+/*      held.                                                           */
+/************************************************************************/
+
+static PJ_GRIDLIST *pj_gridlist_find( const char *nadgrids )
+
+{
+    int i;
+
+    for( i = 0; i < GRIDLIST_CACHE_SIZE; i++ )
     {
-        PJ_GRIDINFO **ret = last_nadgrids_list;
-        *grid_count = last_nadgrids_count;
+        PJ_GRIDLIST *entry = gridlist_cache[i];
+
+        if( entry != NULL && strcmp( entry->nadgrids, nadgrids ) == 0 )
+            return entry;
+    }
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                        pj_gridlist_lookup()                          */
+/*                                                                      */
+/*      Return the resolved grid list for a nadgrids string, building   */
+/*      and caching it on first use.  The cache holds the last          */
+/*      GRIDLIST_CACHE_SIZE distinct strings.  The list is shared:      */
+/*      callers must not modify it, and give their reference back       */
+/*      with pj_gridlist_release().  Failures (a required grid          */
+/*      missing) are not cached, so a grid installed later is picked    */
+/*      up.                                                             */
+/************************************************************************/
+
+PJ_GRIDLIST *pj_gridlist_lookup( projCtx ctx, const char *nadgrids )
+
+{
+    PJ_GRIDLIST *entry;
+
+    ctx->last_errno = 0;
+
+    pj_acquire_lock();
+
+    entry = pj_gridlist_find( nadgrids );
+    if( entry != NULL )
+    {
+        entry->refcount++;
         pj_release_lock();
-        return ret;
+        return entry;
     }
-    else
+
+    entry = (PJ_GRIDLIST *) pj_malloc(sizeof(PJ_GRIDLIST));
+    if( entry == NULL )
+    {
+        pj_release_lock();
+        pj_ctx_set_errno( ctx, -2 );
+        return NULL;
+    }
+
+    entry->grids = pj_gridlist_build( ctx, nadgrids, &(entry->grid_count) );
+    entry->nadgrids = entry->grids != NULL ? strdup( nadgrids ) : NULL;
+    if( entry->nadgrids == NULL )
     {
+        pj_dalloc( entry->grids );
+        pj_dalloc( entry );
         pj_release_lock();
+        if( ctx->last_errno == 0 )
+            pj_ctx_set_errno( ctx, -2 );
+        return NULL;
+    }
+    entry->index = pj_gridindex_create( entry->grids, entry->grid_count );
+
+/* -------------------------------------------------------------------- */
+/*      Store in the next slot round robin, one reference for the       */
+/*      cache and one for the caller.  A displaced entry lives on       */
+/*      while PJs still hold it.                                        */
+/* -------------------------------------------------------------------- */
+    entry->refcount = 2;
+    if( gridlist_cache[gridlist_cache_next] != NULL )
+        pj_gridlist_unref( gridlist_cache[gridlist_cache_next] );
+
+    gridlist_cache[gridlist_cache_next] = entry;
+    gridlist_cache_next = (gridlist_cache_next + 1) % GRIDLIST_CACHE_SIZE;
+
+    pj_release_lock();
+
+    return entry;
+}
+
+/************************************************************************/
+/*                        pj_gridlist_release()                         */
+/*                                                                      */
+/*      Give back a reference from pj_gridlist_lookup().                */
+/************************************************************************/
+
+void pj_gridlist_release( PJ_GRIDLIST *entry )
+
+{
+    pj_acquire_lock();
+    pj_gridlist_unref( entry );
+    pj_release_lock();
+}
+
+/************************************************************************/
+/*                        pj_gridlist_resolve()                         */
+/*                                                                      */
+/*      Set defn->gridlist from its +nadgrids, if not done yet, and     */
+/*      return it.  Two threads may race to do this on a shared PJ;     */
+/*      only one result is kept, and it is complete before it is        */
+/*      visible.  The reference is given back by pj_free().             */
+/************************************************************************/
+
+PJ_GRIDLIST *pj_gridlist_resolve( PJ *defn )
+
+{
+    PJ_GRIDLIST *gridlist;
+
+    gridlist = pj_gridlist_lookup( pj_get_ctx( defn ),
+                                   pj_param(defn->ctx, defn->params,
+                                            "snadgrids").s );
+    if( gridlist == NULL )
+        return NULL;
+
+    pj_acquire_lock();
+    if( defn->gridlist == NULL )
+    {
+        PJ_PUBLISH_BARRIER();
+        defn->gridlist = gridlist;
+    }
+    else
+        pj_gridlist_unref( gridlist );
+    pj_release_lock();
+
+    return defn->gridlist;
+}
+
+/************************************************************************/
+/*                     pj_gridlist_from_nadgrids()                      */
+/*                                                                      */
+/*      This functions loads the list of grids corresponding to a       */
+/*      particular nadgrids string into a list, and returns it.  The    */
+/*      returned list is a copy owned by the caller and should be       */
+/*      released with pj_dalloc() (the grids themselves remain in the   */
+/*      shared grid_list).  Internally pj_gridlist_lookup() is used     */
+/*      instead, which avoids the copy.                                 */
+/************************************************************************/
+
+PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids, 
+                                         int *grid_count)
+
+{
+    PJ_GRIDLIST *entry;
+    PJ_GRIDINFO **gridlist;
+
+    *grid_count = 0;
+
+    entry = pj_gridlist_lookup( ctx, nadgrids );
+    if( entry == NULL )
+        return NULL;
+
+    gridlist = (PJ_GRIDINFO **) 
+        pj_malloc(sizeof(void*) * (entry->grid_count + 1));
+    if( gridlist == NULL )
+    {
+        pj_gridlist_release( entry );
+        pj_ctx_set_errno( ctx, -2 );
         return NULL;
     }
+
+    memcpy( gridlist, entry->grids, sizeof(void*) * entry->grid_count );
+    gridlist[entry->grid_count] = NULL;
+    *grid_count = entry->grid_count;
+    pj_gridlist_release( entry );
+
+    return gridlist;
 }
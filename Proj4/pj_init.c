@@ -34,51 +34,41 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
-#include <locale.h>
 
 PJ_CVSID("$Id: pj_init.c 1630 2009-09-24 02:14:06Z warmerdam $");
 
-extern FILE *pj_open_lib(char *, char *);
-
 /************************************************************************/
 /*                              get_opt()                               */
+/*                                                                      */
+/*      Add the parameters of an init file section (as found by         */
+/*      pj_initfile_lookup()) that are not already set, after next      */
+/*      with the given PJ_PARAM_* flags.                                */
 /************************************************************************/
 static paralist *
-get_opt(paralist **start, FILE *fid, char *name, paralist *next) {
-    char sword[302], *word = sword+1;
-    int first = 1, len, c;
+get_opt(projCtx ctx, paralist **start, const char *section, const char *end,
+        paralist *next, int flags) {
+    char sword[PJ_INITFILE_WORD+2], *word = sword+1;
 
-    len = strlen(name);
     *sword = 't';
-    while (fscanf(fid, "%300s", word) == 1) {
-        if (*word == '#') /* skip comments */
-            while((c = fgetc(fid)) != EOF && c != '\n') ;
-        else if (*word == '<') { /* control name */
-            if (first && !strncmp(name, word + 1, len)
-                && word[len + 1] == '>')
-                first = 0;
-            else if (!first && *word == '<') {
-                while((c = fgetc(fid)) != EOF && c != '\n') ;
-                break;
-            }
-        } else if (!first && !pj_param(*start, sword).i) {
+    while (pj_initfile_word(&section, end, word)) {
+        if (*word == '<') /* next control name */
+            break;
+        else if (!pj_param(ctx, *start, sword).i) {
             /* don't default ellipse if datum, ellps or any earth model
                information is set. */
             if( strncmp(word,"ellps=",6) != 0 
-                || (!pj_param(*start, "tdatum").i 
-                    && !pj_param(*start, "tellps").i 
-                    && !pj_param(*start, "ta").i 
-                    && !pj_param(*start, "tb").i 
-                    && !pj_param(*start, "trf").i 
-                    && !pj_param(*start, "tf").i) )
+                || (!pj_param(ctx, *start, "tdatum").i 
+                    && !pj_param(ctx, *start, "tellps").i 
+                    && !pj_param(ctx, *start, "ta").i 
+                    && !pj_param(ctx, *start, "tb").i 
+                    && !pj_param(ctx, *start, "trf").i 
+                    && !pj_param(ctx, *start, "tf").i) )
             {
-                next = next->next = pj_mkparam(word);
+                next = pj_param_add(next, word, flags);
             }
         }
     }
 
-    if (errno == 25)
-        errno = 0;
     return next;
 }
 
@@ -86,15 +76,17 @@ get_opt(paralist **start, FILE *fid, char *name, paralist *next) {
 /*                            get_defaults()                            */
 /************************************************************************/
 static paralist *
-get_defaults(paralist **start, paralist *next, char *name) {
-	FILE *fid;
-
-	if ((fid = pj_open_lib("proj_def.dat", "rt"))) {
-		next = get_opt(start, fid, "general", next);
-		rewind(fid);
-		next = get_opt(start, fid, name, next);
-		(void)fclose(fid);
-	}
+get_defaults(projCtx ctx, paralist **start, paralist *next, char *name) {
+	const char *section, *end;
+
+	if (pj_initfile_lookup(ctx, "proj_def.dat", "general",
+			       &section, &end) > 0)
+		next = get_opt(ctx, start, section, end, next,
+			       PJ_PARAM_APPENDED);
+	if (pj_initfile_lookup(ctx, "proj_def.dat", name,
+			       &section, &end) > 0)
+		next = get_opt(ctx, start, section, end, next,
+			       PJ_PARAM_APPENDED);
 	if (errno)
 		errno = 0; /* don't care if can't open file */
 	return next;
@@ -102,42 +94,45 @@ get_defaults(paralist **start, paralist *next, char *name) {
 
 /************************************************************************/
 /*                              get_init()                              */
+/*                                                                      */
+/*      Add the +init= parameters after next, our last entry.  When     */
+/*      they come from the init cache, its list is linked in as is      */
+/*      and *shared gets the reference on it, and next stays our        */
+/*      last entry.                                                     */
 /************************************************************************/
 static paralist *
-get_init(paralist **start, paralist *next, char *name) {
+get_init(projCtx ctx, paralist **start, paralist *next, char *name,
+         struct PJ_INITENTRY **shared) {
 	char fname[MAX_PATH_FILENAME+ID_TAG_MAX+3], *opt;
-	FILE *fid;
-	paralist *init_items = NULL;
+	const char *section, *end;
+	const paralist *init_items = NULL;
 	const paralist *orig_next = next;
+	int found;
 
 	(void)strncpy(fname, name, MAX_PATH_FILENAME + ID_TAG_MAX + 1);
 	
 	/* 
-	** Search for file/key pair in cache 
+	** Search for file/key pair in cache, and share its list
 	*/
 	
-	init_items = pj_search_initcache( name );
+	init_items = pj_search_initcache( name, shared );
 	if( init_items != NULL )
 	  {
-	    next->next = init_items;
-	    while( next->next != NULL )
-	      next = next->next;
+	    next->next = (paralist *) init_items;
 	    return next;
 	  }
 
 	/*
-	** Otherwise we try to open the file and search for it.
+	** Otherwise look the key up in the file's index.
 	*/
 	if ((opt = strrchr(fname, ':')))
 		*opt++ = '\0';
-	else { pj_errno = -3; return(0); }
-	if ((fid = pj_open_lib(fname, "rt")))
-		next = get_opt(start, fid, opt, next);
-	else
+	else { pj_ctx_set_errno(ctx,-3); return(0); }
+	found = pj_initfile_lookup(ctx, fname, opt, &section, &end);
+	if (found < 0)
 		return(0);
-	(void)fclose(fid);
-	if (errno == 25)
-		errno = 0; /* unknown problem with some sys errno<-25 */
+	if (found > 0)
+		next = get_opt(ctx, start, section, end, next, 0);
 
 	/* 
 	** If we seem to have gotten a result, insert it into the 
@@ -161,17 +156,49 @@ PJ *
 pj_init_plus( const char *definition )
 
 {
-#define MAX_ARG 200
-    char	*argv[MAX_ARG];
+    return pj_init_plus_ctx( pj_get_default_ctx(), definition );
+}
+
+PJ *
+pj_init_plus_ctx( projCtx ctx, const char *definition )
+{
+    char	*argv[PJ_MAX_ARG];
     char	*defn_copy;
-    int		argc = 0, i;
+    int		argc;
     PJ	        *result;
     
     /* make a copy that we can manipulate */
     defn_copy = (char *) pj_malloc( strlen(definition)+1 );
     strcpy( defn_copy, definition );
 
-    /* split into arguments based on '+' and trim white space */
+    argc = pj_split_definition( ctx, defn_copy, argv );
+    if( argc < 0 )
+    {
+        pj_dalloc( defn_copy );
+        return NULL;
+    }
+
+    /* perform actual initialization */
+    result = pj_init_ctx( ctx, argc, argv );
+
+    pj_dalloc( defn_copy );
+
+    return result;
+}
+
+/************************************************************************/
+/*                        pj_split_definition()                         */
+/*                                                                      */
+/*      Split a copy of a pj_init_plus() definition in place into       */
+/*      arguments (at least PJ_MAX_ARG slots), based on '+' and         */
+/*      trimming white space.  Returns the argument count, or -1 if     */
+/*      there are too many.                                             */
+/************************************************************************/
+
+int pj_split_definition( projCtx ctx, char *defn_copy, char **argv )
+
+{
+    int		argc = 0, i;
 
     for( i = 0; defn_copy[i] != '\0'; i++ )
     {
@@ -180,10 +207,10 @@ pj_init_plus( const char *definition )
           case '+':
             if( i == 0 || defn_copy[i-1] == '\0' )
             {
-                if( argc+1 == MAX_ARG )
+                if( argc+1 == PJ_MAX_ARG )
                 {
-                    pj_errno = -44;
-                    return NULL;
+                    pj_ctx_set_errno( ctx, -44 );
+                    return -1;
                 }
                 
                 argv[argc++] = defn_copy + i + 1;
@@ -201,12 +228,7 @@ pj_init_plus( const char *definition )
         }
     }
 
-    /* perform actual initialization */
-    result = pj_init( argc, argv );
-
-    pj_dalloc( defn_copy );
-
-    return result;
+    return argc;
 }
 
 /************************************************************************/
@@ -220,61 +242,68 @@ pj_init_plus( const char *definition )
 
 PJ *
 pj_init(int argc, char **argv) {
+    return pj_init_ctx( pj_get_default_ctx(), argc, argv );
+}
+
+PJ *
+pj_init_ctx(projCtx ctx, int argc, char **argv) {
 	char *s, *name;
         paralist *start = NULL;
+	struct PJ_LIST *entry;
 	PJ *(*proj)(PJ *);
 	paralist *curr;
+	struct PJ_INITENTRY *shared = NULL;
 	int i;
 	PJ *PIN = 0;
-        const char *old_locale;
 
-	errno = pj_errno = 0;
+	ctx->last_errno = 0;
+	errno = 0;
         start = NULL;
 
-        old_locale = setlocale(LC_NUMERIC, NULL); 
-        setlocale(LC_NUMERIC,"C");
-
 	/* put arguments into internal linked list */
-	if (argc <= 0) { pj_errno = -1; goto bum_call; }
+	if (argc <= 0) { pj_ctx_set_errno( ctx, -1 ); goto bum_call; }
 	for (i = 0; i < argc; ++i)
 		if (i)
 			curr = curr->next = pj_mkparam(argv[i]);
 		else
 			start = curr = pj_mkparam(argv[i]);
-	if (pj_errno) goto bum_call;
+	if (ctx->last_errno) goto bum_call;
 
 	/* check if +init present */
-	if (pj_param(start, "tinit").i) {
+	if (pj_param(ctx, start, "tinit").i) {
 		paralist *last = curr;
 
-		if (!(curr = get_init(&start, curr, pj_param(start, "sinit").s)))
+		if (!(curr = get_init(ctx,&start, curr, pj_param(ctx, start, "sinit").s,
+				      &shared)))
 			goto bum_call;
-		if (curr == last) { pj_errno = -2; goto bum_call; }
+		if (!last->next) { pj_ctx_set_errno( ctx, -2); goto bum_call; }
 	}
 
 	/* find projection selection */
-	if (!(name = pj_param(start, "sproj").s))
-		{ pj_errno = -4; goto bum_call; }
-	for (i = 0; (s = pj_list[i].id) && strcmp(name, s) ; ++i) ;
-	if (!s) { pj_errno = -5; goto bum_call; }
+	if (!(name = pj_param(ctx, start, "sproj").s))
+		{ pj_ctx_set_errno( ctx, -4 ); goto bum_call; }
+	if (!(entry = pj_find_proj(name)))
+		{ pj_ctx_set_errno( ctx, -5 ); goto bum_call; }
 
 	/* set defaults, unless inhibited */
-	if (!pj_param(start, "bno_defs").i)
-		curr = get_defaults(&start, curr, name);
-	proj = (PJ *(*)(PJ *)) pj_list[i].proj;
+	if (!pj_param(ctx, start, "bno_defs").i)
+		curr = get_defaults(ctx,&start, curr, name);
+	proj = (PJ *(*)(PJ *)) entry->proj;
 
 	/* allocate projection structure */
 	if (!(PIN = (*proj)(0))) goto bum_call;
+	PIN->ctx = ctx;
 	PIN->params = start;
+	PIN->initcache = shared;
         PIN->is_latlong = 0;
         PIN->is_geocent = 0;
         PIN->long_wrap_center = 0.0;
 
         /* set datum parameters */
-        if (pj_datum_set(start, PIN)) goto bum_call;
+        if (pj_datum_set(ctx, start, PIN)) goto bum_call;
 
 	/* set ellipsoid/sphere parameters */
-	if (pj_ell_set(start, &PIN->a, &PIN->es)) goto bum_call;
+	if (pj_ell_set(ctx, start, &PIN->a, &PIN->es)) goto bum_call;
 
         PIN->a_orig = PIN->a;
         PIN->es_orig = PIN->es;
@@ -282,7 +311,7 @@ pj_init(int argc, char **argv) {
 	PIN->e = sqrt(PIN->es);
 	PIN->ra = 1. / PIN->a;
 	PIN->one_es = 1. - PIN->es;
-	if (PIN->one_es == 0.) { pj_errno = -6; goto bum_call; }
+	if (PIN->one_es == 0.) { pj_ctx_set_errno( ctx, -6 ); goto bum_call; }
 	PIN->rone_es = 1./PIN->one_es;
 
         /* Now that we have ellipse information check for WGS84 datum */
@@ -297,93 +326,91 @@ pj_init(int argc, char **argv) {
         }
         
 	/* set PIN->geoc coordinate system */
-	PIN->geoc = (PIN->es && pj_param(start, "bgeoc").i);
+	PIN->geoc = (PIN->es && pj_param(ctx, start, "bgeoc").i);
 
 	/* over-ranging flag */
-	PIN->over = pj_param(start, "bover").i;
+	PIN->over = pj_param(ctx, start, "bover").i;
 
 	/* longitude center for wrapping */
-	PIN->long_wrap_center = pj_param(start, "rlon_wrap").f;
+	PIN->long_wrap_center = pj_param(ctx, start, "rlon_wrap").f;
 
 	/* central meridian */
-	PIN->lam0=pj_param(start, "rlon_0").f;
+	PIN->lam0=pj_param(ctx, start, "rlon_0").f;
 
 	/* central latitude */
-	PIN->phi0 = pj_param(start, "rlat_0").f;
+	PIN->phi0 = pj_param(ctx, start, "rlat_0").f;
 
 	/* false easting and northing */
-	PIN->x0 = pj_param(start, "dx_0").f;
-	PIN->y0 = pj_param(start, "dy_0").f;
+	PIN->x0 = pj_param(ctx, start, "dx_0").f;
+	PIN->y0 = pj_param(ctx, start, "dy_0").f;
 
 	/* general scaling factor */
-	if (pj_param(start, "tk_0").i)
-		PIN->k0 = pj_param(start, "dk_0").f;
-	else if (pj_param(start, "tk").i)
-		PIN->k0 = pj_param(start, "dk").f;
+	if (pj_param(ctx, start, "tk_0").i)
+		PIN->k0 = pj_param(ctx, start, "dk_0").f;
+	else if (pj_param(ctx, start, "tk").i)
+		PIN->k0 = pj_param(ctx, start, "dk").f;
 	else
 		PIN->k0 = 1.;
 	if (PIN->k0 <= 0.) {
-		pj_errno = -31;
+		pj_ctx_set_errno( ctx, -31 );
 		goto bum_call;
 	}
 
 	/* set units */
 	s = 0;
-	if ((name = pj_param(start, "sunits").s)) { 
-		for (i = 0; (s = pj_units[i].id) && strcmp(name, s) ; ++i) ;
-		if (!s) { pj_errno = -7; goto bum_call; }
-		s = pj_units[i].to_meter;
+	if ((name = pj_param(ctx, start, "sunits").s)) { 
+		struct PJ_UNITS *units = pj_find_units(name);
+
+		if (!units) { pj_ctx_set_errno( ctx, -7 ); goto bum_call; }
+		s = units->to_meter;
 	}
-	if (s || (s = pj_param(start, "sto_meter").s)) {
-		PIN->to_meter = strtod(s, &s);
+	if (s || (s = pj_param(ctx, start, "sto_meter").s)) {
+		PIN->to_meter = pj_strtod(s, &s);
 		if (*s == '/') /* ratio number */
-			PIN->to_meter /= strtod(++s, 0);
+			PIN->to_meter /= pj_strtod(++s, 0);
 		PIN->fr_meter = 1. / PIN->to_meter;
 	} else
 		PIN->to_meter = PIN->fr_meter = 1.;
 
 	/* prime meridian */
 	s = 0;
-	if ((name = pj_param(start, "spm").s)) { 
+	if ((name = pj_param(ctx, start, "spm").s)) { 
             const char *value = NULL;
             char *next_str = NULL;
+            struct PJ_PRIME_MERIDIANS *pm = pj_find_prime_meridian(name);
 
-            for (i = 0; pj_prime_meridians[i].id != NULL; ++i )
-            {
-                if( strcmp(name,pj_prime_meridians[i].id) == 0 )
-                {
-                    value = pj_prime_meridians[i].defn;
-                    break;
-                }
-            }
+            if( pm != NULL )
+                value = pm->defn;
             
             if( value == NULL 
-                && (dmstor(name,&next_str) != 0.0  || *name == '0')
+                && (dmstor_ctx(ctx,name,&next_str) != 0.0  || *name == '0')
                 && *next_str == '\0' )
                 value = name;
 
-            if (!value) { pj_errno = -46; goto bum_call; }
-            PIN->from_greenwich = dmstor(value,NULL);
+            if (!value) { pj_ctx_set_errno( ctx, -46 ); goto bum_call; }
+            PIN->from_greenwich = dmstor_ctx(ctx,value,NULL);
 	}
         else
             PIN->from_greenwich = 0.0;
 
 	/* projection specific initialization */
-	if (!(PIN = (*proj)(PIN)) || errno || pj_errno) {
+	if (!(PIN = (*proj)(PIN)) || errno || ctx->last_errno) {
 bum_call: /* cleanup error return */
-		if (!pj_errno)
-			pj_errno = errno;
+		if (!ctx->last_errno)
+			pj_ctx_set_errno( ctx, errno );
 		if (PIN)
 			pj_free(PIN);
-		else
-			for ( ; start; start = curr) {
+		else {
+			for ( ; start && !(start->used & PJ_PARAM_SHARED);
+			      start = curr) {
 				curr = start->next;
 				pj_dalloc(start);
 			}
+			if (shared)
+				pj_release_initcache(shared);
+		}
 		PIN = 0;
 	}
-        setlocale(LC_NUMERIC,old_locale);
-
 	return PIN;
 }
 
@@ -402,11 +429,21 @@ pj_free(PJ *P) {
 	if (P) {
 		paralist *t = P->params, *n;
 
-		/* free parameter list elements */
-		for (t = P->params; t; t = n) {
+		/* definitions from pj_init_plus_cached() go when unused */
+		if (P->refcount != 0 && pj_defncache_release(P) > 0)
+			return;
+
+		/* free parameter list elements, up to any shared ones */
+		for (t = P->params; t && !(t->used & PJ_PARAM_SHARED); t = n) {
 			n = t->next;
 			pj_dalloc(t);
 		}
+		if (P->initcache)
+			pj_release_initcache(P->initcache);
+
+		/* give back our reference on the grid list cache entry */
+		if (P->gridlist)
+			pj_gridlist_release(P->gridlist);
 
 		/* free projection parameters */
 		P->pfree(P);
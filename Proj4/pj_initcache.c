@@ -32,10 +32,66 @@
 
 PJ_CVSID("$Id: pj_transform.c 1504 2009-01-06 02:11:57Z warmerdam $");
 
+/*
+** The cache is an open addressing hash table of fixed size.  Slots are
+** only written with the lock held, and only after the entry is
+** complete, and entries are never changed or removed until
+** pj_clear_initcache(), so pj_search_initcache() reads it without the
+** lock.  Once PJ_INITCACHE_MAX definitions are held, no more are added.
+**
+** A hit gives the cached list itself, flagged PJ_PARAM_SHARED, for
+** pj_init() to link into a definition without copying it, along with a
+** reference on the entry that the PJ gives back when freed.  Entries
+** outlive pj_clear_initcache() until then.
+*/
+#define INITCACHE_SLOTS (2 * PJ_INITCACHE_MAX)
+
+typedef struct PJ_INITENTRY {
+  char     *key;
+  unsigned hash;
+  paralist *list;
+  volatile long refcount;       /* cache slot plus PJs sharing the list */
+} PJ_INITENTRY;
+
+static PJ_INITENTRY * volatile cache_slot[INITCACHE_SLOTS];
 static int cache_count = 0;
-static int cache_alloc = 0;
-static char **cache_key = NULL;
-static paralist **cache_paralist = NULL;
+static volatile long cache_hits = 0;
+static volatile long cache_misses = 0;
+
+/************************************************************************/
+/*                            pj_initcache_hash()                       */
+/************************************************************************/
+
+static unsigned pj_initcache_hash( const char *filekey )
+
+{
+  unsigned hash = 2166136261U;
+
+  for( ; *filekey != '\0'; filekey++ )
+    hash = (hash ^ (unsigned char) *filekey) * 16777619U;
+
+  return hash;
+}
+
+/************************************************************************/
+/*                            pj_initcache_find()                       */
+/*                                                                      */
+/*      Slot holding filekey, or the empty slot ending its probe        */
+/*      sequence.                                                       */
+/************************************************************************/
+
+static int pj_initcache_find( const char *filekey, unsigned hash )
+
+{
+  int          i = hash & (INITCACHE_SLOTS - 1);
+  PJ_INITENTRY *entry;
+
+  while( (entry = cache_slot[i]) != NULL
+         && (entry->hash != hash || strcmp( entry->key, filekey ) != 0) )
+    i = (i + 1) & (INITCACHE_SLOTS - 1);
+
+  return i;
+}
 
 /************************************************************************/
 /*                            pj_clone_paralist()                       */
@@ -53,6 +109,7 @@ paralist *pj_clone_paralist( const paralist *list)
 	pj_malloc(sizeof(paralist) + strlen(list->param));
 
       newitem->used = 0;
+      newitem->shared_used = 0;
       newitem->next = 0;
       strcpy( newitem->param, list->param );
       
@@ -68,114 +125,174 @@ paralist *pj_clone_paralist( const paralist *list)
 }
 
 /************************************************************************/
-/*                            pj_clear_initcache()                      */
-/*                                                                      */
-/*      Clear out all memory held in the init file cache.               */
+/*                            pj_initcache_free()                       */
 /************************************************************************/
 
-void pj_clear_initcache()
+static void pj_initcache_free( PJ_INITENTRY *entry )
+
 {
-  if( cache_alloc > 0 )
-  {
-    int i;
-
-    pj_acquire_lock();
-
-    for( i = 0; i < cache_count; i++ )
-      {
-	paralist *n, *t = cache_paralist[i];
-		
-	pj_dalloc( cache_key[i] );
-
-	/* free parameter list elements */
-	for (; t != NULL; t = n) {
-	  n = t->next;
-	  pj_dalloc(t);
-	}
-      }
-
-    pj_dalloc( cache_key );
-    pj_dalloc( cache_paralist );
-    cache_count = 0;
-    cache_alloc= 0;
-    cache_key = NULL;
-    cache_paralist = NULL;
-
-    pj_release_lock();
+  paralist *n, *t;
+
+  /* free parameter list elements */
+  for( t = entry->list; t != NULL; t = n ) {
+    n = t->next;
+    pj_dalloc(t);
   }
+
+  pj_dalloc( entry->key );
+  pj_dalloc( entry );
 }
 
 /************************************************************************/
-/*                            pj_search_initcache()                     */
+/*                            pj_release_initcache()                    */
 /*                                                                      */
-/*      Search for a matching definition in the init cache.             */
+/*      Give back a reference from pj_search_initcache().               */
 /************************************************************************/
 
-paralist *pj_search_initcache( const char *filekey )
+void pj_release_initcache( PJ_INITENTRY *entry )
 
+{
+  if( PJ_ATOMIC_DEC( entry->refcount ) == 1 )
+    pj_initcache_free( entry );
+}
+
+/************************************************************************/
+/*                            pj_clear_initcache()                      */
+/*                                                                      */
+/*      Clear out all memory held in the init file cache, and the       */
+/*      init files themselves.  No other thread may be using the        */
+/*      cache.                                                          */
+/************************************************************************/
+
+void pj_clear_initcache()
 {
   int i;
-  paralist *result = NULL;
+
+  pj_clear_initfiles();
 
   pj_acquire_lock();
 
-  for( i = 0; result == NULL && i < cache_count; i++)
+  for( i = 0; i < INITCACHE_SLOTS; i++ )
     {
-      if( strcmp(filekey,cache_key[i]) == 0 )
-	{
-	  result = pj_clone_paralist( cache_paralist[i] );
-	}
+      if( cache_slot[i] != NULL )
+	pj_release_initcache( cache_slot[i] );
+      cache_slot[i] = NULL;
     }
 
+  cache_count = 0;
+  cache_hits = 0;
+  cache_misses = 0;
+
   pj_release_lock();
+}
+
+/************************************************************************/
+/*                            pj_search_initcache()                     */
+/*                                                                      */
+/*      Search for a matching definition in the init cache.  The        */
+/*      list returned is shared and must not be changed; *entry         */
+/*      gets a reference keeping it alive, to give back with            */
+/*      pj_release_initcache().                                         */
+/************************************************************************/
 
-  return result;
+const paralist *pj_search_initcache( const char *filekey,
+                                     PJ_INITENTRY **entry_out )
+
+{
+  PJ_INITENTRY *entry;
+
+  entry = cache_slot[pj_initcache_find( filekey,
+                                        pj_initcache_hash( filekey ) )];
+
+  if( entry == NULL )
+    {
+      PJ_ATOMIC_INC( cache_misses );
+      return NULL;
+    }
+
+  PJ_ATOMIC_INC( cache_hits );
+  PJ_ATOMIC_INC( entry->refcount );
+  *entry_out = entry;
+  return entry->list;
 }
 
 /************************************************************************/
 /*                            pj_insert_initcache()                     */
 /*                                                                      */
-/*      Insert a paralist definition in the init file cache.            */
+/*      Insert a paralist definition in the init file cache.  Lists     */
+/*      longer than a PJ can track the use of while sharing them        */
+/*      (PJ_PARAM_SHARED_MAX) are left out; the init file index         */
+/*      still finds them quickly.                                       */
 /************************************************************************/
 
 void pj_insert_initcache( const char *filekey, const paralist *list )
 
 {
-  pj_acquire_lock();
+  PJ_INITENTRY *entry;
+  const paralist *p;
+  paralist *item;
+  unsigned hash = pj_initcache_hash( filekey );
+  int i, count = 0;
 
-  /* 
-  ** Grow list if required.
+  for( p = list; p != NULL; p = p->next )
+    if( ++count > PJ_PARAM_SHARED_MAX )
+      return;
+
+  /*
+  ** Duplicate the filekey and paralist before taking the lock.
   */
-  if( cache_count == cache_alloc )
+  entry = (PJ_INITENTRY *) pj_malloc(sizeof(PJ_INITENTRY));
+  if( entry == NULL )
+    return;
+
+  entry->hash = hash;
+  entry->refcount = 1;
+  entry->key = (char *) pj_malloc(strlen(filekey)+1);
+  entry->list = pj_clone_paralist( list );
+  if( entry->key == NULL || (entry->list == NULL && list != NULL) )
     {
-      char **cache_key_new;
-      paralist **cache_paralist_new;
-
-      cache_alloc = cache_alloc * 2 + 15;
-
-      cache_key_new = (char **) pj_malloc(sizeof(char*) * cache_alloc);
-      memcpy( cache_key, cache_key_new, sizeof(char*) * cache_count);
-      pj_dalloc( cache_key );
-      cache_key = cache_key_new;
-
-      cache_paralist_new = (paralist **) 
-	pj_malloc(sizeof(paralist*) * cache_alloc);
-      memcpy( cache_paralist_new, cache_paralist, 
-	      sizeof(paralist*) * cache_count );
-      pj_dalloc( cache_paralist );
-      cache_paralist = cache_paralist_new;
+      pj_initcache_free( entry );
+      return;
     }
+  strcpy( entry->key, filekey );
+  for( item = entry->list; item != NULL; item = item->next )
+    item->used = PJ_PARAM_SHARED;
+
+  pj_acquire_lock();
 
   /*
-  ** Duplicate the filekey and paralist, and insert in cache.
+  ** Publish it, unless the cache is full or another thread got
+  ** there first.
   */
-  cache_key[cache_count] = (char *) pj_malloc(strlen(filekey)+1);
-  strcpy( cache_key[cache_count], filekey );
-
-  cache_paralist[cache_count] = pj_clone_paralist( list );
-
-  cache_count++;
+  i = pj_initcache_find( filekey, hash );
+  if( cache_slot[i] == NULL && cache_count < PJ_INITCACHE_MAX )
+    {
+      PJ_PUBLISH_BARRIER();
+      cache_slot[i] = entry;
+      cache_count++;
+      entry = NULL;
+    }
 
   pj_release_lock();
+
+  if( entry != NULL )
+    pj_initcache_free( entry );
 }
 
+/************************************************************************/
+/*                          pj_get_initcache_stats()                    */
+/*                                                                      */
+/*      Report hits and misses of the init file cache since it was      */
+/*      last cleared, and the number of definitions it holds.           */
+/************************************************************************/
+
+void pj_get_initcache_stats( long *hits, long *misses, int *count )
+
+{
+  if( hits != NULL )
+    *hits = cache_hits;
+  if( misses != NULL )
+    *misses = cache_misses;
+  if( count != NULL )
+    *count = cache_count;
+}
@@ -0,0 +1,398 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Keep init files (epsg, proj_def.dat, ...) in memory with an
+ *           index of their <tag> sections, so pj_init() finds a section
+ *           with one hash lookup instead of reading the file through.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Init files are mapped where mmap() is available, as for "ctable2"
+** grids.  Define PJ_NO_MMAP to always read them.
+*/
+#if !defined(_WIN32) && !defined(PJ_NO_MMAP)
+#  define PJ_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
+
+typedef struct {
+    const char *key;            /* tag name, in the file text */
+    int        key_len;
+    const char *section;        /* text following the tag */
+} PJ_INITTAG;
+
+typedef struct PJ_INITFILE {
+    char        *name;          /* as passed to pj_open_lib() */
+    const char  *text;
+    const char  *end;
+    void        *map;           /* mmap()ed text, or NULL if read */
+    size_t      map_size;
+    PJ_INITTAG  *tags;          /* open addressing, tag_alloc slots */
+    int         tag_alloc;
+    struct PJ_INITFILE *next;
+} PJ_INITFILE;
+
+static PJ_INITFILE *initfile_list = NULL;
+
+/************************************************************************/
+/*                         pj_initfile_word()                           */
+/*                                                                      */
+/*      Fetch the next word of init file text into word[] (at least     */
+/*      PJ_INITFILE_WORD+1 bytes), skipping "#" comments, and advance   */
+/*      *next past it.  Words are split as fscanf("%300s") would.       */
+/*      Returns 0 at the end of the text.                               */
+/************************************************************************/
+
+int pj_initfile_word( const char **next, const char *end, char *word )
+
+{
+    const char *p = *next;
+    int        len;
+
+    for( ;; )
+    {
+        while( p < end && (*p == ' ' || (*p >= '\t' && *p <= '\r')) )
+            p++;
+        if( p == end )
+        {
+            *next = p;
+            return 0;
+        }
+
+        for( len = 0;
+             p < end && len < PJ_INITFILE_WORD
+                 && !(*p == ' ' || (*p >= '\t' && *p <= '\r'));
+             len++ )
+            word[len] = *p++;
+        word[len] = '\0';
+
+        if( *word != '#' )
+            break;
+
+        /* skip comment */
+        while( p < end && *p != '\n' )
+            p++;
+    }
+
+    *next = p;
+    return 1;
+}
+
+/************************************************************************/
+/*                          pj_initfile_hash()                          */
+/************************************************************************/
+
+static unsigned pj_initfile_hash( const char *key, int key_len )
+
+{
+    unsigned hash = 2166136261U;
+    int      i;
+
+    for( i = 0; i < key_len; i++ )
+        hash = (hash ^ (unsigned char) key[i]) * 16777619U;
+
+    return hash;
+}
+
+/************************************************************************/
+/*                          pj_initfile_find()                          */
+/*                                                                      */
+/*      Slot for a tag name: either the tag or the empty slot where     */
+/*      it would go.                                                    */
+/************************************************************************/
+
+static PJ_INITTAG *pj_initfile_find( PJ_INITFILE *file,
+                                     const char *key, int key_len )
+
+{
+    unsigned i = pj_initfile_hash( key, key_len ) & (file->tag_alloc - 1);
+
+    while( file->tags[i].key != NULL
+           && (file->tags[i].key_len != key_len
+               || memcmp( file->tags[i].key, key, key_len ) != 0) )
+        i = (i + 1) & (file->tag_alloc - 1);
+
+    return file->tags + i;
+}
+
+/************************************************************************/
+/*                          pj_initfile_tag()                           */
+/*                                                                      */
+/*      Is word a tag?  pj_init() matches "<name>" at the start of a    */
+/*      word, so the name runs up to the first '>'.                     */
+/************************************************************************/
+
+static int pj_initfile_tag( const char *word )
+
+{
+    const char *close;
+
+    if( *word != '<' || (close = strchr( word, '>' )) == NULL )
+        return -1;
+
+    return (int) (close - word - 1);
+}
+
+/************************************************************************/
+/*                          pj_initfile_index()                         */
+/*                                                                      */
+/*      Build the tag table of a loaded file.  The first section with   */
+/*      a given name wins, as when reading the file through.            */
+/************************************************************************/
+
+static int pj_initfile_index( PJ_INITFILE *file )
+
+{
+    char       word[PJ_INITFILE_WORD+1];
+    const char *next;
+    int        tag_count = 0;
+
+    for( next = file->text; pj_initfile_word( &next, file->end, word ); )
+    {
+        if( pj_initfile_tag( word ) >= 0 )
+            tag_count++;
+    }
+
+    for( file->tag_alloc = 16; file->tag_alloc < 2 * tag_count; )
+        file->tag_alloc *= 2;
+
+    file->tags = (PJ_INITTAG *)
+        pj_malloc(sizeof(PJ_INITTAG) * file->tag_alloc);
+    if( file->tags == NULL )
+        return 0;
+    memset( file->tags, 0, sizeof(PJ_INITTAG) * file->tag_alloc );
+
+    for( next = file->text; pj_initfile_word( &next, file->end, word ); )
+    {
+        int        key_len = pj_initfile_tag( word );
+        const char *key = next - strlen(word) + 1;
+        PJ_INITTAG *tag;
+
+        if( key_len < 0 )
+            continue;
+
+        tag = pj_initfile_find( file, key, key_len );
+        if( tag->key == NULL )
+        {
+            tag->key = key;
+            tag->key_len = key_len;
+            tag->section = next;
+        }
+    }
+
+    return 1;
+}
+
+/************************************************************************/
+/*                          pj_initfile_free()                          */
+/************************************************************************/
+
+static void pj_initfile_free( PJ_INITFILE *file )
+
+{
+#ifdef PJ_MMAP
+    if( file->map != NULL )
+        munmap( file->map, file->map_size );
+    else
+#endif
+        pj_dalloc( (char *) file->text );
+
+    pj_dalloc( file->tags );
+    pj_dalloc( file->name );
+    pj_dalloc( file );
+}
+
+/************************************************************************/
+/*                          pj_initfile_load()                          */
+/*                                                                      */
+/*      Find an init file, and map or read all of it.  Returns NULL     */
+/*      (with errno set by pj_open_lib()) if it cannot be opened.       */
+/************************************************************************/
+
+static PJ_INITFILE *pj_initfile_load( projCtx ctx, const char *name )
+
+{
+    PJ_INITFILE *file;
+    FILE        *fid;
+    char        *text;
+    long        size;
+
+    if( (fid = pj_open_lib( ctx, (char *) name, "rb" )) == NULL )
+        return NULL;
+
+    file = (PJ_INITFILE *) pj_malloc(sizeof(PJ_INITFILE));
+    if( file == NULL )
+    {
+        fclose( fid );
+        return NULL;
+    }
+    memset( file, 0, sizeof(PJ_INITFILE) );
+
+    file->name = (char *) pj_malloc(strlen(name)+1);
+    if( file->name == NULL )
+    {
+        fclose( fid );
+        pj_initfile_free( file );
+        return NULL;
+    }
+    strcpy( file->name, name );
+
+#ifdef PJ_MMAP
+    {
+        struct stat st;
+        void        *map;
+
+        if( fstat( fileno(fid), &st ) == 0 && st.st_size > 0 )
+        {
+            map = mmap( NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED,
+                        fileno(fid), 0 );
+            if( map != MAP_FAILED )
+            {
+                file->map = map;
+                file->map_size = (size_t) st.st_size;
+                file->text = (const char *) map;
+                file->end = file->text + file->map_size;
+            }
+        }
+    }
+#endif
+
+/* -------------------------------------------------------------------- */
+/*      Otherwise read the whole file.                                  */
+/* -------------------------------------------------------------------- */
+    if( file->text == NULL )
+    {
+        if( fseek( fid, 0, SEEK_END ) != 0 || (size = ftell( fid )) < 0
+            || fseek( fid, 0, SEEK_SET ) != 0
+            || (text = (char *) pj_malloc(size + 1)) == NULL )
+        {
+            fclose( fid );
+            pj_initfile_free( file );
+            return NULL;
+        }
+
+        file->text = text;
+        file->end = text + fread( text, 1, size, fid );
+    }
+
+    fclose( fid );
+
+    if( !pj_initfile_index( file ) )
+    {
+        pj_initfile_free( file );
+        return NULL;
+    }
+
+    pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+            "pj_initfile_load(%s): indexed %d bytes",
+            name, (int) (file->end - file->text) );
+
+    return file;
+}
+
+/************************************************************************/
+/*                         pj_initfile_lookup()                         */
+/*                                                                      */
+/*      Find the <tag> section of an init file, loading and indexing    */
+/*      the file on first use.  On success *section and *end delimit    */
+/*      the text after the tag; pj_initfile_word() reads it up to the   */
+/*      next word starting with '<'.  The text remains valid until      */
+/*      pj_clear_initcache().                                           */
+/*                                                                      */
+/*      Returns 1 if found, 0 if the file has no such section and -1    */
+/*      if the file could not be opened.                                */
+/************************************************************************/
+
+int pj_initfile_lookup( projCtx ctx, const char *name, const char *tag,
+                        const char **section, const char **end )
+
+{
+    PJ_INITFILE *file;
+    PJ_INITTAG  *found;
+    int         key_len = strlen(tag);
+
+    pj_acquire_lock();
+
+    for( file = initfile_list; file != NULL; file = file->next )
+    {
+        if( strcmp( file->name, name ) == 0 )
+            break;
+    }
+
+    if( file == NULL )
+    {
+        file = pj_initfile_load( ctx, name );
+        if( file == NULL )
+        {
+            pj_release_lock();
+            return -1;
+        }
+        file->next = initfile_list;
+        initfile_list = file;
+    }
+
+    found = pj_initfile_find( file, tag, key_len );
+
+    pj_release_lock();
+
+    errno = 0;
+    if( found->key == NULL )
+        return 0;
+
+    *section = found->section;
+    *end = file->end;
+    return 1;
+}
+
+/************************************************************************/
+/*                        pj_clear_initfiles()                          */
+/*                                                                      */
+/*      Release all init files held in memory.                          */
+/************************************************************************/
+
+void pj_clear_initfiles()
+
+{
+    pj_acquire_lock();
+
+    while( initfile_list != NULL )
+    {
+        PJ_INITFILE *file = initfile_list;
+
+        initfile_list = file->next;
+        pj_initfile_free( file );
+    }
+
+    pj_release_lock();
+}
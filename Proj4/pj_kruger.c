@@ -0,0 +1,453 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Transverse Mercator from Kruger's series in the third
+ *           flattening, to 6th order, as used by etmerc, and UTM for
+ *           arrays of points with the zone picked per point.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** The method is that of Poder and Engsager: geodetic latitude to
+** Gaussian (conformal) latitude, a spherical transverse Mercator, and
+** complex series from the sphere to the ellipsoid.  Coefficients are
+** from Kruger (1912) and Engsager & Poder (2007), to n^6.  The result
+** is good to a few nanometres within 30 degrees of the central
+** meridian and stays usable to about 70 degrees.
+*/
+
+/* largest normalized easting handled, about 70 degrees from the meridian */
+#define MAX_CE 2.623395162778
+
+/************************************************************************/
+/*                               gatg()                                 */
+/*                                                                      */
+/*      B + sum p[j] sin(2(j+1)B), Clenshaw summation.                  */
+/************************************************************************/
+
+static double gatg( const double *p, double B )
+
+{
+    double h = 0.0, h1, h2 = 0.0, cos_2B;
+    int    j = PJ_KRUGER_ORDER - 1;
+
+    cos_2B = 2.0 * cos(2.0 * B);
+    for( h1 = p[j]; j > 0; h2 = h1, h1 = h )
+        h = -h2 + cos_2B * h1 + p[--j];
+
+    return B + h * sin(2.0 * B);
+}
+
+/************************************************************************/
+/*                               clens()                                */
+/*                                                                      */
+/*      sum a[j] sin((j+1)arg).                                         */
+/************************************************************************/
+
+static double clens( const double *a, double arg )
+
+{
+    double r, hr, hr1 = 0.0, hr2;
+    int    j = PJ_KRUGER_ORDER - 1;
+
+    r = 2.0 * cos(arg);
+    for( hr = a[j]; j > 0; )
+    {
+        hr2 = hr1;
+        hr1 = hr;
+        hr = -hr2 + r * hr1 + a[--j];
+    }
+
+    return sin(arg) * hr;
+}
+
+/************************************************************************/
+/*                               clenS()                                */
+/*                                                                      */
+/*      sum a[j] sin((j+1)(arg_r + i arg_i)), real and imaginary        */
+/*      parts, from the sine and cosine of arg_r and the hyperbolic     */
+/*      sine and cosine of arg_i, which the callers have to hand.       */
+/************************************************************************/
+
+static void clenS( const double *a, double sin_arg_r, double cos_arg_r,
+                   double sinh_arg_i, double cosh_arg_i,
+                   double *R, double *I )
+
+{
+    double r, i, hr, hr1, hr2, hi, hi1, hi2;
+    int    j = PJ_KRUGER_ORDER - 1;
+
+    r = 2.0 * cos_arg_r * cosh_arg_i;
+    i = -2.0 * sin_arg_r * sinh_arg_i;
+
+    for( hi1 = hr1 = hi = 0.0, hr = a[j]; j > 0; )
+    {
+        hr2 = hr1;
+        hi2 = hi1;
+        hr1 = hr;
+        hi1 = hi;
+        hr = -hr2 + r * hr1 - i * hi1 + a[--j];
+        hi = -hi2 + i * hr1 + r * hi1;
+    }
+
+    r = sin_arg_r * cosh_arg_i;
+    i = cos_arg_r * sinh_arg_i;
+    *R = r * hr - i * hi;
+    *I = r * hi + i * hr;
+}
+
+/************************************************************************/
+/*                          pj_kruger_init()                            */
+/*                                                                      */
+/*      Coefficients for an ellipsoid of squared eccentricity es,       */
+/*      with scale k0 on the central meridian and origin latitude       */
+/*      phi0.  es = 0 gives the spherical projection.                   */
+/************************************************************************/
+
+void pj_kruger_init( PJ_KRUGER *K, double es, double k0, double phi0 )
+
+{
+    double f, n, np, Z;
+
+    f = 1.0 - sqrt(1.0 - es);
+    np = n = f / (2.0 - f);
+
+/* -------------------------------------------------------------------- */
+/*      Geodetic <-> Gaussian latitude.                                 */
+/* -------------------------------------------------------------------- */
+    K->cgb[0] = n*( 2 + n*(-2/3.0 + n*(-2 + n*(116/45.0 + n*(26/45.0
+                + n*(-2854/675.0))))));
+    K->cbg[0] = n*(-2 + n*( 2/3.0 + n*( 4/3.0 + n*(-82/45.0 + n*(32/45.0
+                + n*( 4642/4725.0))))));
+    np *= n;
+    K->cgb[1] = np*(7/3.0 + n*( -8/5.0 + n*(-227/45.0 + n*(2704/315.0
+                + n*( 2323/945.0)))));
+    K->cbg[1] = np*(5/3.0 + n*(-16/15.0 + n*( -13/9.0 + n*( 904/315.0
+                + n*(-1522/945.0)))));
+    np *= n;
+    K->cgb[2] = np*( 56/15.0 + n*(-136/35.0 + n*(-1262/105.0
+                + n*( 73814/2835.0))));
+    K->cbg[2] = np*(-26/15.0 + n*(  34/21.0 + n*(    8/5.0
+                + n*(-12686/2835.0))));
+    np *= n;
+    K->cgb[3] = np*(4279/630.0 + n*(-332/35.0 + n*(-399572/14175.0)));
+    K->cbg[3] = np*(1237/630.0 + n*( -12/5.0 + n*( -24832/14175.0)));
+    np *= n;
+    K->cgb[4] = np*(4174/315.0 + n*(-144838/6237.0 ));
+    K->cbg[4] = np*(-734/315.0 + n*( 109598/31185.0));
+    np *= n;
+    K->cgb[5] = np*(601676/22275.0 );
+    K->cbg[5] = np*(444337/155925.0);
+
+/* -------------------------------------------------------------------- */
+/*      Normalized meridian quadrant, and the series between the        */
+/*      sphere and the ellipsoid.                                       */
+/* -------------------------------------------------------------------- */
+    np = n * n;
+    K->Qn = k0 / (1 + n) * (1 + np*(1/4.0 + np*(1/64.0 + np/256.0)));
+
+    K->utg[0] = n*(-0.5 + n*( 2/3.0 + n*(-37/96.0 + n*( 1/360.0
+                + n*(  81/512.0 + n*(-96199/604800.0))))));
+    K->gtu[0] = n*( 0.5 + n*(-2/3.0 + n*(  5/16.0 + n*(41/180.0
+                + n*(-127/288.0 + n*(  7891/37800.0 ))))));
+    K->utg[1] = np*(-1/48.0 + n*(-1/15.0 + n*(437/1440.0 + n*(-46/105.0
+                + n*( 1118711/3870720.0)))));
+    K->gtu[1] = np*(13/48.0 + n*(-3/5.0 + n*(557/1440.0 + n*(281/630.0
+                + n*(-1983433/1935360.0)))));
+    np *= n;
+    K->utg[2] = np*(-17/480.0 + n*(  37/840.0 + n*(  209/4480.0
+                + n*( -5569/90720.0 ))));
+    K->gtu[2] = np*( 61/240.0 + n*(-103/140.0 + n*(15061/26880.0
+                + n*(167603/181440.0))));
+    np *= n;
+    K->utg[3] = np*(-4397/161280.0 + n*(  11/504.0 + n*( 830251/7257600.0)));
+    K->gtu[3] = np*(49561/161280.0 + n*(-179/168.0 + n*(6601661/7257600.0)));
+    np *= n;
+    K->utg[4] = np*(-4583/161280.0 + n*(  108847/3991680.0));
+    K->gtu[4] = np*(34729/80640.0 + n*(-3418889/1995840.0));
+    np *= n;
+    K->utg[5] = np*(-20648693/638668800.0);
+    K->gtu[5] = np*(212378941/319334400.0);
+
+    /* northing of the origin, taken off all northings */
+    Z = gatg( K->cbg, phi0 );
+    K->Zb = -K->Qn * (Z + clens( K->gtu, 2.0 * Z ));
+}
+
+/************************************************************************/
+/*                          pj_kruger_fwd()                             */
+/*                                                                      */
+/*      lam, phi (radians, lam from the central meridian) to x, y in    */
+/*      units of the semi-major axis.  Returns 0, or -20 for points     */
+/*      too far from the central meridian.                              */
+/************************************************************************/
+
+int pj_kruger_fwd( const PJ_KRUGER *K, double lam, double phi,
+                   double *x, double *y )
+
+{
+    double Cn, Ce, sin_Cn, cos_Cn, sin_Ce, cos_Ce, dCn, dCe;
+    double u, v, h2, t, sec;
+
+    /* ellipsoid -> Gaussian latitude, then spherical N, E */
+    Cn = gatg( K->cbg, phi );
+    sin_Cn = sin(Cn);
+    cos_Cn = cos(Cn);
+    sin_Ce = sin(lam);
+    cos_Ce = cos(lam);
+
+    /*
+    ** Spherical N is atan2(u, v) and tan(E) is t, so the double angle
+    ** terms clenS() needs follow from them without more calls to libm:
+    ** Ce = asinh(t), sinh(2 Ce) = 2 t sec and cosh(2 Ce) = 1 + 2 t^2.
+    */
+    u = sin_Cn;
+    v = cos_Cn * cos_Ce;
+    h2 = u * u + v * v;
+    Cn = atan2( u, v );
+    t = sin_Ce * cos_Cn / sqrt(h2);
+    sec = sqrt(1.0 + t * t);
+    Ce = t < 0.0 ? -log(sec - t) : log(sec + t);
+
+    /* spherical N, E -> ellipsoidal normalized N, E */
+    clenS( K->gtu, 2.0 * u * v / h2, (v * v - u * u) / h2,
+           2.0 * t * sec, 1.0 + 2.0 * t * t, &dCn, &dCe );
+    Cn += dCn;
+    Ce += dCe;
+
+    if( fabs(Ce) > MAX_CE )
+        return -20;
+
+    *x = K->Qn * Ce;
+    *y = K->Qn * Cn + K->Zb;
+    return 0;
+}
+
+/************************************************************************/
+/*                          pj_kruger_inv()                             */
+/************************************************************************/
+
+int pj_kruger_inv( const PJ_KRUGER *K, double x, double y,
+                   double *lam, double *phi )
+
+{
+    double Cn, Ce, sin_Cn, cos_Cn, sinh_Ce, ex, dCn, dCe;
+
+    Cn = (y - K->Zb) / K->Qn;
+    Ce = x / K->Qn;
+    if( fabs(Ce) > MAX_CE )
+        return -20;
+
+    /* ellipsoidal normalized N, E -> spherical N, E */
+    ex = exp(2.0 * Ce);
+    clenS( K->utg, sin(2.0 * Cn), cos(2.0 * Cn),
+           0.5 * (ex - 1.0 / ex), 0.5 * (ex + 1.0 / ex), &dCn, &dCe );
+    Cn += dCn;
+    Ce += dCe;
+
+    /*
+    ** Spherical E is atan(sinh(Ce)), whose sine and cosine are
+    ** sinh/cosh and 1/cosh; the cosh cancels out of both atan2()s.
+    */
+    ex = exp(Ce);
+    sinh_Ce = 0.5 * (ex - 1.0 / ex);
+    sin_Cn = sin(Cn);
+    cos_Cn = cos(Cn);
+
+    /* spherical N, E -> Gaussian latitude, longitude */
+    Ce = atan2( sinh_Ce, cos_Cn );
+    Cn = atan2( sin_Cn, hypot(sinh_Ce, cos_Cn) );
+
+    *phi = gatg( K->cgb, Cn );
+    *lam = Ce;
+    return 0;
+}
+
+/************************************************************************/
+/*                            pj_utm_zone()                             */
+/*                                                                      */
+/*      UTM zone (1-60) for a longitude and latitude in degrees,        */
+/*      with the exceptions for Norway and Svalbard.                    */
+/************************************************************************/
+
+static int pj_utm_zone( double lon, double lat )
+
+{
+    int zone = (int) floor((lon + 180.0) / 6.0) + 1;
+
+    if( zone > 60 )
+        zone = 60;
+    if( zone < 1 )
+        zone = 1;
+
+    if( lat >= 56.0 && lat < 64.0 && lon >= 3.0 && lon < 12.0 )
+        zone = 32;
+
+    if( lat >= 72.0 && lat < 84.0 )
+    {
+        if( lon >= 0.0 && lon < 9.0 )
+            zone = 31;
+        else if( lon >= 9.0 && lon < 21.0 )
+            zone = 33;
+        else if( lon >= 21.0 && lon < 33.0 )
+            zone = 35;
+        else if( lon >= 33.0 && lon < 42.0 )
+            zone = 37;
+    }
+
+    return zone;
+}
+
+/************************************************************************/
+/*                            pj_utm_fwd()                              */
+/*                                                                      */
+/*      Project longitude/latitude points (radians) to UTM on the       */
+/*      ellipsoid of defn, in metres, in place.  zone[i] gives the      */
+/*      zone of each point, negative for the southern hemisphere;       */
+/*      where it is 0, or zone is NULL, the zone is picked from the     */
+/*      point (with the Norway and Svalbard exceptions) and written     */
+/*      back; a zone beyond +/-60 fails with -35.  Points that fail     */
+/*      are set to HUGE_VAL and the first error is returned,            */
+/*      otherwise 0.                                                    */
+/************************************************************************/
+
+int pj_utm_fwd( PJ *defn, long point_count, int point_offset,
+                double *x, double *y, int *zone )
+
+{
+    PJ_KRUGER K;
+    long      i, io;
+    int       err = 0;
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    pj_kruger_init( &K, defn->es, 0.9996, 0.0 );
+
+    for( i = io = 0; i < point_count; i++, io += point_offset )
+    {
+        double lam = x[io], phi = y[io], lam0;
+        int    z = zone != NULL ? zone[i] : 0;
+        int    point_err;
+
+        if( lam == HUGE_VAL )
+            continue;
+
+        if( fabs(phi) > HALFPI )
+            point_err = -14;
+        else if( z < -60 || z > 60 )
+            point_err = -35;
+        else
+        {
+            lam = adjlon( lam );
+            if( z == 0 )
+            {
+                z = pj_utm_zone( lam * RAD_TO_DEG, phi * RAD_TO_DEG );
+                if( phi < 0.0 )
+                    z = -z;
+                if( zone != NULL )
+                    zone[i] = z;
+            }
+
+            lam0 = ((z < 0 ? -z : z) - 0.5) * (PI / 30.0) - PI;
+            point_err = pj_kruger_fwd( &K, adjlon( lam - lam0 ), phi,
+                                       x + io, y + io );
+        }
+
+        if( point_err != 0 )
+        {
+            x[io] = y[io] = HUGE_VAL;
+            if( err == 0 )
+                err = point_err;
+            continue;
+        }
+
+        x[io] = defn->a * x[io] + 500000.0;
+        y[io] = defn->a * y[io] + (z < 0 ? 10000000.0 : 0.0);
+    }
+
+    if( err != 0 )
+        pj_ctx_set_errno( defn->ctx, err );
+
+    return err;
+}
+
+/************************************************************************/
+/*                            pj_utm_inv()                              */
+/*                                                                      */
+/*      UTM eastings and northings in metres back to longitude and      */
+/*      latitude in radians, in place, each in its own zone as          */
+/*      given by pj_utm_fwd().                                          */
+/************************************************************************/
+
+int pj_utm_inv( PJ *defn, long point_count, int point_offset,
+                double *x, double *y, const int *zone )
+
+{
+    PJ_KRUGER K;
+    long      i, io;
+    int       err = 0;
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    pj_kruger_init( &K, defn->es, 0.9996, 0.0 );
+
+    for( i = io = 0; i < point_count; i++, io += point_offset )
+    {
+        double east = x[io], north = y[io], lam;
+        int    z = zone[i], point_err;
+
+        if( east == HUGE_VAL )
+            continue;
+
+        if( z == 0 || z < -60 || z > 60 )
+            point_err = -35;
+        else
+        {
+            east = (east - 500000.0) / defn->a;
+            north = (north - (z < 0 ? 10000000.0 : 0.0)) / defn->a;
+            point_err = pj_kruger_inv( &K, east, north, &lam, y + io );
+        }
+
+        if( point_err != 0 )
+        {
+            x[io] = y[io] = HUGE_VAL;
+            if( err == 0 )
+                err = point_err;
+            continue;
+        }
+
+        x[io] = adjlon( lam + ((z < 0 ? -z : z) - 0.5) * (PI / 30.0) - PI );
+    }
+
+    if( err != 0 )
+        pj_ctx_set_errno( defn->ctx, err );
+
+    return err;
+}
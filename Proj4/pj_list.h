@@ -31,6 +31,7 @@ PROJ_HEAD(eck5, "Eckert V")
 PROJ_HEAD(eck6, "Eckert VI")
 PROJ_HEAD(eqc, "Equidistant Cylindrical (Plate Caree)")
 PROJ_HEAD(eqdc, "Equidistant Conic")
+PROJ_HEAD(etmerc, "Extended Transverse Mercator")
 PROJ_HEAD(euler, "Euler")
 PROJ_HEAD(fahey, "Fahey")
 PROJ_HEAD(fouc, "Foucaut")
@@ -0,0 +1,365 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Split large pj_transform() requests across worker threads
+ *           when the context asks for it (pj_ctx_set_thread_count()).
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Worker threads use the same threading as pj_mutex.c.  With the stub
+** mutex there is nothing protecting the shared grid list, so jobs are
+** always run in the calling thread.
+*/
+#ifdef _WIN32
+#  define MUTEX_win32
+#endif
+
+#if !defined(MUTEX_stub) && !defined(MUTEX_pthread) && !defined(MUTEX_win32)
+#  define MUTEX_stub
+#endif
+
+#ifdef MUTEX_pthread
+#  include <pthread.h>
+#endif
+#ifdef MUTEX_win32
+#  include <windows.h>
+#endif
+
+#define MAX_THREADS 64
+
+typedef struct {
+    PJ_PLAN     plan;           /* plan on this worker's own definitions */
+    projCtx     ctx;
+    long        point_count;
+    int         point_offset;
+    double      *x, *y, *z;
+    int         *status;
+    int         err;
+} PJ_WORKER;
+
+/* a job handed to a thread by pj_run_jobs() */
+typedef struct {
+    void        (*fn)(void *);
+    void        *job;
+#ifdef MUTEX_pthread
+    pthread_t   thread;
+#endif
+#ifdef MUTEX_win32
+    HANDLE      thread;
+#endif
+    int         started;
+} PJ_THREAD;
+
+/************************************************************************/
+/*                          pj_thread_main()                            */
+/************************************************************************/
+
+#if !defined(MUTEX_stub)
+#ifdef MUTEX_win32
+static DWORD WINAPI pj_thread_main( LPVOID arg )
+#else
+static void *pj_thread_main( void *arg )
+#endif
+
+{
+    PJ_THREAD *t = (PJ_THREAD *) arg;
+
+    t->fn( t->job );
+    return 0;
+}
+#endif /* ndef MUTEX_stub */
+
+/************************************************************************/
+/*                           pj_job_count()                             */
+/*                                                                      */
+/*      How many jobs to split work_count units of work (points,        */
+/*      pairs, blocks ...) into: the thread count of ctx, but no more   */
+/*      than MAX_THREADS and one per min_work units.  1 means do it     */
+/*      all in the calling thread.                                      */
+/************************************************************************/
+
+int pj_job_count( projCtx ctx, double work_count, double min_work )
+
+{
+#ifdef MUTEX_stub
+    return 1;
+#else
+    int job_count = ctx->thread_count;
+
+    if( job_count > MAX_THREADS )
+        job_count = MAX_THREADS;
+    if( job_count > work_count / min_work )
+        job_count = (int) (work_count / min_work);
+
+    return job_count < 2 ? 1 : job_count;
+#endif
+}
+
+/************************************************************************/
+/*                           pj_run_jobs()                              */
+/*                                                                      */
+/*      Call fn on each of job_count jobs, laid out job_size bytes      */
+/*      apart from jobs, and return once all are done.  Each job but    */
+/*      the first gets a thread of its own; the calling thread runs     */
+/*      the first, and any job whose thread cannot be started.  The     */
+/*      jobs must not share anything but read only data and what the    */
+/*      PROJ.4 lock protects.                                           */
+/************************************************************************/
+
+void pj_run_jobs( projCtx ctx, int job_count, void (*fn)(void *),
+                  void *jobs, size_t job_size )
+
+{
+    PJ_THREAD   threads[MAX_THREADS];
+    int         i;
+
+    memset( threads, 0, sizeof(threads) );
+
+#if !defined(MUTEX_stub)
+    for( i = 1; i < job_count && i < MAX_THREADS; i++ )
+    {
+        PJ_THREAD *t = threads + i;
+
+        t->fn = fn;
+        t->job = (char *) jobs + i * job_size;
+#ifdef MUTEX_pthread
+        t->started = 
+            pthread_create( &(t->thread), NULL, pj_thread_main, t ) == 0;
+#endif
+#ifdef MUTEX_win32
+        t->thread = CreateThread( NULL, 0, pj_thread_main, t, 0, NULL );
+        t->started = t->thread != NULL;
+#endif
+        if( !t->started )
+            pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                    "pj_run_jobs(): thread %d not started, running its "
+                    "job in the calling thread.", i );
+    }
+#endif /* ndef MUTEX_stub */
+
+    for( i = 0; i < job_count; i++ )
+    {
+        if( i >= MAX_THREADS || !threads[i].started )
+            fn( (char *) jobs + i * job_size );
+    }
+
+#if !defined(MUTEX_stub)
+    for( i = 1; i < job_count && i < MAX_THREADS; i++ )
+    {
+        if( !threads[i].started )
+            continue;
+#ifdef MUTEX_pthread
+        pthread_join( threads[i].thread, NULL );
+#endif
+#ifdef MUTEX_win32
+        WaitForSingleObject( threads[i].thread, INFINITE );
+        CloseHandle( threads[i].thread );
+#endif
+    }
+#endif /* ndef MUTEX_stub */
+}
+
+/************************************************************************/
+/*                          pj_clone_defn()                             */
+/*                                                                      */
+/*      Build an independent copy of a definition on another context,  */
+/*      from its (already expanded) parameter list.  Workers need       */
+/*      their own PJ since errors are reported through PJ->ctx.         */
+/************************************************************************/
+
+PJ *pj_clone_defn( projCtx ctx, PJ *defn )
+
+{
+    paralist    *p;
+    char        **argv;
+    int         argc = 0;
+    PJ          *clone;
+
+    for( p = defn->params; p != NULL; p = p->next )
+        argc++;
+
+    argv = (char **) pj_malloc(sizeof(char *) * (argc + 1));
+    if( argv == NULL )
+        return NULL;
+
+    argc = 0;
+    for( p = pj_param_next( defn->params, NULL ); p != NULL;
+         p = pj_param_next( defn->params, p ) )
+    {
+        /* the +init= contents are already in the list */
+        if( strncmp( p->param, "init=", 5 ) != 0 )
+            argv[argc++] = p->param;
+    }
+
+    clone = pj_init_ctx( ctx, argc, argv );
+    pj_dalloc( argv );
+
+    return clone;
+}
+
+/************************************************************************/
+/*                         pj_worker_main()                             */
+/************************************************************************/
+
+static void pj_worker_main( void *arg )
+
+{
+    PJ_WORKER *w = (PJ_WORKER *) arg;
+
+    w->err = pj_plan_run( &(w->plan), w->point_count, w->point_offset,
+                          w->x, w->y, w->z, w->status );
+}
+
+/************************************************************************/
+/*                       pj_plan_run_parallel()                         */
+/*                                                                      */
+/*      Split the request into one contiguous range of points per       */
+/*      thread, the calling thread taking the first.  Each range is     */
+/*      run with pj_plan_run() on private copies of the definitions,    */
+/*      so the only shared state is the grid list, which is loaded      */
+/*      under the PROJ.4 lock.                                          */
+/*                                                                      */
+/*      Errors are merged as if the points had been done in order:      */
+/*      the first range to hit a non-transient error decides the        */
+/*      return value.  Returns 1 and leaves *err_out untouched if the   */
+/*      workers could not be set up, in which case the caller should    */
+/*      run the request itself.                                         */
+/************************************************************************/
+
+int pj_plan_run_parallel( PJ_PLAN *plan, long point_count, int point_offset,
+                          double *x, double *y, double *z, int *status,
+                          int *err_out )
+
+{
+    PJ_WORKER   *workers;
+    int         thread_count;
+    int         i, err = 0, last_errno = 0, failed = 0;
+    long        start = 0, chunk;
+
+    thread_count = pj_job_count( plan->srcdefn->ctx, (double) point_count,
+                                 PJ_PARALLEL_MIN_POINTS );
+    if( thread_count < 2 )
+        return 1;
+
+    workers = (PJ_WORKER *) pj_malloc(sizeof(PJ_WORKER) * thread_count);
+    if( workers == NULL )
+        return 1;
+    memset( workers, 0, sizeof(PJ_WORKER) * thread_count );
+
+/* -------------------------------------------------------------------- */
+/*      Give each worker a context and definitions of its own.          */
+/* -------------------------------------------------------------------- */
+    /* whole blocks, so the points are grouped exactly as in one thread */
+    chunk = (point_count + thread_count - 1) / thread_count;
+    chunk = (chunk + PJ_TRANSFORM_BLOCK - 1) 
+        / PJ_TRANSFORM_BLOCK * PJ_TRANSFORM_BLOCK;
+
+    for( i = 0; i < thread_count && !failed; i++ )
+    {
+        PJ_WORKER *w = workers + i;
+
+        if( start >= point_count )
+        {
+            thread_count = i;
+            break;
+        }
+
+        w->ctx = pj_ctx_alloc();
+        if( w->ctx == NULL )
+        {
+            failed = 1;
+            break;
+        }
+        w->ctx->debug_level = plan->srcdefn->ctx->debug_level;
+        w->ctx->logger = plan->srcdefn->ctx->logger;
+        w->ctx->app_data = plan->srcdefn->ctx->app_data;
+        w->ctx->thread_count = 0;
+
+        w->plan = *plan;
+        w->plan.srcdefn = pj_clone_defn( w->ctx, plan->srcdefn );
+        w->plan.dstdefn = pj_clone_defn( w->ctx, plan->dstdefn );
+        if( w->plan.srcdefn == NULL || w->plan.dstdefn == NULL )
+            failed = 1;
+
+        w->point_count = MIN(chunk, point_count - start);
+        w->point_offset = point_offset;
+        w->x = x + start * point_offset;
+        w->y = y + start * point_offset;
+        w->z = z != NULL ? z + start * point_offset : NULL;
+        w->status = status != NULL ? status + start : NULL;
+        start += w->point_count;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Run the workers, the first range in this thread.                */
+/* -------------------------------------------------------------------- */
+    if( !failed )
+        pj_run_jobs( plan->srcdefn->ctx, thread_count, pj_worker_main,
+                     workers, sizeof(PJ_WORKER) );
+
+/* -------------------------------------------------------------------- */
+/*      Merge the results and clean up.                                 */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < thread_count; i++ )
+    {
+        PJ_WORKER *w = workers + i;
+
+        if( !failed && err == 0 )
+        {
+            err = w->err;
+            if( w->ctx->last_errno != 0 )
+                last_errno = w->ctx->last_errno;
+        }
+
+        if( w->plan.srcdefn != NULL )
+            pj_free( w->plan.srcdefn );
+        if( w->plan.dstdefn != NULL )
+            pj_free( w->plan.dstdefn );
+        if( w->ctx != NULL )
+            pj_ctx_free( w->ctx );
+    }
+    pj_dalloc( workers );
+
+    if( failed )
+        return 1;
+
+    if( err != 0 )
+        last_errno = err;
+    plan->srcdefn->ctx->last_errno = 0;
+    plan->dstdefn->ctx->last_errno = 0;
+    if( last_errno != 0 )
+    {
+        pj_ctx_set_errno( plan->srcdefn->ctx, last_errno );
+        pj_ctx_set_errno( plan->dstdefn->ctx, last_errno );
+    }
+
+    *err_out = err;
+    return 0;
+}
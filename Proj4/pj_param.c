@@ -2,12 +2,25 @@
 #include <projects.h>
 #include <stdio.h>
 #include <string.h>
+
+/*
+** A parameter list holds the pj_init() arguments, then the +init=
+** entries, then the entries added afterwards (defaults, datum and
+** ellipsoid expansions) flagged PJ_PARAM_APPENDED.  +init= entries
+** found in the init cache are shared by every definition using them:
+** they are linked in last, after the appended entries, are never
+** changed, and have their used bits kept in shared_used of the list
+** head.  pj_param() and pj_param_next() see the entries in the order
+** above either way.
+*/
+
 	paralist * /* create parameter list entry */
 pj_mkparam(char *str) {
 	paralist *newitem;
 
 	if ((newitem = (paralist *)pj_malloc(sizeof(paralist) + strlen(str)))) {
 		newitem->used = 0;
+		newitem->shared_used = 0;
 		newitem->next = 0;
 		if (*str == '+')
 			++str;
@@ -15,6 +28,49 @@ pj_mkparam(char *str) {
 	}
 	return newitem;
 }
+	paralist * /* create entry after curr, one of our own, with flags */
+pj_param_add(paralist *curr, char *str, int flags) {
+	paralist *newitem;
+
+	if ((newitem = pj_mkparam(str))) {
+		newitem->used = (char) flags;
+		newitem->next = curr->next;
+		curr->next = newitem;
+	}
+	return newitem;
+}
+	paralist * /* last of our own entries, ahead of any shared ones */
+pj_param_tail(paralist *pl) {
+	while (pl->next && !(pl->next->used & PJ_PARAM_SHARED))
+		pl = pl->next;
+	return pl;
+}
+	paralist * /* entry after pl in lookup order, the first if pl is NULL */
+pj_param_next(paralist *head, paralist *pl) {
+	int late = pl && (pl->used & PJ_PARAM_APPENDED);
+
+	for (pl = pl ? pl->next : head; ; pl = pl->next) {
+		if (!pl) {
+			if (late++ || !head)
+				return 0;
+			pl = head;
+		}
+		if (!(pl->used & PJ_PARAM_APPENDED) == !late)
+			return pl;
+	}
+}
+	int /* has pj_param() read entry pl of the list starting at head? */
+pj_param_used(paralist *head, paralist *pl) {
+	paralist *t;
+	int shared = 0;
+
+	if (!(pl->used & PJ_PARAM_SHARED))
+		return pl->used & 1;
+	for (t = head; t != pl; t = t->next)
+		if (t->used & PJ_PARAM_SHARED)
+			++shared;
+	return (int) (head->shared_used >> shared) & 1;
+}
 
 /************************************************************************/
 /*                              pj_param()                              */
@@ -34,21 +90,36 @@ pj_mkparam(char *str) {
 /************************************************************************/
 
 	PVALUE /* test for presence or get parameter value */
-pj_param(paralist *pl, char *opt) {
-	int type;
+pj_param(projCtx ctx, paralist *pl, const char *opt) {
+	int type, shared = 0;
 	unsigned l;
 	PVALUE value;
+	paralist *head = pl, *late = 0;
 
 	type = *opt++;
-	/* simple linear lookup */
+	/* simple linear lookup, most entries differ in the first letter;
+	   appended entries only count when no other one matches */
 	l = strlen(opt);
-	while (pl && !(!strncmp(pl->param, opt, l) &&
-	  (!pl->param[l] || pl->param[l] == '=')))
-		pl = pl->next;
+	for ( ; pl; pl = pl->next) {
+		if (*pl->param == *opt && !strncmp(pl->param, opt, l) &&
+		  (!pl->param[l] || pl->param[l] == '=')) {
+			if (!(pl->used & PJ_PARAM_APPENDED))
+				break;
+			if (!late)
+				late = pl;
+		}
+		if (pl->used & PJ_PARAM_SHARED)
+			++shared;
+	}
+	if (!pl)
+		pl = late;
 	if (type == 't')
 		value.i = pl != 0;
 	else if (pl) {
-		pl->used |= 1;
+		if (pl->used & PJ_PARAM_SHARED)
+			head->shared_used |= 1UL << shared;
+		else
+			pl->used |= 1;
 		opt = pl->param + l;
 		if (*opt == '=')
 			++opt;
@@ -57,13 +128,13 @@ pj_param(paralist *pl, char *opt) {
 			value.i = atoi(opt);
 			break;
 		case 'd':	/* simple real input */
-			value.f = atof(opt);
+			value.f = pj_atof(opt);
 			break;
 		case 'r':	/* degrees input */
-			value.f = dmstor(opt, 0);
+			value.f = dmstor_ctx(ctx, opt, 0);
 			break;
 		case 's':	/* char string */
-			value.s = opt;
+			value.s = (char *) opt;
 			break;
 		case 'b':	/* boolean */
 			switch (*opt) {
@@ -74,7 +145,7 @@ pj_param(paralist *pl, char *opt) {
 				value.i = 1;
 				break;
 			default:
-				pj_errno = -8;
+				pj_ctx_set_errno( ctx, -8 );
 				value.i = 0;
 				break;
 			}
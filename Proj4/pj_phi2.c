@@ -4,9 +4,45 @@
 #define HALFPI		1.5707963267948966
 #define TOL 1.0e-10
 #define N_ITER 15
+#define N_MAX 0.005	/* largest third flattening for the series */
 
-	double
-pj_phi2(double ts, double e) {
+	static int /* series for phi - chi in sin(2j chi), chi conformal lat */
+phi2_coefs(double e, double *d) {
+	double b, n, n2;
+
+	b = sqrt(1. - e * e);
+	n = (1. - b) / (1. + b);
+	if (n > N_MAX)
+		return 0;
+	n2 = n * n;
+	/* to n^6, Karney, J. Geodesy 85 (2011) */
+	d[0] = n * (2. + n * (-2./3. + n * (-2. + n * (116./45. + n * (26./45.
+		+ n * (-2854./675.))))));
+	d[1] = n2 * (7./3. + n * (-8./5. + n * (-227./45. + n * (2704./315.
+		+ n * (2323./945.)))));
+	d[2] = n2 * n * (56./15. + n * (-136./35. + n * (-1262./105.
+		+ n * (73814./2835.))));
+	d[3] = n2 * n2 * (4279./630. + n * (-332./35. + n * (-399572./14175.)));
+	d[4] = n2 * n2 * n * (4174./315. + n * (-144838./6237.));
+	d[5] = n2 * n2 * n2 * (601676./22275.);
+	return 1;
+}
+	static double /* phi from the series, Clenshaw summation */
+phi2_series(double ts, const double *d) {
+	double chi, x, u0 = 0., u1 = 0., t;
+	int j;
+
+	chi = HALFPI - 2. * atan (ts);
+	x = 2. * cos(2. * chi);
+	for (j = 5; j >= 0; --j) {
+		t = x * u0 - u1 + d[j];
+		u1 = u0;
+		u0 = t;
+	}
+	return chi + u0 * sin(2. * chi);
+}
+	static double /* phi by iteration, for very eccentric ellipsoids */
+phi2_iterate(projCtx ctx, double ts, double e) {
 	double eccnth, Phi, con, dphi;
 	int i;
 
@@ -20,6 +56,29 @@ pj_phi2(double ts, double e) {
 		Phi += dphi;
 	} while ( fabs(dphi) > TOL && --i);
 	if (i <= 0)
-		pj_errno = -18;
+		pj_ctx_set_errno( ctx, -18 );
 	return Phi;
+}
+	double
+pj_phi2(projCtx ctx, double ts, double e) {
+	double d[6];
+
+	if (phi2_coefs(e, d))
+		return phi2_series(ts, d);
+	return phi2_iterate(ctx, ts, e);
+}
+	void /* pj_phi2 of y[] in place, where x[] is not HUGE_VAL */
+pj_phi2_array(projCtx ctx, double e, long n, int offset, double *x, double *y) {
+	double d[6];
+	long i, io;
+
+	if (phi2_coefs(e, d)) {
+		for (i = io = 0; i < n; ++i, io += offset)
+			if (x[io] != HUGE_VAL)
+				y[io] = phi2_series(y[io], d);
+	} else {
+		for (i = io = 0; i < n; ++i, io += offset)
+			if (x[io] != HUGE_VAL)
+				y[io] = phi2_iterate(ctx, y[io], e);
+	}
 }
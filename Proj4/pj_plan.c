@@ -0,0 +1,253 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Precomputed transformation plans for a (source, destination)
+ *           pair, skipping the pj_transform() stages that cannot change
+ *           the coordinates.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Parameters whose effect is fully captured by fields of the PJ that
+** pj_plan_same_defn() compares numerically.  Everything else is
+** compared as text.
+*/
+static const char * const numeric_params[] = {
+    "init", "no_defs",
+    "ellps", "a", "b", "rf", "f", "es", "e", "R",
+    "R_A", "R_V", "R_a", "R_g", "R_h", "R_lat_a", "R_lat_g",
+    "datum", "towgs84", "nadgrids", "pm",
+    "lon_0", "lat_0", "k", "k_0", "x_0", "y_0", "to_meter", "units",
+    "over", "geoc", "lon_wrap",
+    NULL };
+
+/************************************************************************/
+/*                          pj_plan_init()                              */
+/*                                                                      */
+/*      Fill in the plan pj_transform() has always followed: every      */
+/*      stage that applies to the two definitions.  The datum shift     */
+/*      is left out in the cases where pj_datum_transform() would do    */
+/*      nothing anyway.                                                 */
+/************************************************************************/
+
+void pj_plan_init( PJ_PLAN *plan, PJ *srcdefn, PJ *dstdefn )
+
+{
+    int stages = 0;
+
+    if( srcdefn->datum_type != PJD_UNKNOWN
+        && dstdefn->datum_type != PJD_UNKNOWN
+        && !pj_compare_datums( srcdefn, dstdefn ) )
+        stages |= PJ_STAGE_DATUM;
+
+    if( srcdefn->is_geocent )
+        stages |= PJ_STAGE_SRC_GEOCENT;
+    else if( !srcdefn->is_latlong )
+        stages |= PJ_STAGE_SRC_INV;
+
+    if( srcdefn->from_greenwich != 0.0 )
+        stages |= PJ_STAGE_SRC_PM;
+
+    if( dstdefn->from_greenwich != 0.0 )
+        stages |= PJ_STAGE_DST_PM;
+
+    if( dstdefn->is_geocent )
+        stages |= PJ_STAGE_DST_GEOCENT;
+    else if( !dstdefn->is_latlong )
+        stages |= PJ_STAGE_DST_FWD;
+    else if( dstdefn->long_wrap_center != 0 )
+        stages |= PJ_STAGE_DST_WRAP;
+
+    plan->srcdefn = srcdefn;
+    plan->dstdefn = dstdefn;
+    plan->stages = stages;
+    plan->x_scale = plan->y_scale = 1.0;
+    plan->x_offset = plan->y_offset = 0.0;
+}
+
+/************************************************************************/
+/*                        pj_plan_params_in()                           */
+/*                                                                      */
+/*      Is every textual parameter of a also given, with the same       */
+/*      value, in b?  Only the first occurrence of a key counts, as     */
+/*      with pj_param().                                                */
+/************************************************************************/
+
+static int pj_plan_params_in( paralist *a, paralist *b )
+
+{
+    paralist *p, *q;
+
+    for( p = pj_param_next( a, NULL ); p != NULL; p = pj_param_next( a, p ) )
+    {
+        size_t key_len = strcspn( p->param, "=" );
+        int    i, skip = 0;
+
+        for( i = 0; numeric_params[i] != NULL && !skip; i++ )
+            skip = strlen(numeric_params[i]) == key_len
+                && strncmp( numeric_params[i], p->param, key_len ) == 0;
+
+        for( q = pj_param_next( a, NULL ); q != p && !skip;
+             q = pj_param_next( a, q ) )
+            skip = strncmp( q->param, p->param, key_len ) == 0
+                && (q->param[key_len] == '=' || q->param[key_len] == '\0');
+
+        if( skip )
+            continue;
+
+        for( q = pj_param_next( b, NULL ); q != NULL;
+             q = pj_param_next( b, q ) )
+        {
+            if( strncmp( q->param, p->param, key_len ) == 0
+                && (q->param[key_len] == '=' || q->param[key_len] == '\0') )
+                break;
+        }
+
+        if( q == NULL || strcmp( q->param, p->param ) != 0 )
+            return 0;
+    }
+
+    return 1;
+}
+
+/************************************************************************/
+/*                         pj_plan_same_defn()                          */
+/*                                                                      */
+/*      Do the two definitions describe the same coordinate system,     */
+/*      apart perhaps from their false origin, units and (for lat/long) */
+/*      prime meridian?                                                 */
+/************************************************************************/
+
+static int pj_plan_same_defn( PJ *a, PJ *b )
+
+{
+    if( a->fwd != b->fwd || a->inv != b->inv
+        || a->is_latlong != b->is_latlong || a->is_geocent != b->is_geocent
+        || a->over != b->over || a->geoc != b->geoc
+        || a->a != b->a || a->es != b->es
+        || a->lam0 != b->lam0 || a->phi0 != b->phi0 || a->k0 != b->k0
+        || a->long_wrap_center != b->long_wrap_center )
+        return 0;
+
+    if( !a->is_latlong && a->from_greenwich != b->from_greenwich )
+        return 0;
+
+    return pj_plan_params_in( a->params, b->params )
+        && pj_plan_params_in( b->params, a->params );
+}
+
+/************************************************************************/
+/*                          pj_plan_create()                            */
+/*                                                                      */
+/*      Work out once which stages a src -> dst transformation really   */
+/*      needs.  If no datum shift is needed and the two                 */
+/*      definitions only differ in false origin, units or lat/long      */
+/*      prime meridian, the projection stages collapse to one affine    */
+/*      step, or to nothing at all for an identical pair.               */
+/************************************************************************/
+
+PJ_PLAN *pj_plan_create( PJ *srcdefn, PJ *dstdefn )
+
+{
+    PJ_PLAN *plan;
+
+    plan = (PJ_PLAN *) pj_malloc(sizeof(PJ_PLAN));
+    if( plan == NULL )
+    {
+        pj_ctx_set_errno( srcdefn->ctx, -2 );
+        return NULL;
+    }
+
+    pj_plan_init( plan, srcdefn, dstdefn );
+
+    if( (plan->stages & PJ_STAGE_DATUM)
+        || !pj_plan_same_defn( srcdefn, dstdefn ) )
+        return plan;
+
+    plan->stages &= PJ_STAGE_DST_WRAP;
+
+    if( srcdefn->is_latlong )
+    {
+        plan->x_offset = srcdefn->from_greenwich - dstdefn->from_greenwich;
+    }
+    else if( !srcdefn->is_geocent )
+    {
+        plan->x_scale = plan->y_scale =
+            dstdefn->fr_meter * srcdefn->to_meter;
+        plan->x_offset = dstdefn->fr_meter * (dstdefn->x0 - srcdefn->x0);
+        plan->y_offset = dstdefn->fr_meter * (dstdefn->y0 - srcdefn->y0);
+    }
+    else if( srcdefn->to_meter != dstdefn->to_meter )
+    {
+        /* geocentric in other units: z needs scaling too, keep it simple */
+        pj_plan_init( plan, srcdefn, dstdefn );
+        return plan;
+    }
+
+    if( plan->x_scale != 1.0 || plan->y_scale != 1.0
+        || plan->x_offset != 0.0 || plan->y_offset != 0.0 )
+        plan->stages |= PJ_STAGE_AFFINE;
+
+    return plan;
+}
+
+/************************************************************************/
+/*                        pj_plan_transform()                           */
+/************************************************************************/
+
+int pj_plan_transform( PJ_PLAN *plan, long point_count, int point_offset,
+                       double *x, double *y, double *z )
+
+{
+    return pj_plan_run( plan, point_count, point_offset, x, y, z, NULL );
+}
+
+/************************************************************************/
+/*                       pj_plan_is_identity()                          */
+/************************************************************************/
+
+int pj_plan_is_identity( PJ_PLAN *plan )
+
+{
+    return plan->stages == 0;
+}
+
+/************************************************************************/
+/*                           pj_plan_free()                             */
+/*                                                                      */
+/*      The plan does not own the definitions it was created from;      */
+/*      they must outlive it.                                           */
+/************************************************************************/
+
+void pj_plan_free( PJ_PLAN *plan )
+
+{
+    if( plan != NULL )
+        pj_dalloc( plan );
+}
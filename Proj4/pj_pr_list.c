@@ -9,8 +9,9 @@ pr_list(PJ *P, int not_used) {
 	int l, n = 1, flag = 0;
 
 	(void)putchar('#');
-	for (t = P->params; t; t = t->next)
-		if ((!not_used && t->used) || (not_used && !t->used)) {
+	for (t = pj_param_next(P->params, 0); t;
+	     t = pj_param_next(P->params, t))
+		if (pj_param_used(P->params, t) != not_used) {
 			l = strlen(t->param) + 1;
 			if (n + l > LINE_LEN) {
 				(void)fputs("\n#", stdout);
@@ -63,10 +64,11 @@ char *pj_get_def( PJ *P, int options )
     definition = (char *) pj_malloc(def_max);
     definition[0] = '\0';
 
-    for (t = P->params; t; t = t->next)
+    for (t = pj_param_next(P->params, NULL); t;
+         t = pj_param_next(P->params, t))
     {
         /* skip unused parameters ... mostly appended defaults and stuff */
-        if (!t->used)
+        if (!pj_param_used(P->params, t))
             continue;
 
         /* grow the resulting string if needed */
@@ -0,0 +1,222 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Hashed lookup by id in the built in tables of projections,
+ *           ellipsoids, units, datums and prime meridians.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Each table gets an open addressing hash of its ids the first time it
+** is searched.  The tables are fixed, so the hash never changes once
+** built, and is read without the lock.  pj_list may be replaced by an
+** application (PJ_LIST_H), so a table too big for the hash is searched
+** linearly instead.
+*/
+#define REGISTRY_SLOTS 512
+
+typedef struct {
+    volatile int ready;         /* 1 hashed, -1 too big */
+    short        slot[REGISTRY_SLOTS];  /* entry number + 1, 0 if empty */
+} PJ_REGISTRY;
+
+static PJ_REGISTRY list_registry, ellps_registry, units_registry;
+static PJ_REGISTRY datums_registry, pm_registry;
+
+/* all the tables start their entries with the id */
+#define ENTRY_ID(table, stride, i) \
+    (*(char * const *) ((const char *) (table) + (size_t) (i) * (stride)))
+
+/************************************************************************/
+/*                          pj_registry_hash()                          */
+/************************************************************************/
+
+static unsigned pj_registry_hash( const char *id )
+
+{
+    unsigned hash = 2166136261U;
+
+    for( ; *id != '\0'; id++ )
+        hash = (hash ^ (unsigned char) *id) * 16777619U;
+
+    return hash;
+}
+
+/************************************************************************/
+/*                          pj_registry_build()                         */
+/*                                                                      */
+/*      Hash the ids of a NULL id terminated table.  The first entry    */
+/*      with a given id wins, as with a linear search.                  */
+/************************************************************************/
+
+static void pj_registry_build( PJ_REGISTRY *reg, const void *table,
+                               size_t stride )
+
+{
+    int count, i;
+
+    pj_acquire_lock();
+
+    if( reg->ready != 0 )
+    {
+        pj_release_lock();
+        return;
+    }
+
+    for( count = 0; ENTRY_ID(table, stride, count) != NULL; count++ ) {}
+
+    if( 2 * count > REGISTRY_SLOTS )
+    {
+        reg->ready = -1;
+        pj_release_lock();
+        return;
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        const char *id = ENTRY_ID(table, stride, i);
+        unsigned   s = pj_registry_hash( id ) & (REGISTRY_SLOTS - 1);
+
+        while( reg->slot[s] != 0
+               && strcmp( ENTRY_ID(table, stride, reg->slot[s] - 1), id ) )
+            s = (s + 1) & (REGISTRY_SLOTS - 1);
+
+        if( reg->slot[s] == 0 )
+            reg->slot[s] = (short) (i + 1);
+    }
+
+    PJ_PUBLISH_BARRIER();
+    reg->ready = 1;
+
+    pj_release_lock();
+}
+
+/************************************************************************/
+/*                          pj_registry_find()                          */
+/*                                                                      */
+/*      Number of the entry with the given id, or -1.                   */
+/************************************************************************/
+
+static int pj_registry_find( PJ_REGISTRY *reg, const void *table,
+                             size_t stride, const char *id )
+
+{
+    unsigned s;
+    int      i;
+
+    if( reg->ready == 0 )
+        pj_registry_build( reg, table, stride );
+    else
+        PJ_PUBLISH_BARRIER();   /* read slot[] only after ready */
+
+    if( reg->ready < 0 )
+    {
+        for( i = 0; ENTRY_ID(table, stride, i) != NULL; i++ )
+        {
+            if( strcmp( ENTRY_ID(table, stride, i), id ) == 0 )
+                return i;
+        }
+        return -1;
+    }
+
+    s = pj_registry_hash( id ) & (REGISTRY_SLOTS - 1);
+    while( (i = reg->slot[s] - 1) >= 0 )
+    {
+        if( strcmp( ENTRY_ID(table, stride, i), id ) == 0 )
+            return i;
+        s = (s + 1) & (REGISTRY_SLOTS - 1);
+    }
+
+    return -1;
+}
+
+/************************************************************************/
+/*                            pj_find_proj()                            */
+/************************************************************************/
+
+struct PJ_LIST *pj_find_proj( const char *id )
+
+{
+    int i = pj_registry_find( &list_registry, pj_list,
+                              sizeof(struct PJ_LIST), id );
+
+    return i < 0 ? NULL : pj_list + i;
+}
+
+/************************************************************************/
+/*                           pj_find_ellps()                            */
+/************************************************************************/
+
+struct PJ_ELLPS *pj_find_ellps( const char *id )
+
+{
+    int i = pj_registry_find( &ellps_registry, pj_ellps,
+                              sizeof(struct PJ_ELLPS), id );
+
+    return i < 0 ? NULL : pj_ellps + i;
+}
+
+/************************************************************************/
+/*                           pj_find_units()                            */
+/************************************************************************/
+
+struct PJ_UNITS *pj_find_units( const char *id )
+
+{
+    int i = pj_registry_find( &units_registry, pj_units,
+                              sizeof(struct PJ_UNITS), id );
+
+    return i < 0 ? NULL : pj_units + i;
+}
+
+/************************************************************************/
+/*                           pj_find_datum()                            */
+/************************************************************************/
+
+struct PJ_DATUMS *pj_find_datum( const char *id )
+
+{
+    int i = pj_registry_find( &datums_registry, pj_datums,
+                              sizeof(struct PJ_DATUMS), id );
+
+    return i < 0 ? NULL : pj_datums + i;
+}
+
+/************************************************************************/
+/*                       pj_find_prime_meridian()                       */
+/************************************************************************/
+
+struct PJ_PRIME_MERIDIANS *pj_find_prime_meridian( const char *id )
+
+{
+    int i = pj_registry_find( &pm_registry, pj_prime_meridians,
+                              sizeof(struct PJ_PRIME_MERIDIANS), id );
+
+    return i < 0 ? NULL : pj_prime_meridians + i;
+}
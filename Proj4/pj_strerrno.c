@@ -52,6 +52,8 @@ pj_err_list[] = {
 	"unparseable coordinate system definition",	/* -44 */
 	"geocentric transformation missing z or ellps",	/* -45 */
 	"unknown prime meridian conversion id",		/* -46 */
+	"approximation error bound not met",		/* -47 */
+	"invalid raster size or resolution",		/* -48 */
 };
 	char *
 pj_strerrno(int err) 
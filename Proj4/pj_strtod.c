@@ -0,0 +1,215 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Number parsing that always takes '.' as the decimal point,
+ *           whatever the locale, without calling setlocale().
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <locale.h>
+
+PJ_CVSID("$Id$");
+
+/* longest number handed to the C library, see pj_strtod_locale() */
+#define MAX_NUMBER 400
+
+/* powers of ten that are exact as doubles */
+static const double exact_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22 };
+
+#define IS_SPACE(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+/************************************************************************/
+/*                         pj_strtod_locale()                           */
+/*                                                                      */
+/*      Parse with the C library strtod(), swapping '.' for the         */
+/*      decimal point of the current locale.  Only characters that      */
+/*      can be part of a number in the "C" locale are passed on, so     */
+/*      a locale's own separators are not taken as part of it.  'd'     */
+/*      and 'D' are left out of decimal numbers, as some strtod()s      */
+/*      read them as an exponent.                                       */
+/************************************************************************/
+
+static double pj_strtod_locale( const char *nptr, char **endptr )
+
+{
+    char       work[MAX_NUMBER+1], *work_end;
+    const char *point = localeconv()->decimal_point;
+    const char *s = nptr;
+    int        n = 0, hex;
+    double     result;
+
+    while( IS_SPACE(*s) )
+        s++;
+
+    if( *s == '+' || *s == '-' )
+        work[n++] = *s++;
+    hex = s[0] == '0' && (s[1] == 'x' || s[1] == 'X');
+
+    while( n < MAX_NUMBER && *s != '\0' )
+    {
+        char c = *s;
+
+        if( c == '.' )
+            c = point[0];
+        else if( !(IS_DIGIT(c) || c == '+' || c == '-'
+                   || (c != 'd' && c != 'D' && strchr( "eEiInNfFaAtTyY", c ))
+                   || (hex && strchr( "xXaAbBcCdDeEfFpP", c ))) )
+            break;
+
+        work[n++] = c;
+        s++;
+    }
+    work[n] = '\0';
+
+    result = strtod( work, &work_end );
+
+    if( endptr != NULL )
+    {
+        /* map back, counting from where the number started */
+        const char *start = nptr;
+
+        while( IS_SPACE(*start) )
+            start++;
+        *endptr = (char *) (work_end == work ? nptr
+                            : start + (work_end - work));
+    }
+
+    return result;
+}
+
+/************************************************************************/
+/*                             pj_strtod()                              */
+/*                                                                      */
+/*      strtod() as in the "C" locale, whatever the current one.        */
+/*      Plain decimal numbers of up to 15 significant digits with a     */
+/*      small exponent are converted exactly here; anything else is     */
+/*      handed to the C library.                                        */
+/************************************************************************/
+
+double pj_strtod( const char *nptr, char **endptr )
+
+{
+    const char *s = nptr;
+    double     mantissa = 0.0, result;
+    int        negative = 0, digits = 0, any_digit = 0;
+    int        exponent = 0;
+
+    while( IS_SPACE(*s) )
+        s++;
+
+    if( *s == '+' || *s == '-' )
+        negative = *s++ == '-';
+
+    /* hex, infinity and nan go to the C library */
+    if( !(IS_DIGIT(*s) || (*s == '.' && IS_DIGIT(s[1])))
+        || (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) )
+        return pj_strtod_locale( nptr, endptr );
+
+/* -------------------------------------------------------------------- */
+/*      Collect the significant digits.                                 */
+/* -------------------------------------------------------------------- */
+    for( ; IS_DIGIT(*s); s++ )
+    {
+        any_digit = 1;
+        if( digits == 0 && *s == '0' )
+            continue;
+        if( ++digits > 15 )
+            return pj_strtod_locale( nptr, endptr );
+        mantissa = mantissa * 10.0 + (*s - '0');
+    }
+
+    if( *s == '.' )
+    {
+        for( s++; IS_DIGIT(*s); s++ )
+        {
+            any_digit = 1;
+            exponent--;
+            if( digits == 0 && *s == '0' )
+                continue;
+            if( ++digits > 15 )
+                return pj_strtod_locale( nptr, endptr );
+            mantissa = mantissa * 10.0 + (*s - '0');
+        }
+    }
+
+    if( !any_digit )
+        return pj_strtod_locale( nptr, endptr );
+
+/* -------------------------------------------------------------------- */
+/*      Exponent, only if digits follow.                                */
+/* -------------------------------------------------------------------- */
+    if( *s == 'e' || *s == 'E' )
+    {
+        const char *e = s + 1;
+        int        exp_negative = 0, exp_value = 0;
+
+        if( *e == '+' || *e == '-' )
+            exp_negative = *e++ == '-';
+
+        if( IS_DIGIT(*e) )
+        {
+            for( ; IS_DIGIT(*e); e++ )
+            {
+                if( exp_value < 10000 )
+                    exp_value = exp_value * 10 + (*e - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            s = e;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Mantissa and power of ten are both exact, so one rounding       */
+/*      gives the correctly rounded result.                             */
+/* -------------------------------------------------------------------- */
+    if( mantissa == 0.0 )
+        result = 0.0;
+    else if( exponent >= 0 && exponent <= 22 )
+        result = mantissa * exact_pow10[exponent];
+    else if( exponent < 0 && exponent >= -22 )
+        result = mantissa / exact_pow10[-exponent];
+    else
+        return pj_strtod_locale( nptr, endptr );
+
+    if( endptr != NULL )
+        *endptr = (char *) s;
+
+    return negative ? -result : result;
+}
+
+/************************************************************************/
+/*                              pj_atof()                               */
+/************************************************************************/
+
+double pj_atof( const char *nptr )
+
+{
+    return pj_strtod( nptr, NULL );
+}
@@ -32,6 +32,7 @@
 #include <projects.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
 #include "geocent.h"
 
 PJ_CVSID("$Id: pj_transform.c 1504 2009-01-06 02:11:57Z warmerdam $");
@@ -52,6 +53,9 @@ PJ_CVSID("$Id: pj_transform.c 1504 2009-01-06 02:11:57Z warmerdam $");
 #define Rz_BF (defn->datum_params[5])
 #define M_BF  (defn->datum_params[6])
 
+#define EPS 1.0e-12
+#define AD_C 1.0026000 /* Toms region 1 constant, as in geocent.c */
+
 /* 
 ** This table is intended to indicate for any given error code in 
 ** the range 0 to -44, whether that error will occur for all locations (ie.
@@ -72,40 +76,287 @@ static const int transient_error[45] = {
     /* 40 to 44 */ 0, 0, 0, 0, 0 };
 
 /************************************************************************/
-/*                            pj_transform()                            */
+/*                         pj_is_fatal_error()                          */
 /*                                                                      */
-/*      Currently this function doesn't recognise if two projections    */
-/*      are identical (to short circuit reprojection) because it is     */
-/*      difficult to compare PJ structures (since there are some        */
-/*      projection specific components).                                */
+/*      Does this error from projecting one point apply to the whole    */
+/*      request, rather than just that point?                           */
 /************************************************************************/
 
-int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
-                  double *x, double *y, double *z )
+static int pj_is_fatal_error( int err, long point_count )
 
 {
-    long      i;
-    int       need_datum_shift;
+    return (err != 33 /*EDOM*/ && err != 34 /*ERANGE*/ )
+        && (err > 0 || err < -44 || point_count == 1
+            || transient_error[-err] == 0 );
+}
 
-    pj_errno = 0;
+/************************************************************************/
+/*                          pj_points_errno()                           */
+/*                                                                      */
+/*      pj_fwd() and pj_inv() report a libm errno raised while          */
+/*      projecting a point as that point's error.  An array kernel      */
+/*      handles the whole block, so after it we can only tell that      */
+/*      errno was raised somewhere; reject the points the math library  */
+/*      left non-finite, which are the ones it complained about.        */
+/************************************************************************/
 
-    if( point_offset == 0 )
-        point_offset = 1;
+static void pj_points_errno( PJ *defn, long block_count, int point_offset,
+                             double *x, double *y, int *status, int err )
+
+{
+    long      i, io;
+
+    for( i = io = 0; i < block_count; i++, io += point_offset )
+    {
+        if( x[io] == HUGE_VAL )
+            continue;
+
+        /* x - x is NaN for both NaN and infinite x */
+        if( x[io] - x[io] != 0.0 || y[io] - y[io] != 0.0 )
+        {
+            x[io] = y[io] = HUGE_VAL;
+            if( status != NULL )
+                status[i] = err;
+        }
+    }
+
+    if( defn->ctx->last_errno == 0 )
+        pj_ctx_set_errno( defn->ctx, err );
+}
+
+/************************************************************************/
+/*                           pj_inv_points()                            */
+/*                                                                      */
+/*      Inverse project a block of points in place.  Projections that   */
+/*      provide an inv_array kernel get the whole block in one call,    */
+/*      with the pj_inv() scaling and longitude reduction done here     */
+/*      in simple loops; everything else goes through pj_inv() one      */
+/*      point at a time.  point_count is the size of the whole          */
+/*      request, which decides whether a point error is fatal.          */
+/************************************************************************/
+
+static int pj_inv_points( PJ *defn, long point_count, long block_count,
+                          int point_offset,
+                          double *x, double *y, int *status )
+
+{
+    long      i, io;
+    int       err;
+
+    if( defn->inv_array == NULL )
+    {
+        for( i = 0; i < block_count; i++ )
+        {
+            XY         projected_loc;
+            LP	       geodetic_loc;
+
+            projected_loc.u = x[point_offset*i];
+            projected_loc.v = y[point_offset*i];
+
+            if( projected_loc.u == HUGE_VAL )
+                continue;
+
+            geodetic_loc = pj_inv( projected_loc, defn );
+            err = defn->ctx->last_errno;
+            if( err != 0 )
+            {
+                if( pj_is_fatal_error( err, point_count ) )
+                    return err;
+                else
+                {
+                    geodetic_loc.u = HUGE_VAL;
+                    geodetic_loc.v = HUGE_VAL;
+                    if( status != NULL )
+                        status[i] = err;
+                }
+            }
+
+            x[point_offset*i] = geodetic_loc.u;
+            y[point_offset*i] = geodetic_loc.v;
+        }
+        return 0;
+    }
+
+    for( i = io = 0; i < block_count; i++, io += point_offset )
+    {
+        if( x[io] == HUGE_VAL )
+            continue;
+
+        x[io] = (x[io] * defn->to_meter - defn->x0) * defn->ra;
+        y[io] = (y[io] * defn->to_meter - defn->y0) * defn->ra;
+    }
+
+    defn->ctx->last_errno = errno = 0;
+    (*defn->inv_array)( defn, block_count, point_offset, x, y, status );
+    if( errno != 0 )
+        pj_points_errno( defn, block_count, point_offset, x, y, status,
+                         errno );
+    err = defn->ctx->last_errno;
+    if( err != 0 && pj_is_fatal_error( err, point_count ) )
+        return err;
+
+    for( i = io = 0; i < block_count; i++, io += point_offset )
+    {
+        if( x[io] == HUGE_VAL )
+            continue;
+
+        x[io] += defn->lam0;
+        if( !defn->over )
+            x[io] = adjlon( x[io] );
+        if( defn->geoc && fabs(fabs(y[io]) - HALFPI) > EPS )
+            y[io] = atan( defn->one_es * tan(y[io]) );
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                           pj_fwd_points()                            */
+/*                                                                      */
+/*      Forward project a run of points in place; the counterpart of    */
+/*      pj_inv_points() built around pj_fwd() and fwd_array.            */
+/************************************************************************/
+
+static int pj_fwd_points( PJ *defn, long point_count, long block_count,
+                          int point_offset,
+                          double *x, double *y, int *status )
+
+{
+    long      i, io;
+    int       err;
+    double    t;
+
+    if( defn->fwd_array == NULL )
+    {
+        for( i = 0; i < block_count; i++ )
+        {
+            XY         projected_loc;
+            LP	       geodetic_loc;
+
+            geodetic_loc.u = x[point_offset*i];
+            geodetic_loc.v = y[point_offset*i];
+
+            if( geodetic_loc.u == HUGE_VAL )
+                continue;
+
+            projected_loc = pj_fwd( geodetic_loc, defn );
+            err = defn->ctx->last_errno;
+            if( err != 0 )
+            {
+                if( pj_is_fatal_error( err, point_count ) )
+                    return err;
+                else
+                {
+                    projected_loc.u = HUGE_VAL;
+                    projected_loc.v = HUGE_VAL;
+                    if( status != NULL )
+                        status[i] = err;
+                }
+            }
+
+            x[point_offset*i] = projected_loc.u;
+            y[point_offset*i] = projected_loc.v;
+        }
+        return 0;
+    }
+
+    defn->ctx->last_errno = 0;
+    for( i = io = 0; i < block_count; i++, io += point_offset )
+    {
+        if( x[io] == HUGE_VAL )
+            continue;
+
+        /* same over-range test as pj_fwd() */
+        if( (t = fabs(y[io]) - HALFPI) > EPS || fabs(x[io]) > 10. )
+        {
+            pj_ctx_set_errno( defn->ctx, -14 );
+            if( pj_is_fatal_error( -14, point_count ) )
+                return -14;
+            x[io] = y[io] = HUGE_VAL;
+            if( status != NULL )
+                status[i] = -14;
+            continue;
+        }
+
+        if( fabs(t) <= EPS )
+            y[io] = y[io] < 0. ? -HALFPI : HALFPI;
+        else if( defn->geoc )
+            y[io] = atan( defn->rone_es * tan(y[io]) );
+        x[io] -= defn->lam0;
+        if( !defn->over )
+            x[io] = adjlon( x[io] );
+    }
+
+    errno = 0;
+    (*defn->fwd_array)( defn, block_count, point_offset, x, y, status );
+    if( errno != 0 )
+        pj_points_errno( defn, block_count, point_offset, x, y, status,
+                         errno );
+    err = defn->ctx->last_errno;
+    if( err != 0 && pj_is_fatal_error( err, point_count ) )
+        return err;
+
+    for( i = io = 0; i < block_count; i++, io += point_offset )
+    {
+        if( x[io] == HUGE_VAL )
+            continue;
+
+        x[io] = defn->fr_meter * (defn->a * x[io] + defn->x0);
+        y[io] = defn->fr_meter * (defn->a * y[io] + defn->y0);
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                           pj_plan_block()                            */
+/*                                                                      */
+/*      Run the stages selected in a plan over one block of points.     */
+/************************************************************************/
+
+static int pj_plan_block( PJ_PLAN *plan, long point_count, long block_count,
+                          int point_offset,
+                          double *x, double *y, double *z, int *status )
+
+{
+    PJ        *srcdefn = plan->srcdefn;
+    PJ        *dstdefn = plan->dstdefn;
+    int       stages = plan->stages;
+    long      i;
+    int       err;
+
+/* -------------------------------------------------------------------- */
+/*      Definitions differing only in units, false origin or lat/long   */
+/*      prime meridian reduce to a scale and offset.                    */
+/* -------------------------------------------------------------------- */
+    if( stages & PJ_STAGE_AFFINE )
+    {
+        for( i = 0; i < block_count; i++ )
+        {
+            if( x[point_offset*i] != HUGE_VAL )
+            {
+                x[point_offset*i] = x[point_offset*i] * plan->x_scale
+                    + plan->x_offset;
+                y[point_offset*i] = y[point_offset*i] * plan->y_scale
+                    + plan->y_offset;
+            }
+        }
+    }
 
 /* -------------------------------------------------------------------- */
 /*      Transform geocentric source coordinates to lat/long.            */
 /* -------------------------------------------------------------------- */
-    if( srcdefn->is_geocent )
+    if( stages & PJ_STAGE_SRC_GEOCENT )
     {
         if( z == NULL )
         {
-            pj_errno = PJD_ERR_GEOCENTRIC;
+            pj_ctx_set_errno( srcdefn->ctx, PJD_ERR_GEOCENTRIC);
             return PJD_ERR_GEOCENTRIC;
         }
 
         if( srcdefn->to_meter != 1.0 )
         {
-            for( i = 0; i < point_count; i++ )
+            for( i = 0; i < block_count; i++ )
             {
                 if( x[point_offset*i] != HUGE_VAL )
                 {
@@ -115,65 +366,44 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
             }
         }
 
-        if( pj_geocentric_to_geodetic( srcdefn->a_orig, srcdefn->es_orig,
-                                       point_count, point_offset, 
-                                       x, y, z ) != 0) 
-            return pj_errno;
+        err = pj_geocentric_to_geodetic( srcdefn->a_orig, srcdefn->es_orig,
+                                         block_count, point_offset, 
+                                         x, y, z );
+        if( err != 0 )
+        {
+            pj_ctx_set_errno( srcdefn->ctx, err );
+            return err;
+        }
     }
 
 /* -------------------------------------------------------------------- */
 /*      Transform source points to lat/long, if they aren't             */
 /*      already.                                                        */
 /* -------------------------------------------------------------------- */
-    else if( !srcdefn->is_latlong )
+    else if( stages & PJ_STAGE_SRC_INV )
     {
         if( srcdefn->inv == NULL )
         {
-            pj_errno = -17; /* this isn't correct, we need a no inverse err */
-            if( getenv( "PROJ_DEBUG" ) != NULL )
-            {
-                fprintf( stderr, 
-                       "pj_transform(): source projection not invertable\n" );
-            }
-            return pj_errno;
+            /* this isn't correct, we need a no inverse err */
+            pj_ctx_set_errno( srcdefn->ctx, -17 );
+            pj_log( srcdefn->ctx, PJ_LOG_ERROR, 
+                    "pj_transform(): source projection not invertable" );
+            return -17;
         }
 
-        for( i = 0; i < point_count; i++ )
-        {
-            XY         projected_loc;
-            LP	       geodetic_loc;
-
-            projected_loc.u = x[point_offset*i];
-            projected_loc.v = y[point_offset*i];
-
-            if( projected_loc.u == HUGE_VAL )
-                continue;
-
-            geodetic_loc = pj_inv( projected_loc, srcdefn );
-            if( pj_errno != 0 )
-            {
-                if( (pj_errno != 33 /*EDOM*/ && pj_errno != 34 /*ERANGE*/ )
-                    && (pj_errno > 0 || pj_errno < -44 || point_count == 1
-                        || transient_error[-pj_errno] == 0 ) )
-                    return pj_errno;
-                else
-                {
-                    geodetic_loc.u = HUGE_VAL;
-                    geodetic_loc.v = HUGE_VAL;
-                }
-            }
-
-            x[point_offset*i] = geodetic_loc.u;
-            y[point_offset*i] = geodetic_loc.v;
-        }
+        err = pj_inv_points( srcdefn, point_count, block_count,
+                             point_offset, x, y, 
+                             status );
+        if( err != 0 )
+            return err;
     }
 /* -------------------------------------------------------------------- */
 /*      But if they are already lat long, adjust for the prime          */
 /*      meridian if there is one in effect.                             */
 /* -------------------------------------------------------------------- */
-    if( srcdefn->from_greenwich != 0.0 )
+    if( stages & PJ_STAGE_SRC_PM )
     {
-        for( i = 0; i < point_count; i++ )
+        for( i = 0; i < block_count; i++ )
         {
             if( x[point_offset*i] != HUGE_VAL )
                 x[point_offset*i] += srcdefn->from_greenwich;
@@ -183,17 +413,21 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
 /*      Convert datums if needed, and possible.                         */
 /* -------------------------------------------------------------------- */
-    if( pj_datum_transform( srcdefn, dstdefn, point_count, point_offset, 
-                            x, y, z ) != 0 )
-        return pj_errno;
+    if( stages & PJ_STAGE_DATUM )
+    {
+        err = pj_datum_transform( srcdefn, dstdefn, block_count, point_offset, 
+                                  x, y, z );
+        if( err != 0 )
+            return err;
+    }
 
 /* -------------------------------------------------------------------- */
 /*      But if they are staying lat long, adjust for the prime          */
 /*      meridian if there is one in effect.                             */
 /* -------------------------------------------------------------------- */
-    if( dstdefn->from_greenwich != 0.0 )
+    if( stages & PJ_STAGE_DST_PM )
     {
-        for( i = 0; i < point_count; i++ )
+        for( i = 0; i < block_count; i++ )
         {
             if( x[point_offset*i] != HUGE_VAL )
                 x[point_offset*i] -= dstdefn->from_greenwich;
@@ -204,20 +438,20 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
 /*      Transform destination latlong to geocentric if required.        */
 /* -------------------------------------------------------------------- */
-    if( dstdefn->is_geocent )
+    if( stages & PJ_STAGE_DST_GEOCENT )
     {
         if( z == NULL )
         {
-            pj_errno = PJD_ERR_GEOCENTRIC;
+            pj_ctx_set_errno( dstdefn->ctx, PJD_ERR_GEOCENTRIC );
             return PJD_ERR_GEOCENTRIC;
         }
 
         pj_geodetic_to_geocentric( dstdefn->a_orig, dstdefn->es_orig,
-                                   point_count, point_offset, x, y, z );
+                                   block_count, point_offset, x, y, z );
 
         if( dstdefn->fr_meter != 1.0 )
         {
-            for( i = 0; i < point_count; i++ )
+            for( i = 0; i < block_count; i++ )
             {
                 if( x[point_offset*i] != HUGE_VAL )
                 {
@@ -232,45 +466,22 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /*      Transform destination points to projection coordinates, if      */
 /*      desired.                                                        */
 /* -------------------------------------------------------------------- */
-    else if( !dstdefn->is_latlong )
+    else if( stages & PJ_STAGE_DST_FWD )
     {
-        for( i = 0; i < point_count; i++ )
-        {
-            XY         projected_loc;
-            LP	       geodetic_loc;
-
-            geodetic_loc.u = x[point_offset*i];
-            geodetic_loc.v = y[point_offset*i];
-
-            if( geodetic_loc.u == HUGE_VAL )
-                continue;
-
-            projected_loc = pj_fwd( geodetic_loc, dstdefn );
-            if( pj_errno != 0 )
-            {
-                if( (pj_errno != 33 /*EDOM*/ && pj_errno != 34 /*ERANGE*/ )
-                    && (pj_errno > 0 || pj_errno < -44 || point_count == 1
-                        || transient_error[-pj_errno] == 0 ) )
-                    return pj_errno;
-                else
-                {
-                    projected_loc.u = HUGE_VAL;
-                    projected_loc.v = HUGE_VAL;
-                }
-            }
-
-            x[point_offset*i] = projected_loc.u;
-            y[point_offset*i] = projected_loc.v;
-        }
+        err = pj_fwd_points( dstdefn, point_count, block_count,
+                             point_offset, x, y, 
+                             status );
+        if( err != 0 )
+            return err;
     }
 
 /* -------------------------------------------------------------------- */
 /*      If a wrapping center other than 0 is provided, rewrap around    */
 /*      the suggested center (for latlong coordinate systems only).     */
 /* -------------------------------------------------------------------- */
-    else if( dstdefn->is_latlong && dstdefn->long_wrap_center != 0 )
+    else if( stages & PJ_STAGE_DST_WRAP )
     {
-        for( i = 0; i < point_count; i++ )
+        for( i = 0; i < block_count; i++ )
         {
             if( x[point_offset*i] == HUGE_VAL )
                 continue;
@@ -285,6 +496,113 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
     return 0;
 }
 
+/************************************************************************/
+/*                            pj_plan_run()                             */
+/*                                                                      */
+/*      Run the stages selected in a plan (see pj_plan.c) over the      */
+/*      points.  pj_transform() uses the plan from pj_plan_init(),      */
+/*      which does every stage that could apply.                        */
+/*                                                                      */
+/*      The points are taken PJ_TRANSFORM_BLOCK at a time through all   */
+/*      the stages, so that large requests are not read and written     */
+/*      back to memory once per stage.  Very large requests may also    */
+/*      be split across threads, see pj_parallel.c.                     */
+/*                                                                      */
+/*      If status is non-NULL the projection steps record the error     */
+/*      code of each point they reject in it.                           */
+/************************************************************************/
+
+int pj_plan_run( PJ_PLAN *plan, long point_count, int point_offset,
+                 double *x, double *y, double *z, int *status )
+
+{
+    long      start, block_count, io;
+    int       err = 0;
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    if( plan->srcdefn->ctx->thread_count > 1
+        && point_count >= 2 * PJ_PARALLEL_MIN_POINTS
+        && pj_plan_run_parallel( plan, point_count, point_offset, 
+                                 x, y, z, status, &err ) == 0 )
+        return err;
+
+    plan->srcdefn->ctx->last_errno = 0;
+    plan->dstdefn->ctx->last_errno = 0;
+
+    for( start = 0; start < point_count && err == 0; 
+         start += PJ_TRANSFORM_BLOCK )
+    {
+        block_count = MIN(point_count - start, PJ_TRANSFORM_BLOCK);
+        io = start * point_offset;
+
+        err = pj_plan_block( plan, point_count, block_count, point_offset,
+                             x + io, y + io, 
+                             z != NULL ? z + io : NULL,
+                             status != NULL ? status + start : NULL );
+    }
+
+    return err;
+}
+
+/************************************************************************/
+/*                            pj_transform()                            */
+/*                                                                      */
+/*      Currently this function doesn't recognise if two projections    */
+/*      are identical (to short circuit reprojection) because it is     */
+/*      difficult to compare PJ structures (since there are some        */
+/*      projection specific components).  Callers transforming many     */
+/*      batches between the same pair should use pj_plan_create(),      */
+/*      which does.                                                     */
+/************************************************************************/
+
+int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
+                  double *x, double *y, double *z )
+
+{
+    PJ_PLAN   plan;
+
+    pj_plan_init( &plan, srcdefn, dstdefn );
+    return pj_plan_run( &plan, point_count, point_offset, x, y, z, NULL );
+}
+
+/************************************************************************/
+/*                         pj_transform_batch()                         */
+/*                                                                      */
+/*      Transform separate, contiguous x, y (and optional z) arrays.    */
+/*      If status is non-NULL it receives zero for each point that      */
+/*      was transformed, and otherwise the projection error for that    */
+/*      point, or -14 if it was already HUGE_VAL or was rejected by     */
+/*      the datum shift.                                                */
+/************************************************************************/
+
+int pj_transform_batch( PJ *srcdefn, PJ *dstdefn, long point_count,
+                        double *x, double *y, double *z, int *status )
+
+{
+    PJ_PLAN   plan;
+    long      i;
+    int       err;
+
+    if( status != NULL )
+        memset( status, 0, sizeof(int) * point_count );
+
+    pj_plan_init( &plan, srcdefn, dstdefn );
+    err = pj_plan_run( &plan, point_count, 1, x, y, z, status );
+
+    if( status != NULL && err == 0 )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            if( x[i] == HUGE_VAL && status[i] == 0 )
+                status[i] = -14;
+        }
+    }
+
+    return err;
+}
+
 /************************************************************************/
 /*                     pj_geodetic_to_geocentric()                      */
 /************************************************************************/
@@ -297,8 +615,7 @@ int pj_geodetic_to_geocentric( double a, double es,
     double b;
     int    i;
     GeocentricInfo gi;
-
-    pj_errno = 0;
+    int    ret_errno = 0;
 
     if( es == 0.0 )
         b = a;
@@ -308,7 +625,7 @@ int pj_geodetic_to_geocentric( double a, double es,
     if( pj_Set_Geocentric_Parameters( &gi, a, b ) != 0 )
     {
         pj_errno = PJD_ERR_GEOCENTRIC;
-        return pj_errno;
+        return PJD_ERR_GEOCENTRIC;
     }
 
     for( i = 0; i < point_count; i++ )
@@ -321,13 +638,16 @@ int pj_geodetic_to_geocentric( double a, double es,
         if( pj_Convert_Geodetic_To_Geocentric( &gi, y[io], x[io], z[io], 
                                                x+io, y+io, z+io ) != 0 )
         {
-            pj_errno = -14;
+            ret_errno = -14;
             x[io] = y[io] = HUGE_VAL;
             /* but keep processing points! */
         }
     }
 
-    return pj_errno;
+    if( ret_errno != 0 )
+        pj_errno = ret_errno;
+
+    return ret_errno;
 }
 
 /************************************************************************/
@@ -351,7 +671,7 @@ int pj_geocentric_to_geodetic( double a, double es,
     if( pj_Set_Geocentric_Parameters( &gi, a, b ) != 0 )
     {
         pj_errno = PJD_ERR_GEOCENTRIC;
-        return pj_errno;
+        return PJD_ERR_GEOCENTRIC;
     }
 
     for( i = 0; i < point_count; i++ )
@@ -407,8 +727,8 @@ int pj_compare_datums( PJ *srcdefn, PJ *dstdefn )
     }
     else if( srcdefn->datum_type == PJD_GRIDSHIFT )
     {
-        return strcmp( pj_param(srcdefn->params,"snadgrids").s,
-                       pj_param(dstdefn->params,"snadgrids").s ) == 0;
+        return strcmp( pj_param(srcdefn->ctx, srcdefn->params,"snadgrids").s,
+                       pj_param(dstdefn->ctx, dstdefn->params,"snadgrids").s ) == 0;
     }
     else
         return 1;
@@ -425,8 +745,6 @@ int pj_geocentric_to_wgs84( PJ *defn,
 {
     int       i;
 
-    pj_errno = 0;
-
     if( defn->datum_type == PJD_3PARAM )
     {
         for( i = 0; i < point_count; i++ )
@@ -475,8 +793,6 @@ int pj_geocentric_from_wgs84( PJ *defn,
 {
     int       i;
 
-    pj_errno = 0;
-
     if( defn->datum_type == PJD_3PARAM )
     {
         for( i = 0; i < point_count; i++ )
@@ -514,6 +830,185 @@ int pj_geocentric_from_wgs84( PJ *defn,
     return 0;
 }
 
+/************************************************************************/
+/*                        pj_geodetic_shift()                           */
+/*                                                                      */
+/*      Fused geodetic -> geocentric -> 3/7 parameter Helmert ->        */
+/*      geodetic conversion, done for each point in a single pass.      */
+/*      The forward step is the closed form used by                     */
+/*      pj_Convert_Geodetic_To_Geocentric().  The inverse step starts   */
+/*      from the Toms (Bowring) estimate of geocent.c and applies one   */
+/*      fixed point correction, which brings the latitude within a few  */
+/*      nanometres of the iterative method for terrestrial heights.     */
+/*      Points near the centre of the earth, where the estimate is not  */
+/*      reliable, still use pj_Convert_Geocentric_To_Geodetic().        */
+/************************************************************************/
+
+static int pj_geodetic_shift( PJ *srcdefn, PJ *dstdefn,
+                              double src_a, double src_es,
+                              double dst_a, double dst_es,
+                              long point_count, int point_offset,
+                              double *x, double *y, double *z )
+
+{
+    double src_t[7], dst_t[7];
+    int    src_type = PJD_UNKNOWN, dst_type = PJD_UNKNOWN;
+    double dst_b, dst_ep2;
+    GeocentricInfo gi;
+    long   i;
+    int    ret_errno = 0;
+
+    dst_b = dst_a * sqrt(1.0 - dst_es);
+    dst_ep2 = dst_es / (1.0 - dst_es);
+
+    if( src_a <= 0.0 || src_es < 0.0 || src_es >= 1.0
+        || pj_Set_Geocentric_Parameters( &gi, dst_a, dst_b ) != 0 )
+    {
+        pj_ctx_set_errno( srcdefn->ctx, PJD_ERR_GEOCENTRIC );
+        return PJD_ERR_GEOCENTRIC;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Collect the Helmert parameters of each side, if any.            */
+/* -------------------------------------------------------------------- */
+    if( srcdefn->datum_type == PJD_3PARAM
+        || srcdefn->datum_type == PJD_7PARAM )
+    {
+        src_type = srcdefn->datum_type;
+        memcpy( src_t, srcdefn->datum_params, sizeof(src_t) );
+    }
+    if( dstdefn->datum_type == PJD_3PARAM
+        || dstdefn->datum_type == PJD_7PARAM )
+    {
+        dst_type = dstdefn->datum_type;
+        memcpy( dst_t, dstdefn->datum_params, sizeof(dst_t) );
+    }
+
+    for( i = 0; i < point_count; i++ )
+    {
+        long   io = i * point_offset;
+        double lam = x[io], phi = y[io], h;
+        double sinp, cosp, rn, X, Y, Z;
+        double W2, W, T0, S0, sinb, cosb, T1, Sum, S1, w;
+
+        if( lam == HUGE_VAL )
+            continue;
+
+        h = z != NULL ? z[io] : 0.0;
+
+/* -------------------------------------------------------------------- */
+/*      Geodetic to geocentric on the source ellipsoid.                 */
+/* -------------------------------------------------------------------- */
+        if( phi < -HALFPI && phi > -1.001 * HALFPI )
+            phi = -HALFPI;
+        else if( phi > HALFPI && phi < 1.001 * HALFPI )
+            phi = HALFPI;
+        else if( phi < -HALFPI || phi > HALFPI )
+        {
+            ret_errno = -14;
+            x[io] = y[io] = HUGE_VAL;
+            continue;
+        }
+
+        sinp = sin(phi);
+        cosp = cos(phi);
+        rn = src_a / sqrt(1.0 - src_es * sinp * sinp);
+        X = (rn + h) * cosp * cos(lam);
+        Y = (rn + h) * cosp * sin(lam);
+        Z = (rn * (1.0 - src_es) + h) * sinp;
+
+/* -------------------------------------------------------------------- */
+/*      Source datum to WGS84, then WGS84 to the destination datum.     */
+/* -------------------------------------------------------------------- */
+        if( src_type == PJD_3PARAM )
+        {
+            X += src_t[0];
+            Y += src_t[1];
+            Z += src_t[2];
+        }
+        else if( src_type == PJD_7PARAM )
+        {
+            double X1, Y1;
+
+            X1 = src_t[6]*(           X - src_t[5]*Y + src_t[4]*Z) + src_t[0];
+            Y1 = src_t[6]*( src_t[5]*X +           Y - src_t[3]*Z) + src_t[1];
+            Z  = src_t[6]*(-src_t[4]*X + src_t[3]*Y +           Z) + src_t[2];
+            X = X1;
+            Y = Y1;
+        }
+
+        if( dst_type == PJD_3PARAM )
+        {
+            X -= dst_t[0];
+            Y -= dst_t[1];
+            Z -= dst_t[2];
+        }
+        else if( dst_type == PJD_7PARAM )
+        {
+            double X1, Y1, Z1;
+
+            X1 = (X - dst_t[0]) / dst_t[6];
+            Y1 = (Y - dst_t[1]) / dst_t[6];
+            Z1 = (Z - dst_t[2]) / dst_t[6];
+
+            X =            X1 + dst_t[5]*Y1 - dst_t[4]*Z1;
+            Y = -dst_t[5]*X1 +           Y1 + dst_t[3]*Z1;
+            Z =  dst_t[4]*X1 - dst_t[3]*Y1 +           Z1;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Geocentric to geodetic on the destination ellipsoid.            */
+/* -------------------------------------------------------------------- */
+        W2 = X*X + Y*Y;
+
+        /* points deep inside the earth go through the iterative method */
+        if( W2 + Z*Z < 0.25 * dst_b * dst_b )
+        {
+            pj_Convert_Geocentric_To_Geodetic( &gi, X, Y, Z,
+                                               y+io, x+io, &h );
+            if( z != NULL )
+                z[io] = h;
+            continue;
+        }
+
+        W = sqrt(W2);
+        if( W / dst_a < EPS )
+            lam = 0.0;
+        else
+            lam = atan2( Y, X );
+
+        T0 = Z * AD_C;
+        S0 = sqrt(T0*T0 + W2);
+        sinb = T0 / S0;
+        cosb = W / S0;
+        T1 = Z + dst_b * dst_ep2 * sinb * sinb * sinb;
+        Sum = W - dst_a * dst_es * cosb * cosb * cosb;
+        S1 = sqrt(T1*T1 + Sum*Sum);
+        sinp = T1 / S1;
+        cosp = Sum / S1;
+
+        w = sqrt(1.0 - dst_es * sinp * sinp);
+        h = W * cosp + Z * sinp - dst_a * w;
+        rn = dst_a / w;
+        T1 = Z * (rn + h);
+        Sum = W * (rn * (1.0 - dst_es) + h);
+        S1 = sqrt(T1*T1 + Sum*Sum);
+        sinp = T1 / S1;
+        cosp = Sum / S1;
+        w = sqrt(1.0 - dst_es * sinp * sinp);
+
+        x[io] = lam;
+        y[io] = atan2( sinp, cosp );
+        if( z != NULL )
+            z[io] = W * cosp + Z * sinp - dst_a * w;
+    }
+
+    if( ret_errno != 0 )
+        pj_ctx_set_errno( srcdefn->ctx, ret_errno );
+
+    return ret_errno;
+}
+
 /************************************************************************/
 /*                         pj_datum_transform()                         */
 /*                                                                      */
@@ -528,9 +1023,7 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
 
 {
     double      src_a, src_es, dst_a, dst_es;
-    int         z_is_temp = FALSE;
-
-    pj_errno = 0;
+    int         err = 0;
 
 /* -------------------------------------------------------------------- */
 /*      We cannot do any meaningful datum transformation if either      */
@@ -555,17 +1048,10 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
     dst_es = dstdefn->es_orig;
 
 /* -------------------------------------------------------------------- */
-/*      Create a temporary Z array if one is not provided.              */
+/*      A NULL z is allowed: heights are then taken as zero on input    */
+/*      and the output heights are discarded, without a scratch array.  */
 /* -------------------------------------------------------------------- */
-    if( z == NULL )
-    {
-        int	bytes = sizeof(double) * point_count * point_offset;
-        z = (double *) pj_malloc(bytes);
-        memset( z, 0, bytes );
-        z_is_temp = TRUE;
-    }
-
-#define CHECK_RETURN {if( pj_errno != 0 && (pj_errno > 0 || transient_error[-pj_errno] == 0) ) { if( z_is_temp ) pj_dalloc(z); return pj_errno; }}
+#define CHECK_RETURN {if( err != 0 && (err > 0 || transient_error[-err] == 0) ) { pj_ctx_set_errno( srcdefn->ctx, err ); return err; }}
 
 /* -------------------------------------------------------------------- */
 /*	If this datum requires grid shifts, then apply it to geodetic   */
@@ -573,8 +1059,8 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
 /* -------------------------------------------------------------------- */
     if( srcdefn->datum_type == PJD_GRIDSHIFT )
     {
-        pj_apply_gridshift( pj_param(srcdefn->params,"snadgrids").s, 0, 
-                            point_count, point_offset, x, y, z );
+        err = pj_apply_gridshift_2( srcdefn, 0, 
+                                    point_count, point_offset, x, y, z );
         CHECK_RETURN;
 
         src_a = SRS_WGS84_SEMIMAJOR;
@@ -597,34 +1083,14 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
         || dstdefn->datum_type == PJD_7PARAM)
     {
 /* -------------------------------------------------------------------- */
-/*      Convert to geocentric coordinates.                              */
-/* -------------------------------------------------------------------- */
-        pj_geodetic_to_geocentric( src_a, src_es,
-                                   point_count, point_offset, x, y, z );
-        CHECK_RETURN;
-
-/* -------------------------------------------------------------------- */
-/*      Convert between datums.                                         */
-/* -------------------------------------------------------------------- */
-        if( srcdefn->datum_type == PJD_3PARAM 
-            || srcdefn->datum_type == PJD_7PARAM )
-        {
-            pj_geocentric_to_wgs84( srcdefn, point_count, point_offset,x,y,z);
-            CHECK_RETURN;
-        }
-
-        if( dstdefn->datum_type == PJD_3PARAM 
-            || dstdefn->datum_type == PJD_7PARAM )
-        {
-            pj_geocentric_from_wgs84( dstdefn, point_count,point_offset,x,y,z);
-            CHECK_RETURN;
-        }
-
-/* -------------------------------------------------------------------- */
-/*      Convert back to geodetic coordinates.                           */
+/*      Convert to geocentric, shift between datums and convert         */
+/*      back to geodetic in one pass.  The separate                     */
+/*      pj_geodetic_to_geocentric() / pj_geocentric_to_wgs84() /        */
+/*      pj_geocentric_to_geodetic() steps remain available to callers.  */
 /* -------------------------------------------------------------------- */
-        pj_geocentric_to_geodetic( dst_a, dst_es,
-                                   point_count, point_offset, x, y, z );
+        err = pj_geodetic_shift( srcdefn, dstdefn, src_a, src_es,
+                                 dst_a, dst_es,
+                                 point_count, point_offset, x, y, z );
         CHECK_RETURN;
     }
 
@@ -633,14 +1099,11 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
 /* -------------------------------------------------------------------- */
     if( dstdefn->datum_type == PJD_GRIDSHIFT )
     {
-        pj_apply_gridshift( pj_param(dstdefn->params,"snadgrids").s, 1,
-                            point_count, point_offset, x, y, z );
+        err = pj_apply_gridshift_2( dstdefn, 1,
+                                    point_count, point_offset, x, y, z );
         CHECK_RETURN;
     }
 
-    if( z_is_temp )
-        pj_dalloc( z );
-
     return 0;
 }
 
@@ -0,0 +1,223 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Approximate pj_transform() for rows of evenly spaced points,
+ *           as when reprojecting a raster a scanline at a time.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+/* segments of fewer points are transformed exactly */
+#define APPROX_MIN_POINTS 5
+
+typedef struct {
+    PJ_PLAN plan;
+    int     point_offset;
+    double  *x, *y, *z;
+    double  max_error;
+    int     err;
+} PJ_APPROX_LINE;
+
+/************************************************************************/
+/*                          approx_exact()                              */
+/*                                                                      */
+/*      Transform count points from first, in place.                    */
+/************************************************************************/
+
+static void approx_exact( PJ_APPROX_LINE *line, long first, long count )
+
+{
+    long start = first * line->point_offset;
+    int  err;
+
+    err = pj_plan_run( &(line->plan), count, line->point_offset,
+                       line->x + start, line->y + start,
+                       line->z == NULL ? NULL : line->z + start, NULL );
+    if( err != 0 && line->err == 0 )
+        line->err = err;
+}
+
+/************************************************************************/
+/*                          approx_point()                              */
+/*                                                                      */
+/*      Transform one point into out[] (x, y, z), leaving the arrays    */
+/*      alone.  Returns 0 if it failed.                                 */
+/************************************************************************/
+
+static int approx_point( PJ_APPROX_LINE *line, long i, double *out )
+
+{
+    long k = i * line->point_offset;
+
+    out[0] = line->x[k];
+    out[1] = line->y[k];
+    out[2] = line->z == NULL ? 0.0 : line->z[k];
+
+    if( out[0] == HUGE_VAL
+        || pj_plan_run( &(line->plan), 1, 1, out + 0, out + 1,
+                        line->z == NULL ? NULL : out + 2, NULL ) != 0 )
+        return 0;
+
+    return out[0] != HUGE_VAL && out[1] != HUGE_VAL;
+}
+
+/************************************************************************/
+/*                          approx_store()                              */
+/************************************************************************/
+
+static void approx_store( PJ_APPROX_LINE *line, long i, const double *out )
+
+{
+    long k = i * line->point_offset;
+
+    line->x[k] = out[0];
+    line->y[k] = out[1];
+    if( line->z != NULL )
+        line->z[k] = out[2];
+}
+
+/************************************************************************/
+/*                         approx_segment()                             */
+/*                                                                      */
+/*      Fill in the points strictly between first and last, whose       */
+/*      transformed values are out_first and out_last.  If the exact    */
+/*      midpoint is within max_error of the straight line between       */
+/*      them the rest are interpolated, otherwise each half is tried    */
+/*      in turn.  Only the interior is written, so the arrays still     */
+/*      hold the input at first and last for the caller.                */
+/************************************************************************/
+
+static void approx_segment( PJ_APPROX_LINE *line, long first, long last,
+                            const double *out_first, const double *out_last )
+
+{
+    double out_mid[3], error, f;
+    long   mid, i;
+
+    if( last - first < APPROX_MIN_POINTS - 1 )
+    {
+        if( last - first > 1 )
+            approx_exact( line, first + 1, last - first - 1 );
+        return;
+    }
+
+    mid = first + (last - first) / 2;
+    if( !approx_point( line, mid, out_mid ) )
+    {
+        approx_exact( line, first + 1, last - first - 1 );
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      How far is the midpoint off the line?                           */
+/* -------------------------------------------------------------------- */
+    f = (double) (mid - first) / (last - first);
+    error = fabs( out_first[0] + f * (out_last[0] - out_first[0])
+                  - out_mid[0] );
+    error = MAX(error, fabs( out_first[1] + f * (out_last[1] - out_first[1])
+                             - out_mid[1] ));
+    if( line->z != NULL )
+        error = MAX(error,
+                    fabs( out_first[2] + f * (out_last[2] - out_first[2])
+                          - out_mid[2] ));
+
+    if( error > line->max_error )
+    {
+        /* the halves only write their interiors, so mid is still input */
+        approx_segment( line, first, mid, out_first, out_mid );
+        approx_segment( line, mid, last, out_mid, out_last );
+        approx_store( line, mid, out_mid );
+        return;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Close enough, interpolate.                                      */
+/* -------------------------------------------------------------------- */
+    for( i = first + 1; i < last; i++ )
+    {
+        double out[3];
+
+        f = (double) (i - first) / (last - first);
+        out[0] = out_first[0] + f * (out_last[0] - out_first[0]);
+        out[1] = out_first[1] + f * (out_last[1] - out_first[1]);
+        out[2] = out_first[2] + f * (out_last[2] - out_first[2]);
+        approx_store( line, i, out );
+    }
+    approx_store( line, mid, out_mid );
+}
+
+/************************************************************************/
+/*                       pj_transform_approx()                          */
+/*                                                                      */
+/*      pj_transform() for points evenly spaced along a straight line   */
+/*      in the source system, such as the pixel centres of a raster     */
+/*      scanline.  The ends and middle of the row are transformed       */
+/*      exactly; where the middle is within max_error (in destination   */
+/*      units, radians for lat/long) of the line between the ends the   */
+/*      points between are interpolated, otherwise each half is         */
+/*      handled the same way.  Any part of the row holding a point      */
+/*      that fails is transformed exactly.                              */
+/*                                                                      */
+/*      The error is only checked at the middle of each segment, so     */
+/*      it can be exceeded where the mapping bends more than once       */
+/*      over a segment.                                                 */
+/************************************************************************/
+
+int pj_transform_approx( PJ *srcdefn, PJ *dstdefn,
+                         long point_count, int point_offset,
+                         double *x, double *y, double *z, double max_error )
+
+{
+    PJ_APPROX_LINE line;
+    double         out_first[3], out_last[3];
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    if( point_count < APPROX_MIN_POINTS || !(max_error > 0.0) )
+        return pj_transform( srcdefn, dstdefn, point_count, point_offset,
+                             x, y, z );
+
+    pj_plan_init( &(line.plan), srcdefn, dstdefn );
+    line.point_offset = point_offset;
+    line.x = x;
+    line.y = y;
+    line.z = z;
+    line.max_error = max_error;
+    line.err = 0;
+
+    if( !approx_point( &line, 0, out_first )
+        || !approx_point( &line, point_count - 1, out_last ) )
+        return pj_plan_run( &(line.plan), point_count, point_offset,
+                            x, y, z, NULL );
+
+    approx_segment( &line, 0, point_count - 1, out_first, out_last );
+    approx_store( &line, 0, out_first );
+    approx_store( &line, point_count - 1, out_last );
+
+    return line.err;
+}
@@ -0,0 +1,498 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Reproject RGBA raster tiles from one projection to another.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/* source pixel positions beyond this are taken as missing */
+#define MAX_PIXEL 1e9
+
+/*
+** The inverse mapping, from each destination pixel centre to its
+** position in the source grid, is worked out once by pj_warp_create()
+** and kept, so the same destination tile can be rendered again from
+** new source tiles without transforming anything.
+*/
+struct PJ_WARP {
+    PJ          *src, *dst;     /* not owned */
+    projGeoref  src_georef, dst_georef;
+    int         width, height;
+    double      max_error;      /* in source units */
+    double      *map;           /* column, row; HUGE_VAL where none */
+};
+
+#define WARP_MAP      0
+#define WARP_RESAMPLE 1
+
+typedef struct {
+    PJ_WARP         *warp;
+    int             phase;
+    volatile long   next_block;
+    long            block_count;
+    const projTile  *tiles;     /* for WARP_RESAMPLE */
+    int             tile_count;
+    unsigned char   *rgba;
+    int             stride;
+    int             resampling;
+} PJ_WARP_JOB;
+
+typedef struct {
+    PJ_WARP_JOB *job;
+    projCtx     ctx;            /* own context and definitions, */
+    PJ          *src, *dst;     /* for WARP_MAP in extra threads */
+    double      *x, *y;         /* a row of points */
+    int         last_tile;
+} PJ_WARP_WORKER;
+
+/************************************************************************/
+/*                          pj_warp_map_row()                           */
+/*                                                                      */
+/*      Source grid position of each pixel centre of a destination      */
+/*      row.                                                            */
+/************************************************************************/
+
+static void pj_warp_map_row( PJ_WARP_WORKER *w, int row )
+
+{
+    PJ_WARP          *warp = w->job->warp;
+    const projGeoref *sg = &(warp->src_georef), *dg = &(warp->dst_georef);
+    double           *map = warp->map + (long) row * warp->width * 2;
+    int              i;
+
+    for( i = 0; i < warp->width; i++ )
+    {
+        w->x[i] = dg->x_min + (i + 0.5) * dg->res_x;
+        w->y[i] = dg->y_max - (row + 0.5) * dg->res_y;
+    }
+
+    /* a fatal error may leave the row part done; redo it point by point */
+    if( pj_transform_approx( w->dst, w->src, warp->width, 1, w->x, w->y,
+                             NULL, warp->max_error ) != 0 )
+    {
+        for( i = 0; i < warp->width; i++ )
+        {
+            w->x[i] = dg->x_min + (i + 0.5) * dg->res_x;
+            w->y[i] = dg->y_max - (row + 0.5) * dg->res_y;
+            if( pj_transform( w->dst, w->src, 1, 1, w->x + i, w->y + i,
+                              NULL ) != 0 )
+                w->x[i] = HUGE_VAL;
+        }
+    }
+
+    for( i = 0; i < warp->width; i++ )
+    {
+        double col = (w->x[i] - sg->x_min) / sg->res_x;
+        double src_row = (sg->y_max - w->y[i]) / sg->res_y;
+
+        if( w->x[i] == HUGE_VAL || w->y[i] == HUGE_VAL
+            || fabs(col) > MAX_PIXEL || fabs(src_row) > MAX_PIXEL )
+            col = src_row = HUGE_VAL;
+
+        map[2*i] = col;
+        map[2*i+1] = src_row;
+    }
+}
+
+/************************************************************************/
+/*                         pj_warp_pixel()                              */
+/*                                                                      */
+/*      The source pixel at col, row, or NULL if no tile has it.        */
+/*      Neighbouring pixels are mostly in the same tile, so the last    */
+/*      tile found is tried first.                                      */
+/************************************************************************/
+
+static const unsigned char *pj_warp_pixel( PJ_WARP_WORKER *w,
+                                           int col, int row )
+
+{
+    const projTile *tiles = w->job->tiles;
+    const projTile *t = tiles + w->last_tile;
+    int            i;
+
+    if( col < t->col || col >= t->col + t->width
+        || row < t->row || row >= t->row + t->height )
+    {
+        for( i = 0; i < w->job->tile_count; i++ )
+        {
+            t = tiles + i;
+            if( col >= t->col && col < t->col + t->width
+                && row >= t->row && row < t->row + t->height )
+                break;
+        }
+        if( i == w->job->tile_count )
+            return NULL;
+        w->last_tile = i;
+    }
+
+    return t->rgba + (long) (row - t->row) * t->stride
+        + (col - t->col) * 4;
+}
+
+/************************************************************************/
+/*                       pj_warp_resample_row()                         */
+/*                                                                      */
+/*      Fill a destination row from the source tiles.  Pixels with no   */
+/*      source are made transparent black.  Bilinear resampling         */
+/*      weights only the source pixels that exist, so edges of the      */
+/*      source are not darkened.                                        */
+/************************************************************************/
+
+static void pj_warp_resample_row( PJ_WARP_WORKER *w, int row )
+
+{
+    PJ_WARP_JOB   *job = w->job;
+    const double  *map = job->warp->map + (long) row * job->warp->width * 2;
+    unsigned char *out = job->rgba + (long) row * job->stride;
+    int           i, k;
+
+    for( i = 0; i < job->warp->width; i++, out += 4 )
+    {
+        const unsigned char *p;
+        double              u = map[2*i], v = map[2*i+1];
+
+        memset( out, 0, 4 );
+        if( u == HUGE_VAL )
+            continue;
+
+        if( job->resampling == PJ_WARP_NEAREST )
+        {
+            p = pj_warp_pixel( w, (int) floor(u), (int) floor(v) );
+            if( p != NULL )
+                memcpy( out, p, 4 );
+        }
+        else
+        {
+            const projTile *tile;
+            double         sum[4], weight = 0.0, fu, fv;
+            int            cu, cv, du, dv;
+
+            /* position relative to pixel centres */
+            u -= 0.5;
+            v -= 0.5;
+            cu = (int) floor(u);
+            cv = (int) floor(v);
+            fu = u - cu;
+            fv = v - cv;
+
+            /* mostly all four are in the last tile used */
+            p = pj_warp_pixel( w, cu, cv );
+            tile = job->tiles + w->last_tile;
+            if( p != NULL && cu + 1 < tile->col + tile->width
+                && cv + 1 < tile->row + tile->height )
+            {
+                const unsigned char *q = p + tile->stride;
+
+                for( k = 0; k < 4; k++ )
+                {
+                    double top = p[k] + fu * (p[k+4] - p[k]);
+                    double bottom = q[k] + fu * (q[k+4] - q[k]);
+
+                    out[k] = (unsigned char) (top + fv * (bottom - top) + 0.5);
+                }
+                continue;
+            }
+
+            sum[0] = sum[1] = sum[2] = sum[3] = 0.0;
+
+            for( dv = 0; dv < 2; dv++ )
+            {
+                for( du = 0; du < 2; du++ )
+                {
+                    double f = (du ? fu : 1.0 - fu) * (dv ? fv : 1.0 - fv);
+
+                    if( f == 0.0
+                        || (p = pj_warp_pixel( w, cu + du, cv + dv )) == NULL )
+                        continue;
+
+                    for( k = 0; k < 4; k++ )
+                        sum[k] += f * p[k];
+                    weight += f;
+                }
+            }
+
+            if( weight > 0.0 )
+            {
+                for( k = 0; k < 4; k++ )
+                    out[k] = (unsigned char) (sum[k] / weight + 0.5);
+            }
+        }
+    }
+}
+
+/************************************************************************/
+/*                         pj_warp_worker_main()                        */
+/*                                                                      */
+/*      Take blocks of rows until there are none left.                  */
+/************************************************************************/
+
+static void pj_warp_worker_main( void *arg )
+
+{
+    PJ_WARP_WORKER *w = (PJ_WARP_WORKER *) arg;
+    PJ_WARP_JOB    *job = w->job;
+    long           block;
+
+    while( (block = PJ_ATOMIC_INC( job->next_block )) < job->block_count )
+    {
+        int row = (int) (block * PJ_WARP_BLOCK_ROWS);
+        int end = MIN(row + PJ_WARP_BLOCK_ROWS, job->warp->height);
+
+        for( ; row < end; row++ )
+        {
+            if( job->phase == WARP_MAP )
+                pj_warp_map_row( w, row );
+            else
+                pj_warp_resample_row( w, row );
+        }
+    }
+}
+
+/************************************************************************/
+/*                            pj_warp_run()                             */
+/*                                                                      */
+/*      Run a job over all the rows, in blocks of PJ_WARP_BLOCK_ROWS,   */
+/*      on up to the source context's thread count threads.  The        */
+/*      calling thread always takes part, so the job gets done even     */
+/*      if no other thread can be set up.  Extra threads working out    */
+/*      the mapping get their own copies of the definitions, since      */
+/*      errors are reported through PJ->ctx.                            */
+/************************************************************************/
+
+static int pj_warp_run( PJ_WARP_JOB *job )
+
+{
+    PJ_WARP        *warp = job->warp;
+    PJ_WARP_WORKER *workers;
+    int            thread_count;
+    int            i, ok = 1;
+
+    job->next_block = 0;
+    job->block_count = (warp->height + PJ_WARP_BLOCK_ROWS - 1)
+        / PJ_WARP_BLOCK_ROWS;
+
+    thread_count = pj_job_count( warp->src->ctx, (double) job->block_count,
+                                 1.0 );
+
+    workers = (PJ_WARP_WORKER *)
+        pj_malloc(sizeof(PJ_WARP_WORKER) * thread_count);
+    if( workers == NULL )
+        return 0;
+    memset( workers, 0, sizeof(PJ_WARP_WORKER) * thread_count );
+
+/* -------------------------------------------------------------------- */
+/*      Set up the workers; the first is the calling thread.            */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < thread_count; i++ )
+    {
+        PJ_WARP_WORKER *w = workers + i;
+
+        w->job = job;
+        if( job->phase != WARP_MAP )
+            continue;
+
+        w->x = (double *) pj_malloc(sizeof(double) * warp->width * 2);
+        if( w->x == NULL )
+            break;
+        w->y = w->x + warp->width;
+
+        if( i == 0 )
+        {
+            w->src = warp->src;
+            w->dst = warp->dst;
+            continue;
+        }
+
+        w->ctx = pj_ctx_alloc();
+        if( w->ctx == NULL )
+            break;
+        w->ctx->debug_level = warp->src->ctx->debug_level;
+        w->ctx->logger = warp->src->ctx->logger;
+        w->ctx->app_data = warp->src->ctx->app_data;
+        w->ctx->thread_count = 0;
+
+        w->src = pj_clone_defn( w->ctx, warp->src );
+        w->dst = pj_clone_defn( w->ctx, warp->dst );
+        if( w->src == NULL || w->dst == NULL )
+            break;
+    }
+
+    if( i == 0 )
+        ok = 0;
+    else
+    {
+        /* any worker that could not be set up is left out */
+        pj_run_jobs( warp->src->ctx, i, pj_warp_worker_main,
+                     workers, sizeof(PJ_WARP_WORKER) );
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Clean up.                                                       */
+/* -------------------------------------------------------------------- */
+    for( i = 0; i < thread_count; i++ )
+    {
+        PJ_WARP_WORKER *w = workers + i;
+
+        if( i > 0 && w->src != NULL )
+            pj_free( w->src );
+        if( i > 0 && w->dst != NULL )
+            pj_free( w->dst );
+        if( w->ctx != NULL )
+            pj_ctx_free( w->ctx );
+        pj_dalloc( w->x );
+    }
+    pj_dalloc( workers );
+
+    return ok;
+}
+
+/************************************************************************/
+/*                          pj_warp_create()                            */
+/*                                                                      */
+/*      Prepare to reproject onto a width by height raster placed by    */
+/*      dst_georef in dst, from tiles of a source grid placed by        */
+/*      src_georef in src.  Positions are found with                    */
+/*      pj_transform_approx(), to within max_error source pixels (0     */
+/*      for exact).  Both definitions must outlive the warp.            */
+/************************************************************************/
+
+PJ_WARP *pj_warp_create( PJ *src, const projGeoref *src_georef,
+                         PJ *dst, const projGeoref *dst_georef,
+                         int width, int height, double max_error )
+
+{
+    PJ_WARP     *warp;
+    PJ_WARP_JOB job;
+
+    if( width <= 0 || height <= 0
+        || src_georef->res_x == 0.0 || src_georef->res_y == 0.0
+        || dst_georef->res_x == 0.0 || dst_georef->res_y == 0.0 )
+    {
+        pj_ctx_set_errno( src->ctx, -48 );
+        return NULL;
+    }
+
+    warp = (PJ_WARP *) pj_malloc(sizeof(PJ_WARP));
+    if( warp == NULL )
+    {
+        pj_ctx_set_errno( src->ctx, -2 );
+        return NULL;
+    }
+    memset( warp, 0, sizeof(PJ_WARP) );
+
+    warp->src = src;
+    warp->dst = dst;
+    warp->src_georef = *src_georef;
+    warp->dst_georef = *dst_georef;
+    warp->width = width;
+    warp->height = height;
+    warp->max_error = max_error
+        * MIN(fabs(src_georef->res_x), fabs(src_georef->res_y));
+
+    warp->map = (double *)
+        pj_malloc(sizeof(double) * 2 * (size_t) width * height);
+    if( warp->map == NULL )
+    {
+        pj_dalloc( warp );
+        pj_ctx_set_errno( src->ctx, -2 );
+        return NULL;
+    }
+
+    memset( &job, 0, sizeof(job) );
+    job.warp = warp;
+    job.phase = WARP_MAP;
+    if( !pj_warp_run( &job ) )
+    {
+        pj_warp_free( warp );
+        pj_ctx_set_errno( src->ctx, -2 );
+        return NULL;
+    }
+
+    /* points outside either projection are expected, not errors */
+    src->ctx->last_errno = 0;
+    dst->ctx->last_errno = 0;
+
+    return warp;
+}
+
+/************************************************************************/
+/*                          pj_warp_apply()                             */
+/*                                                                      */
+/*      Render the destination raster (4 bytes a pixel, stride bytes    */
+/*      a row) from the given source tiles, with PJ_WARP_NEAREST or     */
+/*      PJ_WARP_BILINEAR resampling.  The tiles must not overlap.       */
+/*      Returns 0, or an error code.                                    */
+/************************************************************************/
+
+int pj_warp_apply( PJ_WARP *warp, const projTile *tiles, int tile_count,
+                   unsigned char *rgba, int stride, int resampling )
+
+{
+    PJ_WARP_JOB job;
+
+    if( tile_count <= 0 )
+    {
+        int row;
+
+        for( row = 0; row < warp->height; row++ )
+            memset( rgba + (long) row * stride, 0, warp->width * 4 );
+        return 0;
+    }
+
+    memset( &job, 0, sizeof(job) );
+    job.warp = warp;
+    job.phase = WARP_RESAMPLE;
+    job.tiles = tiles;
+    job.tile_count = tile_count;
+    job.rgba = rgba;
+    job.stride = stride;
+    job.resampling = resampling;
+
+    if( !pj_warp_run( &job ) )
+    {
+        pj_ctx_set_errno( warp->src->ctx, -2 );
+        return -2;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                           pj_warp_free()                             */
+/************************************************************************/
+
+void pj_warp_free( PJ_WARP *warp )
+
+{
+    if( warp == NULL )
+        return;
+
+    pj_dalloc( warp->map );
+    pj_dalloc( warp );
+}
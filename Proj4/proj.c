@@ -185,8 +185,8 @@ vprocess(FILE *fid) {
 				emess(-1,"inverse for this projection not avail.\n");
 				continue;
 			}
-			dat_xy.u = strtod(s, &s);
-			dat_xy.v = strtod(s, &s);
+			dat_xy.u = pj_strtod(s, &s);
+			dat_xy.v = pj_strtod(s, &s);
 			if (dat_xy.u == HUGE_VAL || dat_xy.v == HUGE_VAL) {
 				emess(-1,"lon-lat input conversion failure\n");
 				continue;
@@ -364,11 +364,11 @@ int main(int argc, char **argv) {
                 postscale = 1;
                 if (!strncmp("1/",*++argv,2) || 
                     !strncmp("1:",*argv,2)) {
-                    if((fscale = atof((*argv)+2)) == 0.)
+                    if((fscale = pj_atof((*argv)+2)) == 0.)
                         goto badscale;
                     fscale = 1. / fscale;
                 } else
-                    if ((fscale = atof(*argv)) == 0.) {
+                    if ((fscale = pj_atof(*argv)) == 0.) {
                       badscale:
                         emess(1,"invalid scale argument");
                     }
@@ -455,7 +455,7 @@ int main(int argc, char **argv) {
         }
     }
     if (inverse)
-        informat = strtod;
+        informat = pj_strtod;
     else {
         informat = dmstor;
         if (!oform)
@@ -55,12 +55,50 @@ extern int pj_errno;	/* global error return code */
     typedef void *projPJ;
     #define projXY projUV
     #define projLP projUV
+    typedef void *projCtx;
+    typedef void *projPlan;
+    typedef void *projApprox;
+    typedef void *projWarp;
+    typedef void *projGeod;
+    typedef void *projGeodDensify;
 #else
     typedef PJ *projPJ;
+    typedef projCtx_t *projCtx;
+    typedef PJ_PLAN *projPlan;
+    typedef PJ_APPROX *projApprox;
+    typedef PJ_WARP *projWarp;
+    typedef PJ_GEOD *projGeod;
+    typedef PJ_GEOD_DENSIFY *projGeodDensify;
 #   define projXY	XY
 #   define projLP       LP
 #endif
 
+/* where a raster lies: the top left corner of its top left pixel, in
+   the units pj_transform() uses for it, and the size of a pixel.  Rows
+   run down from y_max. */
+typedef struct {
+    double x_min, y_max;
+    double res_x, res_y;
+} projGeoref;
+
+/* one tile of an RGBA source raster (4 bytes a pixel, stride bytes a
+   row), whose top left pixel is at col, row of the source grid */
+typedef struct {
+    const unsigned char *rgba;
+    int width, height, stride;
+    int col, row;
+} projTile;
+
+/* resampling used by pj_warp_apply() */
+#define PJ_WARP_NEAREST  0
+#define PJ_WARP_BILINEAR 1
+
+/* debug/logging levels used with pj_ctx_set_debug() and pj_log() */
+#define PJ_LOG_NONE        0
+#define PJ_LOG_ERROR       1
+#define PJ_LOG_DEBUG_MAJOR 2
+#define PJ_LOG_DEBUG_MINOR 3
+
 /* procedure prototypes */
 
 projXY pj_fwd(projLP, projPJ);
@@ -68,6 +106,58 @@ projLP pj_inv(projXY, projPJ);
 
 int pj_transform( projPJ src, projPJ dst, long point_count, int point_offset,
                   double *x, double *y, double *z );
+int pj_transform_batch( projPJ src, projPJ dst, long point_count,
+                        double *x, double *y, double *z, int *status );
+int pj_transform_approx( projPJ src, projPJ dst,
+                         long point_count, int point_offset,
+                         double *x, double *y, double *z, double max_error );
+projPlan pj_plan_create( projPJ src, projPJ dst );
+int pj_plan_transform( projPlan, long point_count, int point_offset,
+                       double *x, double *y, double *z );
+int pj_plan_is_identity( projPlan );
+void pj_plan_free( projPlan );
+projApprox pj_approx_create( projPJ, projLP ll, projLP ur, double max_error );
+int pj_approx_fwd( projApprox, long point_count, int point_offset,
+                   double *x, double *y );
+int pj_approx_inv( projApprox, long point_count, int point_offset,
+                   double *x, double *y );
+double pj_approx_error( projApprox, int inverse );
+void pj_approx_free( projApprox );
+projWarp pj_warp_create( projPJ src, const projGeoref *src_georef,
+                         projPJ dst, const projGeoref *dst_georef,
+                         int width, int height, double max_error );
+int pj_warp_apply( projWarp, const projTile *tiles, int tile_count,
+                   unsigned char *rgba, int stride, int resampling );
+void pj_warp_free( projWarp );
+int pj_utm_fwd( projPJ ellps, long point_count, int point_offset,
+                double *x, double *y, int *zone );
+int pj_utm_inv( projPJ ellps, long point_count, int point_offset,
+                double *x, double *y, const int *zone );
+projGeod pj_geod_create( projPJ ellps );
+int pj_geod_fwd( projGeod, long point_count, int point_offset,
+                 double *lam, double *phi,
+                 const double *az12, const double *dist, double *az21 );
+int pj_geod_inv( projGeod, long point_count, int point_offset,
+                 const double *lam1, const double *phi1,
+                 const double *lam2, const double *phi2,
+                 double *dist, double *az12, double *az21 );
+int pj_geod_matrix( projGeod, long row_count,
+                    const double *lam1, const double *phi1,
+                    long col_count, const double *lam2, const double *phi2,
+                    double *dist, double max_dist );
+void pj_geod_free( projGeod );
+projGeodDensify pj_geod_densify_create( projGeod, double lam1, double phi1,
+                                        double lam2, double phi2,
+                                        double max_segment, double max_angle );
+long pj_geod_densify_count( projGeodDensify );
+long pj_geod_densify_read( projGeodDensify, long max_points,
+                           double *lam, double *phi );
+void pj_geod_densify_free( projGeodDensify );
+int pj_geod_densify( projGeod, long line_count,
+                     const double *lam1, const double *phi1,
+                     const double *lam2, const double *phi2,
+                     double max_segment, double max_angle,
+                     long *first, double *lam, double *phi );
 int pj_datum_transform( projPJ src, projPJ dst, long point_count, int point_offset,
                         double *x, double *y, double *z );
 int pj_geocentric_to_geodetic( double a, double es,
@@ -77,10 +167,13 @@ int pj_geodetic_to_geocentric( double a, double es,
                                long point_count, int point_offset,
                                double *x, double *y, double *z );
 int pj_compare_datums( projPJ srcdefn, projPJ dstdefn );
-int pj_apply_gridshift( const char *, int, 
+int pj_apply_gridshift( projCtx, const char *, int, 
                         long point_count, int point_offset,
                         double *x, double *y, double *z );
 void pj_deallocate_grids(void);
+void pj_set_grid_tile_limit( int max_tiles );
+int pj_get_grid_tile_count(void);
+void pj_get_initcache_stats( long *hits, long *misses, int *count );
 int pj_is_latlong(projPJ);
 int pj_is_geocent(projPJ);
 void pj_pr_list(projPJ);
@@ -89,6 +182,11 @@ void pj_set_finder( const char *(*)(const char *) );
 void pj_set_searchpath ( int count, const char **path );
 projPJ pj_init(int, char **);
 projPJ pj_init_plus(const char *);
+projPJ pj_init_ctx( projCtx, int, char ** );
+projPJ pj_init_plus_ctx( projCtx, const char * );
+projPJ pj_init_plus_cached( const char * );
+projPJ pj_init_plus_ctx_cached( projCtx, const char * );
+void pj_clear_defn_cache(void);
 char *pj_get_def(projPJ, int);
 projPJ pj_latlong_from_proj( projPJ );
 void *pj_malloc(size_t);
@@ -100,6 +198,23 @@ void pj_acquire_lock(void);
 void pj_release_lock(void);
 void pj_cleanup_lock(void);
 
+projCtx pj_get_default_ctx(void);
+projCtx pj_get_ctx( projPJ );
+void pj_set_ctx( projPJ, projCtx );
+projCtx pj_ctx_alloc(void);
+void    pj_ctx_free( projCtx );
+int pj_ctx_get_errno( projCtx );
+void pj_ctx_set_errno( projCtx, int );
+void pj_ctx_set_debug( projCtx, int );
+void pj_ctx_set_logger( projCtx, void (*)(void *, int, const char *) );
+void pj_ctx_set_app_data( projCtx, void * );
+void *pj_ctx_get_app_data( projCtx );
+void pj_ctx_set_thread_count( projCtx, int );
+int pj_ctx_get_thread_count( projCtx );
+
+void pj_log( projCtx ctx, int level, const char *fmt, ... );
+void pj_stderr_logger( void *, int, const char * );
+
 #ifdef __cplusplus
 }
 #endif
@@ -193,6 +193,16 @@ struct FACTORS {
 	double a, b;	/* max-min scale error */
 	int code;		/* info as to analytics, see following */
 };
+    /* Kruger series transverse Mercator, see pj_kruger.c */
+#define PJ_KRUGER_ORDER 6
+typedef struct {
+	double Qn;	/* meridian quadrant, scaled by k0, over pi/2 */
+	double Zb;	/* northing of the origin latitude */
+	double cgb[PJ_KRUGER_ORDER];	/* Gaussian -> geodetic latitude */
+	double cbg[PJ_KRUGER_ORDER];	/* geodetic -> Gaussian latitude */
+	double utg[PJ_KRUGER_ORDER];	/* ellipsoidal -> spherical N, E */
+	double gtu[PJ_KRUGER_ORDER];	/* spherical -> ellipsoidal N, E */
+} PJ_KRUGER;
 #define IS_ANAL_XL_YL 01	/* derivatives of lon analytic */
 #define IS_ANAL_XP_YP 02	/* derivatives of lat analytic */
 #define IS_ANAL_HK	04		/* h and k analytic */
@@ -200,14 +210,32 @@ struct FACTORS {
     /* parameter list struct */
 typedef struct ARG_list {
 	struct ARG_list *next;
-	char used;
+	char used;	/* 1 once read, plus PJ_PARAM_* flags */
+	unsigned long shared_used; /* head: used bits of shared items */
 	char param[1]; } paralist;
+#define PJ_PARAM_SHARED   02	/* init cache item, not ours to change */
+#define PJ_PARAM_APPENDED 04	/* added after +init=, looked up last */
+#define PJ_PARAM_SHARED_MAX 32	/* bits of shared_used we use */
+
+/* context: per-thread error state and logging hooks */
+typedef struct {
+    int     last_errno;
+    int     debug_level;
+    void    (*logger)(void *, int, const char *);
+    void    *app_data;
+    int     thread_count; /* worker threads for large pj_transform() calls */
+} projCtx_t;
+
 	/* base projection data structure */
 
 
 typedef struct PJconsts {
+        projCtx_t *ctx;
 	XY  (*fwd)(LP, struct PJconsts *);
 	LP  (*inv)(XY, struct PJconsts *);
+	/* optional array forms of fwd/inv, used by pj_transform() */
+	void (*fwd_array)(struct PJconsts *, long, int, double *, double *, int *);
+	void (*inv_array)(struct PJconsts *, long, int, double *, double *, int *);
 	void (*spc)(LP, struct PJconsts *, struct FACTORS *);
 	void (*pfree)(struct PJconsts *);
 	const char *descr;
@@ -234,12 +262,83 @@ typedef struct PJconsts {
         double  datum_params[7];
         double  from_greenwich; /* prime meridian offset (in radians) */
         double  long_wrap_center; /* 0.0 for -180 to 180, actually in radians*/
-        
+
+        /* resolved +nadgrids, NULL till first use.  A reference on a   */
+        /* grid list cache entry (see pj_gridlist_lookup()).            */
+        struct PJ_GRIDLIST *gridlist;
+
+        /* references to a pj_init_plus_cached() definition, 0 if none */
+        int     refcount;
+
+        /* init cache entry whose shared list ends params, NULL if none */
+        struct PJ_INITENTRY *initcache;
+
 #ifdef PROJ_PARMS__
 PROJ_PARMS__
 #endif /* end of optional extensions */
 } PJ;
 
+/* stages of a pj_transform() run (PJ_PLAN.stages) */
+#define PJ_STAGE_SRC_GEOCENT  0x001 /* geocentric source to lat/long */
+#define PJ_STAGE_SRC_INV      0x002 /* inverse project source */
+#define PJ_STAGE_SRC_PM       0x004 /* add source prime meridian */
+#define PJ_STAGE_DATUM        0x008 /* pj_datum_transform() */
+#define PJ_STAGE_DST_PM       0x010 /* subtract destination prime meridian */
+#define PJ_STAGE_DST_GEOCENT  0x020 /* lat/long to geocentric destination */
+#define PJ_STAGE_DST_FWD      0x040 /* forward project destination */
+#define PJ_STAGE_DST_WRAP     0x080 /* rewrap around long_wrap_center */
+#define PJ_STAGE_AFFINE       0x100 /* x = x*x_scale+x_offset, same for y */
+
+/* points carried through all the stages of pj_transform() at a time */
+#ifndef PJ_TRANSFORM_BLOCK
+#define PJ_TRANSFORM_BLOCK 1024
+#endif
+
+/* fewest points worth handing to a worker thread, see pj_parallel.c */
+#define PJ_PARALLEL_MIN_POINTS 65536
+
+/* destination rows handed to a worker thread at a time, see pj_warp.c */
+#define PJ_WARP_BLOCK_ROWS 16
+
+    /* precomputed src -> dst transformation, see pj_plan.c */
+typedef struct PJ_PLAN {
+        PJ      *srcdefn;
+        PJ      *dstdefn;
+        int     stages;     /* PJ_STAGE_* flags */
+        double  x_scale, x_offset;
+        double  y_scale, y_offset;
+} PJ_PLAN;
+
+    /* fitted series for a projection, see pj_approx.c */
+typedef struct PJ_APPROX PJ_APPROX;
+
+    /* raster reprojection, see pj_warp.c */
+typedef struct PJ_WARP PJ_WARP;
+
+    /* ellipsoid for geodesics, see pj_geod.c */
+typedef struct PJ_GEOD {
+        projCtx_t *ctx;     /* errors and thread count of array requests */
+        double  a;          /* semi-major axis */
+        double  onef, f, f2, f4, f64; /* 1 - f, f, f/2, f/4, f^2/64 */
+        int     ellipse;    /* 0 on a sphere */
+} PJ_GEOD;
+
+    /* one geodesic from a point and azimuth, see pj_geod.c */
+typedef struct {
+        const PJ_GEOD *G;
+        double  lam1, al12;
+        double  th1, costh1, sinth1, sina12, cosa12, M, N, c1, c2, D, P, s1;
+        int     merid, signS;
+} PJ_GEOD_LINE;
+
+    /* points along a geodesic, see pj_geod_densify.c */
+typedef struct PJ_GEOD_DENSIFY {
+        PJ_GEOD_LINE line;
+        double  lam1, phi1, lam2, phi2; /* ends, written as given */
+        double  step;       /* metres between points */
+        long    count, next;    /* points in all, next to write */
+} PJ_GEOD_DENSIFY;
+
 /* public API */
 #include "proj_api.h"
 
@@ -288,18 +387,26 @@ extern struct PJ_PRIME_MERIDIANS pj_prime_meridians[];
 	C_NAMESPACE PJ *pj_##name(PJ *P) { if (!P) { \
 	if( (P = (PJ*) pj_malloc(sizeof(PJ))) != NULL) { \
 	P->pfree = freeup; P->fwd = 0; P->inv = 0; \
-	P->spc = 0; P->descr = des_##name;
+	P->fwd_array = 0; P->inv_array = 0; \
+	P->spc = 0; P->descr = des_##name; \
+	P->ctx = pj_get_default_ctx(); P->gridlist = 0; \
+	P->refcount = 0; P->initcache = 0;
 #define ENTRYX } return P; } else {
 #define ENTRY0(name) ENTRYA(name) ENTRYX
 #define ENTRY1(name, a) ENTRYA(name) P->a = 0; ENTRYX
 #define ENTRY2(name, a, b) ENTRYA(name) P->a = 0; P->b = 0; ENTRYX
 #define ENDENTRY(p) } return (p); }
-#define E_ERROR(err) { pj_errno = err; freeup(P); return(0); }
+#define E_ERROR(err) { pj_ctx_set_errno( P->ctx, err); freeup(P); return(0); }
 #define E_ERROR_0 { freeup(P); return(0); }
-#define F_ERROR { pj_errno = -20; return(xy); }
-#define I_ERROR { pj_errno = -20; return(lp); }
+#define F_ERROR { pj_ctx_set_errno( P->ctx, -20); return(xy); }
+#define I_ERROR { pj_ctx_set_errno( P->ctx, -20); return(lp); }
 #define FORWARD(name) static XY name(LP lp, PJ *P) { XY xy = {0.0,0.0}
 #define INVERSE(name) static LP name(XY xy, PJ *P) { LP lp = {0.0,0.0}
+#define FORWARD_ARRAY(name) static void name(PJ *P, long n, int offset, \
+	double *x, double *y, int *status) { long i, io
+#define INVERSE_ARRAY(name) FORWARD_ARRAY(name)
+#define A_ERROR(err) { x[io] = y[io] = HUGE_VAL; if (status) status[i] = err; \
+	pj_ctx_set_errno( P->ctx, err); continue; }
 #define FREEUP static void freeup(PJ *P) {
 #define SPECIAL(name) static void name(LP lp, PJ *P, struct FACTORS *fac)
 #endif
@@ -315,52 +422,148 @@ struct CTABLE {
 	FLP *cvs;   /* conversion matrix */
 };
 
+/* "ctable2" grid files: LSB header of this size, then the FLP array */
+#define CTABLE2_HEADER_SIZE 160
+
 typedef struct _pj_gi {
     char *gridname;   /* identifying name of grid, eg "conus" or ntv2_0.gsb */
     char *filename;   /* full path to filename */
     
-    const char *format; /* format of this grid, ie "ctable", "ntv1", 
-                           "ntv2" or "missing". */
+    const char *format; /* format of this grid, ie "ctable", "ctable2", 
+                           "ntv1", "ntv2" or "missing". */
 
     int   grid_offset; /* offset in file, for delayed loading */
 
+    void  *map;        /* read-only mapping of the file backing ct->cvs */
+    size_t map_size;
+
     struct CTABLE *ct;
 
     struct _pj_gi *next;
     struct _pj_gi *child;
+    struct PJ_GRIDINDEX *child_index; /* NULL if few children */
+
+    /* large ntv1/ntv2 grids are loaded tile by tile: ct->cvs stays NULL */
+    struct PJ_GRIDTILE **tiles;  /* tiles_lam * tiles_phi, NULL if absent */
+    int   tiles_lam, tiles_phi;
 } PJ_GRIDINFO;
 
+/* cells per side of a grid tile, and default limit on resident tiles */
+#define PJ_GRID_TILE 64
+#define PJ_GRID_TILE_LIMIT 1024
+
+/* most arguments in a pj_init_plus() definition */
+#define PJ_MAX_ARG 200
+
+/* most definitions held by the pj_init_plus_cached() cache */
+#define PJ_DEFNCACHE_MAX 256
+
+/* most +init= definitions held by the init cache */
+#define PJ_INITCACHE_MAX 4096
+
+/* for caches read without the lock: order writes before publishing an
+   entry (and, where a flag rather than a pointer publishes it, the
+   test of the flag before the reads), and count events from several
+   threads (PJ_ATOMIC_INC/DEC give the value before the change) */
+#if defined(__GNUC__)
+#  define PJ_PUBLISH_BARRIER() __sync_synchronize()
+#  define PJ_ATOMIC_INC(v) __sync_fetch_and_add( &(v), 1 )
+#  define PJ_ATOMIC_DEC(v) __sync_fetch_and_sub( &(v), 1 )
+#elif defined(_MSC_VER)
+#  include <intrin.h>
+#  define PJ_PUBLISH_BARRIER() _ReadWriteBarrier()
+#  define PJ_ATOMIC_INC(v) (_InterlockedIncrement( &(v) ) - 1)
+#  define PJ_ATOMIC_DEC(v) (_InterlockedDecrement( &(v) ) + 1)
+#else
+#  define PJ_PUBLISH_BARRIER()
+#  define PJ_ATOMIC_INC(v) ((v)++)
+#  define PJ_ATOMIC_DEC(v) ((v)--)
+#endif
+
+/* build a PJ_GRIDINDEX only for lists of at least this many grids */
+#define PJ_GRIDINDEX_MIN 8
+
+/* uniform bucket index over the extents of a list of grids */
+typedef struct PJ_GRIDINDEX {
+    LP    ll;          /* lower left corner of bucket (0,0) */
+    LP    del;         /* size of one bucket */
+    ILP   lim;         /* buckets in each direction */
+    int   *start;      /* bucket i holds entry[start[i]..start[i+1]-1] */
+    int   *entry;      /* grid numbers, in list order within a bucket */
+    PJ_GRIDINFO **grids;
+    int   grid_count;
+} PJ_GRIDINDEX;
+
+/* a resolved nadgrids string, as cached by pj_gridlist_lookup() */
+typedef struct PJ_GRIDLIST {
+    char          *nadgrids;
+    PJ_GRIDINFO   **grids;
+    int           grid_count;
+    PJ_GRIDINDEX  *index;       /* NULL if few grids */
+    int           refcount;     /* cache slot plus lookups, under lock */
+} PJ_GRIDLIST;
+
 /* procedure prototypes */
 double dmstor(const char *, char **);
+double pj_strtod(const char *, char **);
+double pj_atof(const char *);
+double dmstor_ctx(projCtx_t *ctx, const char *, char **);
 void set_rtodms(int, int);
 char *rtodms(char *, double, int, int);
 double adjlon(double);
-double aacos(double), aasin(double), asqrt(double), aatan2(double, double);
-PVALUE pj_param(paralist *, char *);
+double aacos(projCtx_t *,double), aasin(projCtx_t *,double), asqrt(double), aatan2(double, double);
+PVALUE pj_param(projCtx_t *ctx, paralist *, const char *);
 paralist *pj_mkparam(char *);
-int pj_ell_set(paralist *, double *, double *);
-int pj_datum_set(paralist *, PJ *);
+paralist *pj_param_add(paralist *, char *, int);
+paralist *pj_param_tail(paralist *);
+paralist *pj_param_next(paralist *, paralist *);
+int pj_param_used(paralist *, paralist *);
+int pj_ell_set(projCtx_t *ctx, paralist *, double *, double *);
+int pj_datum_set(projCtx_t *,paralist *, PJ *);
 int pj_prime_meridian_set(paralist *, PJ *);
 int pj_angular_units_set(paralist *, PJ *);
 
 paralist *pj_clone_paralist( const paralist* );
 void pj_clear_initcache(void);
-paralist*pj_search_initcache( const char *filekey );
+const paralist *pj_search_initcache( const char *filekey,
+                                     struct PJ_INITENTRY **entry );
+void pj_release_initcache( struct PJ_INITENTRY *entry );
 void pj_insert_initcache( const char *filekey, const paralist *list);
 
+/* longest init file word, longer ones are split as by fscanf("%300s") */
+#define PJ_INITFILE_WORD 300
+int pj_initfile_lookup( projCtx_t *, const char *, const char *,
+                        const char **, const char ** );
+int pj_initfile_word( const char **, const char *, char * );
+void pj_clear_initfiles(void);
+
+int pj_split_definition( projCtx_t *, char *, char ** );
+
+struct PJ_LIST *pj_find_proj( const char * );
+struct PJ_ELLPS *pj_find_ellps( const char * );
+struct PJ_UNITS *pj_find_units( const char * );
+struct PJ_DATUMS *pj_find_datum( const char * );
+struct PJ_PRIME_MERIDIANS *pj_find_prime_meridian( const char * );
+int pj_defncache_release( PJ * );
+void pj_defncache_forget_ctx( projCtx_t * );
+
 double *pj_enfn(double);
 double pj_mlfn(double, double, double, double *);
-double pj_inv_mlfn(double, double, double *);
+double pj_inv_mlfn(projCtx_t *, double, double, double *);
+void pj_kruger_init(PJ_KRUGER *, double, double, double);
+int pj_kruger_fwd(const PJ_KRUGER *, double, double, double *, double *);
+int pj_kruger_inv(const PJ_KRUGER *, double, double, double *, double *);
 double pj_qsfn(double, double, double);
 double pj_tsfn(double, double, double);
 double pj_msfn(double, double, double);
-double pj_phi2(double, double);
+double pj_phi2(projCtx_t *, double, double);
+void pj_phi2_array(projCtx_t *, double, long, int, double *, double *);
 double pj_qsfn_(double, PJ *);
 double *pj_authset(double);
 double pj_authlat(double, double *);
 COMPLEX pj_zpoly1(COMPLEX, COMPLEX *, int);
 COMPLEX pj_zpolyd1(COMPLEX, COMPLEX *, int, COMPLEX *);
-FILE *pj_open_lib(char *, char *);
+FILE *pj_open_lib(projCtx_t *, char *, char *);
 
 int pj_deriv(LP, double, PJ *, struct DERIVS *);
 int pj_factors(LP, PJ *, double, struct FACTORS *);
@@ -379,6 +582,9 @@ typedef struct {	/* Chebyshev or Power series structure */
 	int power;		/* != 0 if power series, else Chebyshev */
 } Tseries;
 Tseries *mk_cheby(projUV, projUV, double, projUV *, projUV (*)(projUV), int, int, int);
+Tseries *mk_cheby_r(projUV, projUV, double, projUV *, projUV (*)(projUV, void *),
+                    void *, int, int, int);
+void free_cheby(Tseries *);
 projUV bpseval(projUV, Tseries *);
 projUV bcheval(projUV, Tseries *);
 projUV biveval(projUV, Tseries *);
@@ -386,30 +592,82 @@ void *vector1(int, int);
 void **vector2(int, int, int);
 void freev2(void **v, int nrows);
 int bchgen(projUV, projUV, int, int, projUV **, projUV(*)(projUV));
+int bchgen_r(projUV, projUV, int, int, projUV **, projUV(*)(projUV, void *), void *);
+projUV bchgen_call_plain(projUV, void *);
 int bch2bps(projUV, projUV, projUV **, int, int);
+struct PJ_APPROX {
+	PJ *P;			/* not owned */
+	projUV fwd_a, fwd_b;	/* lat/long area of fwd */
+	projUV inv_a, inv_b;	/* projected extent, area of inv */
+	Tseries *fwd, *inv;	/* NULL inv: computed exactly */
+	double fwd_error, inv_error;	/* largest error found */
+};
 /* nadcon related protos */
 LP nad_intr(LP, struct CTABLE *);
 LP nad_cvt(LP, int, struct CTABLE *);
-struct CTABLE *nad_init(char *);
-struct CTABLE *nad_ctable_init( FILE * fid );
-int nad_ctable_load( struct CTABLE *, FILE * fid );
+LP nad_intr_grid(projCtx_t *, LP, struct _pj_gi *, struct PJ_GRIDTILE **);
+LP nad_cvt_grid(projCtx_t *, LP, int, struct _pj_gi *,
+                struct PJ_GRIDTILE **);
+/* points per pass of the array forms below */
+#define NAD_BATCH 64
+void nad_intr_array(struct CTABLE *, int, const double *, const double *,
+                    double *, double *);
+void nad_cvt_array(struct CTABLE *, int, int, double *, double *);
+struct CTABLE *nad_init(projCtx_t *ctx, char *);
+struct CTABLE *nad_ctable_init( projCtx_t *ctx, FILE * fid );
+int nad_ctable_load( projCtx_t *ctx, struct CTABLE *, FILE * fid );
+struct CTABLE *nad_ctable2_init( projCtx_t *ctx, FILE * fid );
+int nad_ctable2_load( projCtx_t *ctx, struct CTABLE *, FILE * fid );
 void nad_free(struct CTABLE *);
 
 /* higher level handling of datum grid shift files */
 
-PJ_GRIDINFO **pj_gridlist_from_nadgrids( const char *, int * );
+PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx_t *, const char *, int * );
+PJ_GRIDLIST *pj_gridlist_lookup( projCtx_t *, const char * );
+void pj_gridlist_release( PJ_GRIDLIST * );
+PJ_GRIDLIST *pj_gridlist_resolve( PJ * );
 void pj_deallocate_grids();
 
-PJ_GRIDINFO *pj_gridinfo_init( const char * );
-int pj_gridinfo_load( PJ_GRIDINFO * );
+PJ_GRIDINFO *pj_gridinfo_init( projCtx_t *, const char * );
+int pj_gridinfo_load( projCtx_t *, PJ_GRIDINFO * );
+int pj_gridinfo_load_all( projCtx_t *, PJ_GRIDINFO * );
+int pj_gridinfo_cells( projCtx_t *, PJ_GRIDINFO *, int, int, FLP *,
+                       struct PJ_GRIDTILE ** );
+void pj_gridinfo_unpin( struct PJ_GRIDTILE ** );
 void pj_gridinfo_free( PJ_GRIDINFO * );
+void pj_swap_words( void *, int, int );
+
+PJ_GRIDINDEX *pj_gridindex_create( PJ_GRIDINFO **grids, int grid_count );
+int pj_gridindex_query( PJ_GRIDINDEX *, LP, const int ** );
+void pj_gridindex_free( PJ_GRIDINDEX * );
+
+int pj_apply_gridshift_2( PJ *defn, int inverse, 
+                          long point_count, int point_offset,
+                          double *x, double *y, double *z );
+void pj_plan_init( PJ_PLAN *, PJ *, PJ * );
+int pj_plan_run( PJ_PLAN *, long, int, double *, double *, double *, int * );
+PJ *pj_clone_defn( projCtx_t *, PJ * );
+int pj_plan_run_parallel( PJ_PLAN *, long, int, double *, double *, double *,
+                          int *, int * );
+int pj_job_count( projCtx_t *, double, double );
+void pj_run_jobs( projCtx_t *, int, void (*)(void *), void *, size_t );
+void pj_geod_init( PJ_GEOD *, double, double );
+void pj_geod_line_init( PJ_GEOD_LINE *, const PJ_GEOD *, double, double,
+                        double );
+void pj_geod_line_pos( const PJ_GEOD_LINE *, double, double *, double *,
+                       double * );
+void pj_geod_inverse( const PJ_GEOD *, double, double, double, double,
+                      double *, double *, double * );
+int pj_apply_gridlist( projCtx_t *ctx, PJ_GRIDINFO **tables, int grid_count,
+                       PJ_GRIDINDEX *index, int inverse, long point_count, int point_offset,
+                       double *x, double *y, double *z );
 
 void *proj_mdist_ini(double);
 double proj_mdist(double, double, double, const void *);
-double proj_inv_mdist(double, const void *);
+double proj_inv_mdist(projCtx_t *ctx, double, const void *);
 void *pj_gauss_ini(double, double, double *,double *);
 LP pj_gauss(LP, const void *);
-LP pj_inv_gauss(LP, const void *);
+LP pj_inv_gauss(projCtx_t *, LP, const void *);
 
 extern char const pj_release[];
 
@@ -0,0 +1,177 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Check that pj_transform() makes no heap allocation once the
+ *           source and destination have been used, with or without a
+ *           height array and over calls spanning several blocks.
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, PROJ.4 contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+/*
+** This program replaces pj_malloc() and pj_dalloc() with counting
+** versions, so it must be linked with the static library (see
+** test_alloc_LDFLAGS in Makefile.am).  It exits with a non zero status
+** if any of the checked pj_transform() calls allocates.
+*/
+
+#include <projects.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#define MAX_POINTS  (4 * PJ_TRANSFORM_BLOCK + 17)
+#define CALL_COUNT  1000
+
+static long alloc_count = 0;
+
+/************************************************************************/
+/*                             pj_malloc()                              */
+/*                                                                      */
+/*      As the library version, counting the allocations.               */
+/************************************************************************/
+
+void *pj_malloc( size_t size )
+
+{
+    int  old_errno = errno;
+    void *res = malloc( size );
+
+    alloc_count++;
+    if( res && !old_errno )
+        errno = 0;
+    return res;
+}
+
+/************************************************************************/
+/*                             pj_dalloc()                              */
+/************************************************************************/
+
+void pj_dalloc( void *ptr )
+
+{
+    free( ptr );
+}
+
+/************************************************************************/
+/*                             check_case()                             */
+/*                                                                      */
+/*      Transform point counts from 1 to max_points, CALL_COUNT times,  */
+/*      after one call to warm up any cached state, and return the      */
+/*      number of allocations seen, or -1 if a call failed.             */
+/************************************************************************/
+
+static long check_case( const char *src_defn, const char *dst_defn,
+                        int max_points, int with_z )
+
+{
+    static double x[MAX_POINTS], y[MAX_POINTS], z[MAX_POINTS];
+    projPJ  src, dst;
+    long    before, count;
+    int     call, i, n;
+
+    src = pj_init_plus( src_defn );
+    dst = pj_init_plus( dst_defn );
+    if( src == NULL || dst == NULL )
+    {
+        fprintf( stderr, "test_alloc: %s\n", pj_strerrno( pj_errno ) );
+        exit( 1 );
+    }
+
+    before = 0;
+    for( call = -1; call < CALL_COUNT; call++ )
+    {
+        n = call < 0 ? max_points : 1 + call % max_points;
+
+        for( i = 0; i < n; i++ )
+        {
+            x[i] = (9.0 + (i % 97) * 0.01) * DEG_TO_RAD;
+            y[i] = (48.0 + (i % 89) * 0.01) * DEG_TO_RAD;
+            z[i] = 100.0;
+        }
+
+        if( pj_transform( src, dst, n, 1, x, y, with_z ? z : NULL ) != 0 )
+        {
+            fprintf( stderr, "test_alloc: pj_transform(): %s\n",
+                     pj_strerrno( pj_errno ) );
+            count = -1;
+            goto done;
+        }
+
+        if( call < 0 )
+            before = alloc_count;
+    }
+
+    count = alloc_count - before;
+
+  done:
+    pj_free( src );
+    pj_free( dst );
+
+    return count;
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    static const struct {
+        const char *src, *dst;
+        int        max_points, with_z;
+    } cases[] = {
+        { "+proj=latlong +datum=WGS84",
+          "+proj=utm +zone=32 +ellps=bessel "
+          "+towgs84=598.1,73.7,418.2,0.202,0.045,-2.455,6.7", 100, 0 },
+        { "+proj=latlong +datum=WGS84",
+          "+proj=utm +zone=32 +ellps=bessel "
+          "+towgs84=598.1,73.7,418.2,0.202,0.045,-2.455,6.7", 100, 1 },
+        { "+proj=latlong +ellps=clrk66 +towgs84=-8,160,176",
+          "+proj=merc +datum=WGS84", MAX_POINTS, 0 },
+        { "+proj=latlong +ellps=intl +towgs84=-87,-98,-121",
+          "+proj=tmerc +lat_0=0 +lon_0=9 +k=0.9996 +x_0=500000 "
+          "+datum=WGS84", MAX_POINTS, 1 },
+    };
+    int  i, failed = 0;
+
+    (void) argc;
+    (void) argv;
+
+    for( i = 0; i < (int) (sizeof(cases) / sizeof(cases[0])); i++ )
+    {
+        long count = check_case( cases[i].src, cases[i].dst,
+                                 cases[i].max_points, cases[i].with_z );
+
+        printf( "%s: %ld allocations in %d calls of up to %d points%s\n"
+                "    %s -> %s\n",
+                count == 0 ? "PASS" : "FAIL", count, CALL_COUNT,
+                cases[i].max_points, cases[i].with_z ? "" : ", z == NULL",
+                cases[i].src, cases[i].dst );
+        if( count != 0 )
+            failed++;
+    }
+
+    return failed ? 1 : 0;
+}